@@ -0,0 +1,152 @@
+#include "AsyncLogBuffer.h" // Include the header file for the asynchronous log buffer
+
+// Largest power of two not greater than `size`
+static size_t floorPowerOfTwo(size_t size)
+{
+    size_t power = 1;
+    while (power <= size / 2)
+        power <<= 1;
+    return size ? power : 0;
+}
+
+AsyncLogBuffer::AsyncLogBuffer(uint8_t *storage, size_t size, overflow_policy_t policy)
+    : storage(storage), capacity(floorPowerOfTwo(size)), mask(floorPowerOfTwo(size) - 1), policy(policy)
+{
+    write_count = 0;
+    read_count = 0;
+    drain_offset = 0;
+    writeCallback = nullptr;    // Initialize the write callback as nullptr
+    writableCallback = nullptr; // Initialize the writable callback as nullptr
+    resetStatistics();
+}
+
+size_t AsyncLogBuffer::write(const void *data, size_t length)
+{
+    if (length == 0)
+        return 0;
+
+    const size_t needed = length + LOG_RECORD_HEADER_SIZE;
+    while (needed > capacity - used() || length > UINT16_MAX)
+    {
+        if (policy != DROP_OLDEST || length > UINT16_MAX || !evictOldest())
+        {
+            dropped_records++;
+            dropped_bytes += length;
+            return 0;
+        }
+    }
+
+    const uint32_t position = write_count;
+    const uint8_t header[LOG_RECORD_HEADER_SIZE] = {uint8_t(length & 0xFF), uint8_t(length >> 8)};
+    copyIn(position, header, LOG_RECORD_HEADER_SIZE);
+    copyIn(position + LOG_RECORD_HEADER_SIZE, data, length);
+
+    // Publish the record only after its content is in place
+    __asm__ __volatile__("" ::: "memory");
+    write_count = position + needed;
+
+    records++;
+    if (used() > high_watermark)
+        high_watermark = used();
+    return length;
+}
+
+size_t AsyncLogBuffer::drain(size_t max_bytes)
+{
+    if (!writeCallback)
+        return 0; // Keep everything buffered until there is somewhere to write to
+
+    if (writableCallback)
+        max_bytes = std::min(max_bytes, writableCallback());
+
+    size_t sent = 0;
+    while (sent < max_bytes && read_count != write_count)
+    {
+        const uint32_t position = read_count;
+        const size_t length = recordLength(position);
+        const size_t start = (position + LOG_RECORD_HEADER_SIZE + drain_offset) & mask;
+
+        // Hand over the longest contiguous run of the current record
+        size_t chunk = std::min(length - drain_offset, capacity - start);
+        chunk = std::min(chunk, max_bytes - sent);
+        const size_t written = writeCallback(storage + start, chunk);
+        sent += written;
+        drain_offset += written;
+
+        if (drain_offset == length)
+        {
+            drain_offset = 0;
+            __asm__ __volatile__("" ::: "memory");
+            read_count = position + LOG_RECORD_HEADER_SIZE + length; // Release the record to the producer
+        }
+        if (written < chunk)
+            break; // The transport is saturated, try again later
+    }
+    return sent;
+}
+
+bool AsyncLogBuffer::isEmpty(void) const
+{
+    return read_count == write_count;
+}
+
+AsyncLogBuffer::statistics_t AsyncLogBuffer::getStatistics(void) const
+{
+    statistics_t statistics;
+    statistics.capacity = capacity;
+    statistics.used = used();
+    statistics.high_watermark = high_watermark;
+    statistics.records = records;
+    statistics.dropped_records = dropped_records;
+    statistics.dropped_bytes = dropped_bytes;
+    return statistics;
+}
+
+void AsyncLogBuffer::resetStatistics(void)
+{
+    high_watermark = used();
+    records = 0;
+    dropped_records = 0;
+    dropped_bytes = 0;
+}
+
+void AsyncLogBuffer::registerWriteCallback(const write_callback_t callback)
+{
+    writeCallback = callback; // Register write callback function
+}
+
+void AsyncLogBuffer::registerWritableCallback(const writable_callback_t callback)
+{
+    writableCallback = callback; // Register writable callback function
+}
+
+size_t AsyncLogBuffer::used(void) const
+{
+    return write_count - read_count;
+}
+
+uint16_t AsyncLogBuffer::recordLength(uint32_t position) const
+{
+    return storage[position & mask] | (uint16_t(storage[(position + 1) & mask]) << 8);
+}
+
+void AsyncLogBuffer::copyIn(uint32_t position, const void *data, size_t length)
+{
+    const size_t start = position & mask;
+    const size_t first = std::min(length, capacity - start);
+    memcpy(storage + start, data, first);
+    memcpy(storage, static_cast<const uint8_t *>(data) + first, length - first);
+}
+
+bool AsyncLogBuffer::evictOldest(void)
+{
+    // The oldest record cannot be evicted while it is partially sent
+    if (read_count == write_count || drain_offset != 0)
+        return false;
+
+    const size_t length = recordLength(read_count);
+    read_count = read_count + LOG_RECORD_HEADER_SIZE + length;
+    dropped_records++;
+    dropped_bytes += length;
+    return true;
+}
@@ -0,0 +1,90 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+#define LOG_RECORD_HEADER_SIZE 2 // Every record is prefixed with its length (u16)
+
+/** Ring buffer that decouples log producers from the (possibly blocking) transport.
+ * Producers call `write()`, which copies a whole record or drops it, and never blocks.
+ * `drain()` pushes buffered bytes to the transport and is meant to run in idle time.
+ * With DROP_NEWEST one producer and one consumer may run in different contexts (e.g. another thread),
+ * DROP_OLDEST evicts records from the consumer side and requires both to run in the same context.
+ * */
+class AsyncLogBuffer
+{
+public:
+    typedef enum overflow_policy
+    {
+        DROP_NEWEST, // Discard the record that does not fit
+        DROP_OLDEST, // Evict the oldest records until the new one fits
+    } overflow_policy_t;
+
+    typedef struct statistics
+    {
+        size_t capacity;          // Usable size of the buffer in bytes
+        size_t used;              // Bytes currently buffered, including record headers
+        size_t high_watermark;    // Highest `used` seen since the last reset
+        uint32_t records;         // Records accepted
+        uint32_t dropped_records; // Records discarded because the buffer was full
+        uint32_t dropped_bytes;   // Payload bytes discarded because the buffer was full
+    } statistics_t;
+
+    typedef std::function<size_t(const uint8_t *, size_t)> write_callback_t;
+    typedef std::function<size_t(void)> writable_callback_t;
+
+    // Constructor, `size` must be a power of two
+    AsyncLogBuffer(uint8_t *storage, size_t size, overflow_policy_t policy = DROP_NEWEST);
+
+    // Enqueue a record. Returns `length` if it was accepted, 0 if it was dropped.
+    size_t write(const void *data, size_t length);
+
+    // Push up to `max_bytes` buffered bytes to the transport. Returns the number of bytes written.
+    size_t drain(size_t max_bytes);
+
+    // Check whether there is anything left to drain
+    bool isEmpty(void) const;
+
+    // Get buffer usage and drop counters
+    statistics_t getStatistics(void) const;
+
+    // Reset the high watermark and counters
+    void resetStatistics(void);
+
+    // Register the callback that writes to the transport
+    void registerWriteCallback(write_callback_t callback);
+
+    // Register an optional callback that reports how many bytes the transport takes without blocking
+    void registerWritableCallback(writable_callback_t callback);
+
+private:
+    uint8_t *storage;
+    const size_t capacity;
+    const size_t mask;
+    const overflow_policy_t policy;
+
+    volatile uint32_t write_count; // Total bytes enqueued, only modified by the producer
+    volatile uint32_t read_count;  // Total bytes released, only modified by the consumer (and the producer under DROP_OLDEST)
+    size_t drain_offset;           // Bytes of the oldest record already handed to the transport
+
+    size_t high_watermark;
+    uint32_t records;
+    uint32_t dropped_records;
+    uint32_t dropped_bytes;
+
+    write_callback_t writeCallback;
+    writable_callback_t writableCallback;
+
+    // Number of bytes currently stored
+    size_t used(void) const;
+
+    // Length of the record starting at `position`
+    uint16_t recordLength(uint32_t position) const;
+
+    // Copy `length` bytes into the ring at `position`, wrapping around as needed
+    void copyIn(uint32_t position, const void *data, size_t length);
+
+    // Discard the oldest complete record. Returns false if nothing could be evicted.
+    bool evictOldest(void);
+};
@@ -0,0 +1,157 @@
+#include "BinaryTelemetry.h" // Include the header file for binary telemetry
+
+#define TELEMETRY_FRAME_OVERHEAD 5                                                  // Type, sequence and CRC
+#define TELEMETRY_MAX_FRAME (TELEMETRY_MAX_PAYLOAD + TELEMETRY_FRAME_OVERHEAD)      // Largest raw frame
+#define TELEMETRY_MAX_ENCODED (TELEMETRY_MAX_FRAME + TELEMETRY_MAX_FRAME / 254 + 2) // Largest COBS frame including delimiter
+
+BinaryTelemetry::BinaryTelemetry()
+{
+    sequence = 0;            // First frame is number 0
+    writeCallback = nullptr; // Initialize the write callback as nullptr
+}
+
+size_t BinaryTelemetry::sendText(const char *text)
+{
+    return sendFrame(FRAME_TEXT, text, std::min<size_t>(strlen(text), TELEMETRY_MAX_PAYLOAD));
+}
+
+size_t BinaryTelemetry::sendIMUSample(uint32_t timestamp, const int32_t *acceleration, const int32_t *rotation)
+{
+    imu_sample_t sample;
+    sample.timestamp = timestamp;
+    memcpy(sample.acceleration, acceleration, sizeof(sample.acceleration));
+    memcpy(sample.rotation, rotation, sizeof(sample.rotation));
+    return sendFrame(FRAME_IMU_SAMPLE, &sample, sizeof(sample));
+}
+
+size_t BinaryTelemetry::sendInference(uint32_t timestamp, const float *scores, uint8_t num_scores, uint8_t best_index)
+{
+    inference_t inference;
+    inference.timestamp = timestamp;
+    inference.best_index = best_index;
+    inference.num_scores = std::min<uint8_t>(num_scores, TELEMETRY_MAX_SCORES);
+    return sendFrame(FRAME_INFERENCE, &inference, sizeof(inference), scores, inference.num_scores * sizeof(float));
+}
+
+size_t BinaryTelemetry::sendEvent(uint32_t timestamp, event_id_t id, int32_t value)
+{
+    event_t event;
+    event.timestamp = timestamp;
+    event.id = id;
+    event.value = value;
+    return sendFrame(FRAME_EVENT, &event, sizeof(event));
+}
+
+size_t BinaryTelemetry::sendUploadReply(uint8_t request, uint16_t sequence, uint8_t status, uint32_t value)
+{
+    upload_reply_t reply;
+    reply.request = request;
+    reply.sequence = sequence;
+    reply.status = status;
+    reply.value = value;
+    return sendFrame(FRAME_UPLOAD, &reply, sizeof(reply));
+}
+
+size_t BinaryTelemetry::sendTokenized(uint32_t token, const uint8_t *args, size_t length)
+{
+    const uint8_t header[4] = {uint8_t(token), uint8_t(token >> 8), uint8_t(token >> 16), uint8_t(token >> 24)};
+    return sendFrame(FRAME_TOKENIZED, header, sizeof(header), args, length);
+}
+
+void BinaryTelemetry::registerWriteCallback(const write_callback_t callback)
+{
+    writeCallback = callback; // Register write callback function
+}
+
+size_t BinaryTelemetry::sendFrame(frame_type_t type, const void *header, size_t header_length, const void *payload, size_t payload_length)
+{
+    if (!writeCallback)
+        return 0; // Return if write callback is not set
+    if (header_length + payload_length > TELEMETRY_MAX_PAYLOAD)
+        return 0; // Never emit a frame the decoder would reject
+
+    // Assemble the raw frame: type, sequence, payload, CRC
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    size_t length = 0;
+    frame[length++] = type;
+    frame[length++] = sequence & 0xFF;
+    frame[length++] = sequence >> 8;
+    memcpy(frame + length, header, header_length);
+    length += header_length;
+    if (payload_length)
+        memcpy(frame + length, payload, payload_length);
+    length += payload_length;
+    uint16_t crc = crc16(frame, length);
+    frame[length++] = crc & 0xFF;
+    frame[length++] = crc >> 8;
+    sequence++;
+
+    // Stuff it and append the delimiter
+    uint8_t encoded[TELEMETRY_MAX_ENCODED];
+    size_t encoded_length = cobsEncode(frame, length, encoded);
+    encoded[encoded_length++] = 0x00;
+
+    return writeCallback(encoded, encoded_length);
+}
+
+uint16_t BinaryTelemetry::crc16(const uint8_t *data, size_t length, uint16_t crc)
+{
+    while (length--)
+    {
+        crc ^= uint16_t(*data++) << 8;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+    return crc;
+}
+
+size_t BinaryTelemetry::cobsEncode(const uint8_t *input, size_t length, uint8_t *output)
+{
+    size_t code_index = 0;  // Where the length code of the current block goes
+    size_t write_index = 1; // Next data byte position
+    uint8_t code = 1;       // Length of the current block + 1
+
+    for (size_t read_index = 0; read_index < length; read_index++)
+    {
+        if (input[read_index] == 0)
+        {
+            // Close the block, the zero itself is implied by the code
+            output[code_index] = code;
+            code = 1;
+            code_index = write_index++;
+            continue;
+        }
+
+        output[write_index++] = input[read_index];
+        if (++code == 0xFF)
+        {
+            // Maximum block length reached, start a new block without an implied zero
+            output[code_index] = code;
+            code = 1;
+            code_index = write_index++;
+        }
+    }
+    output[code_index] = code;
+    return write_index;
+}
+
+size_t BinaryTelemetry::cobsDecode(const uint8_t *input, size_t length, uint8_t *output)
+{
+    size_t read_index = 0;
+    size_t write_index = 0;
+
+    while (read_index < length)
+    {
+        const uint8_t code = input[read_index];
+        if (code == 0 || read_index + code > length)
+            return 0; // Zero inside a block or block beyond the end
+
+        // Copy the block, the output never overtakes the input
+        read_index++;
+        for (uint8_t i = 1; i < code; i++)
+            output[write_index++] = input[read_index++];
+        if (code < 0xFF && read_index < length)
+            output[write_index++] = 0; // Implied zero between blocks
+    }
+    return write_index;
+}
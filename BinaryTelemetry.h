@@ -0,0 +1,126 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+#include "TokenizedLog.h"
+
+#define TELEMETRY_MAX_PAYLOAD 128 // Maximum payload size of a single frame in bytes
+#define TELEMETRY_MAX_SCORES 16   // Maximum number of scores in an inference frame
+
+/** Compact binary telemetry.
+ * Every frame is laid out as:
+ *   [type: u8] [sequence: u16] [payload: 0 - TELEMETRY_MAX_PAYLOAD bytes] [crc: u16]
+ * All fields are little-endian, the CRC is CRC-16/CCITT-FALSE over type, sequence and payload.
+ * The frame is then COBS encoded and terminated with a 0x00 delimiter,
+ * so a receiver can always resynchronize on the next zero byte.
+ * Use `tools/telemetry_decode.py` on the host to turn the stream back into text.
+ * */
+// Send a log message over `telemetry` as a token, `format` must be a string literal
+#define TOKENIZED_LOG(telemetry, format, ...) (telemetry).sendTokenizedLog(LOG_TOKEN(format), ##__VA_ARGS__)
+
+class BinaryTelemetry
+{
+public:
+    typedef enum frame_type : uint8_t
+    {
+        FRAME_TEXT = 0x01,       // Free-form log text, payload is the string without terminator
+        FRAME_IMU_SAMPLE = 0x02, // imu_sample_t
+        FRAME_INFERENCE = 0x03,  // inference_t, followed by `num_scores` float32 scores
+        FRAME_EVENT = 0x04,      // event_t
+        FRAME_TOKENIZED = 0x05,  // Tokenized log message: u32 token followed by the encoded arguments, see `TokenizedLog.h`
+        FRAME_UPLOAD = 0x06,     // upload_reply_t, answer to a request of `tools/model_upload.py`, see `ModelUpload.h`
+    } frame_type_t;
+
+    typedef enum event_id : uint8_t
+    {
+        EVENT_STARTED = 0x01,           // Initialization finished, value is unused
+        EVENT_INVOKE_FAILED = 0x02,     // `Invoke()` failed, value is the TfLiteStatus
+        EVENT_GESTURE_UNHANDLED = 0x03, // No action for a gesture, value is the gesture index
+        EVENT_GESTURE_BEGIN = 0x04,     // A gesture was recognized, value is the gesture index
+        EVENT_GESTURE_END = 0x05,       // The active gesture is over, value is the gesture index
+        EVENT_ACTIVITY = 0x06,          // The sensor changed its activity state, value is 1 for active, 0 for inactive
+    } event_id_t;
+
+    typedef struct imu_sample
+    {
+        uint32_t timestamp;      // Sample time in ms
+        int32_t acceleration[3]; // X, Y, Z accelerometer values in mG
+        int32_t rotation[3];     // X, Y, Z gyroscope values in mDPS
+    } __packed imu_sample_t;
+
+    typedef struct inference
+    {
+        uint32_t timestamp; // Inference time in ms
+        uint8_t best_index; // Index of the highest score
+        uint8_t num_scores; // Number of float32 scores following this header
+    } __packed inference_t;
+
+    typedef struct event
+    {
+        uint32_t timestamp; // Event time in ms
+        event_id_t id;      // Event identifier
+        int32_t value;      // Event specific value
+    } __packed event_t;
+
+    typedef struct upload_reply
+    {
+        uint8_t request;   // Type of the answered request
+        uint16_t sequence; // Sequence number of the answered request
+        uint8_t status;    // 0 on success, otherwise the error
+        uint32_t value;    // Request specific value
+    } __packed upload_reply_t;
+
+    typedef std::function<size_t(const uint8_t *, size_t)> write_callback_t;
+
+    // Constructor
+    BinaryTelemetry();
+
+    // Send free-form text
+    size_t sendText(const char *text);
+
+    // Send a raw IMU sample
+    size_t sendIMUSample(uint32_t timestamp, const int32_t *acceleration, const int32_t *rotation);
+
+    // Send the scores of an inference
+    size_t sendInference(uint32_t timestamp, const float *scores, uint8_t num_scores, uint8_t best_index);
+
+    // Send an event
+    size_t sendEvent(uint32_t timestamp, event_id_t id, int32_t value = 0);
+
+    // Answer a model upload request
+    size_t sendUploadReply(uint8_t request, uint16_t sequence, uint8_t status, uint32_t value);
+
+    // Send a tokenized log message with already encoded arguments
+    size_t sendTokenized(uint32_t token, const uint8_t *args, size_t length);
+
+    // Encode the arguments and send a tokenized log message. Use through `TOKENIZED_LOG()`.
+    template <typename... Args>
+    size_t sendTokenizedLog(uint32_t token, Args... args)
+    {
+        uint8_t buffer[LOG_TOKEN_MAX_ARGS_SIZE];
+        return sendTokenized(token, buffer, TokenizedLog::encode(buffer, sizeof(buffer), args...));
+    }
+
+    // Register the callback that writes encoded frames to the transport
+    void registerWriteCallback(write_callback_t callback);
+
+    // CRC-16/CCITT-FALSE
+    static uint16_t crc16(const uint8_t *data, size_t length, uint16_t crc = 0xFFFF);
+
+    // Decode a COBS block sequence without the delimiter, in place is allowed. Returns the decoded length, 0 if malformed.
+    static size_t cobsDecode(const uint8_t *input, size_t length, uint8_t *output);
+
+private:
+    uint16_t sequence; // Sequence number of the next frame
+
+    write_callback_t writeCallback;
+
+    // Build, encode and write a frame. Returns the number of bytes written.
+    size_t sendFrame(frame_type_t type, const void *header, size_t header_length, const void *payload = nullptr, size_t payload_length = 0);
+
+    // Consistent Overhead Byte Stuffing. `output` must hold at least `length + length / 254 + 1` bytes.
+    // Returns the encoded length, without the delimiter.
+    static size_t cobsEncode(const uint8_t *input, size_t length, uint8_t *output);
+};
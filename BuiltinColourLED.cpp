@@ -2,7 +2,32 @@
 
 #include <WiFiNINA.h> // Include the library for WiFiNINA functionality on Arduino
 
-void BuiltinColourLED::enable() const
+// Gamma lookup table for `LED_GAMMA_VALUE`, generated at compile time and stored in flash
+static constexpr BuiltinColourLED::gamma_table_t default_gamma_table = BuiltinColourLED::makeGammaTable(LED_GAMMA_VALUE);
+
+// Write one gamma corrected channel, unless `current` says it already shows `value`.
+// `Pin` is whatever type the core declares the LED pins as (`NinaPin` on the Nano RP2040 Connect).
+template <typename Pin>
+static void writeChannel(Pin pin, uint8_t value, uint8_t &current, bool current_valid)
+{
+    if (current_valid && value == current)
+        return; // Already showing this value
+
+    // Either write the corrected value with analogWrite
+    // or set the pin mode to OUTPUT if the value is 0 (to turn off the LED)
+    (value) ? analogWrite(pin, ~value) : pinMode(pin, OUTPUT);
+    current = value;
+}
+
+BuiltinColourLED::BuiltinColourLED()
+{
+    gamma_table = &default_gamma_table;
+    gamma = LED_GAMMA_VALUE;
+    output = rgb(0, 0, 0);
+    output_valid = false;
+}
+
+void BuiltinColourLED::enable()
 {
     // Set the LED pins to output mode
     pinMode(LEDR, OUTPUT);
@@ -15,9 +40,10 @@ void BuiltinColourLED::enable() const
     digitalWrite(LEDR, LOW);
     digitalWrite(LEDG, LOW);
     digitalWrite(LEDB, LOW);
+    output_valid = false; // Pin state is no longer what the cache says
 }
 
-void BuiltinColourLED::setRGB(const rgb_t &rgb) const
+void BuiltinColourLED::setRGB(const rgb_t &rgb)
 {
     // analogWrite(LEDR, ~gammaCorrection(rgb.r, LED_GAMMA_VALUE));
     // analogWrite(LEDG, ~gammaCorrection(rgb.g, LED_GAMMA_VALUE));
@@ -30,24 +56,24 @@ void BuiltinColourLED::setRGB(const rgb_t &rgb) const
     // Refer to: https://forum.arduino.cc/t/rp2040-connect-rgb-led-still-glows-after-analogwrite-ledr-255/868632
 
     // Apply gamma correction to each color component
-    uint8_t r = gammaCorrection(rgb.r, LED_GAMMA_VALUE);
-    uint8_t g = gammaCorrection(rgb.g, LED_GAMMA_VALUE);
-    uint8_t b = gammaCorrection(rgb.b, LED_GAMMA_VALUE);
+    uint8_t r = gammaCorrection(rgb.r);
+    uint8_t g = gammaCorrection(rgb.g);
+    uint8_t b = gammaCorrection(rgb.b);
 
-    // Use ternary operators to either write the corrected value with analogWrite
-    // or set the pin mode to OUTPUT if the value is 0 (to turn off the LED)
-    (r) ? analogWrite(LEDR, ~r) : pinMode(LEDR, OUTPUT);
-    (g) ? analogWrite(LEDG, ~g) : pinMode(LEDG, OUTPUT);
-    (b) ? analogWrite(LEDB, ~b) : pinMode(LEDB, OUTPUT);
+    // Every write is a transfer to the WiFiNINA co-processor, only send the channels that changed
+    writeChannel(LEDR, r, output.r, output_valid);
+    writeChannel(LEDG, g, output.g, output_valid);
+    writeChannel(LEDB, b, output.b, output_valid);
+    output_valid = true;
 }
 
-void BuiltinColourLED::setRGB(uint8_t r, uint8_t g, uint8_t b) const
+void BuiltinColourLED::setRGB(uint8_t r, uint8_t g, uint8_t b)
 {
     // Overloaded method to set RGB values directly
     setRGB(rgb(r, g, b));
 }
 
-void BuiltinColourLED::setHSV(const hsv_t &hsv) const
+void BuiltinColourLED::setHSV(const hsv_t &hsv)
 {
     // Convert HSV values to RGB and set the LED colors
     rgb_t rgb;
@@ -55,7 +81,7 @@ void BuiltinColourLED::setHSV(const hsv_t &hsv) const
     setRGB(rgb);
 }
 
-void BuiltinColourLED::setHSV(uint16_t h, uint8_t s, uint8_t v) const
+void BuiltinColourLED::setHSV(uint16_t h, uint8_t s, uint8_t v)
 {
     // Overloaded method to set HSV values directly
     setHSV(hsv(h, s, v));
@@ -63,57 +89,83 @@ void BuiltinColourLED::setHSV(uint16_t h, uint8_t s, uint8_t v) const
 
 void BuiltinColourLED::hsv2rgb(const hsv_t &hsv, rgb_t &rgb) const
 {
-    // Convert HSV color model to RGB color model
-    float h = hsv.h / 360.0f;           // Normalize hue to [0, 1]
-    float s = hsv.s / 100.0f;           // Normalize saturation to [0, 1]
-    float v = hsv.v / 100.0f;           // Normalize value (brightness) to [0, 1]
-    int8_t i = static_cast<int>(h * 6); // Sector 0 to 5
-
-    // Fractional part of h
-    float f = h * 6 - i;
-    // Calculate intermediate values
-    float p = v * (1 - s);
-    float q = v * (1 - f * s);
-    float t = v * (1 - (1 - f) * s);
+    // Convert HSV color model to RGB color model.
+    // Fixed-point only: RP2040 has no FPU, but a single-cycle 32-bit multiplier.
+    // Results are within 1 LSB of the floating-point formula.
+    uint32_t i = (hsv.h * 1093u) >> 16;  // Sector 0 to 6, floor(h / 60) for h in [0, 360]
+    uint32_t remainder = hsv.h - i * 60; // Position within the sector, 0 - 59
+
+    uint32_t v = (hsv.v * 167117u) >> 8;         // Value scaled to [0, 255] in Q8, v * 255 / 100
+    uint32_t s = (hsv.s * 41943u + 32) >> 6;     // Saturation in Q16, s / 100
+    uint32_t f = (remainder * 69905u + 32) >> 6; // Fractional part of h in Q16, remainder / 60
+    uint32_t fs = (f * s) >> 16;                 // f * s
+    uint32_t p = (v * (65536 - s)) >> 16;        // v * (1 - s)
+    uint32_t q = (v * (65536 - fs)) >> 16;       // v * (1 - f * s)
+    uint32_t t = (v * (65536 - s + fs)) >> 16;   // v * (1 - (1 - f) * s)
+
+    // Back from Q8 to 8-bit components
+    v >>= 8;
+    p >>= 8;
+    q >>= 8;
+    t >>= 8;
 
     // Assign RGB values based on the sector of the hue
     switch (i % 6)
     {
     case 0:
-        rgb.r = v * LED_PWM_RESOLUTION;
-        rgb.g = t * LED_PWM_RESOLUTION;
-        rgb.b = p * LED_PWM_RESOLUTION;
+        rgb.r = v;
+        rgb.g = t;
+        rgb.b = p;
         break;
     case 1:
-        rgb.r = q * LED_PWM_RESOLUTION;
-        rgb.g = v * LED_PWM_RESOLUTION;
-        rgb.b = p * LED_PWM_RESOLUTION;
+        rgb.r = q;
+        rgb.g = v;
+        rgb.b = p;
         break;
     case 2:
-        rgb.r = p * LED_PWM_RESOLUTION;
-        rgb.g = v * LED_PWM_RESOLUTION;
-        rgb.b = t * LED_PWM_RESOLUTION;
+        rgb.r = p;
+        rgb.g = v;
+        rgb.b = t;
         break;
     case 3:
-        rgb.r = p * LED_PWM_RESOLUTION;
-        rgb.g = q * LED_PWM_RESOLUTION;
-        rgb.b = v * LED_PWM_RESOLUTION;
+        rgb.r = p;
+        rgb.g = q;
+        rgb.b = v;
         break;
     case 4:
-        rgb.r = t * LED_PWM_RESOLUTION;
-        rgb.g = p * LED_PWM_RESOLUTION;
-        rgb.b = v * LED_PWM_RESOLUTION;
+        rgb.r = t;
+        rgb.g = p;
+        rgb.b = v;
         break;
     case 5:
-        rgb.r = v * LED_PWM_RESOLUTION;
-        rgb.g = p * LED_PWM_RESOLUTION;
-        rgb.b = q * LED_PWM_RESOLUTION;
+        rgb.r = v;
+        rgb.g = p;
+        rgb.b = q;
         break;
     }
 }
 
-uint8_t BuiltinColourLED::gammaCorrection(const uint8_t component, const float gamma) const
+void BuiltinColourLED::setGamma(float gamma)
+{
+    this->gamma = gamma;
+    if (gamma == LED_GAMMA_VALUE)
+    {
+        // Back to the table in flash
+        gamma_table = &default_gamma_table;
+        return;
+    }
+    custom_gamma_table = makeGammaTable(gamma);
+    gamma_table = &custom_gamma_table;
+}
+
+float BuiltinColourLED::getGamma() const
+{
+    return gamma;
+}
+
+uint8_t BuiltinColourLED::gammaCorrection(const uint8_t component) const
 {
     // Apply gamma correction to the color component
-    return static_cast<uint8_t>(powf(component / LED_PWM_RESOLUTION, gamma) * LED_PWM_RESOLUTION + 0.5f);
+    return gamma_table->value[component];
 }
+
@@ -26,13 +26,100 @@ public:
         hsv(uint16_t _h, uint8_t _s, uint8_t _v) : h(_h), s(_s), v(_v) {}
     } __packed hsv_t;
 
-    void enable() const;
-    void setRGB(const rgb_t &rgb) const;
-    void setRGB(uint8_t r, uint8_t g, uint8_t b) const;
-    void setHSV(const hsv_t &hsv) const;
-    void setHSV(uint16_t h, uint8_t s, uint8_t v) const;
+    typedef struct gamma_table
+    {
+        uint8_t value[256]; // Gamma corrected output for every 8-bit input
+    } gamma_table_t;
+
+    // Constructor, starts with the compile-time table for `LED_GAMMA_VALUE`
+    BuiltinColourLED();
+
+    void enable();
+    // Channels that already show the requested value are not written again
+    void setRGB(const rgb_t &rgb);
+    void setRGB(uint8_t r, uint8_t g, uint8_t b);
+    void setHSV(const hsv_t &hsv);
+    void setHSV(uint16_t h, uint8_t s, uint8_t v);
     void hsv2rgb(const hsv_t &hsv, rgb_t &rgb) const;
 
+    // Change the gamma value, regenerates the lookup table at runtime
+    void setGamma(float gamma);
+    float getGamma() const;
+
+    // Build a gamma lookup table. Produces exactly
+    // `uint8_t(powf(component / LED_PWM_RESOLUTION, gamma) * LED_PWM_RESOLUTION + 0.5f)` for every component,
+    // but can be evaluated at compile time.
+    static constexpr gamma_table_t makeGammaTable(float gamma)
+    {
+        gamma_table_t table = {};
+        for (int component = 0; component < 256; component++)
+            table.value[component] = gammaEntry(component, gamma);
+        return table;
+    }
+
 private:
-    uint8_t gammaCorrection(const uint8_t component, const float gamma) const;
+    const gamma_table_t *gamma_table; // Table in use, either the compile-time one or `custom_gamma_table`
+    gamma_table_t custom_gamma_table; // Table generated by `setGamma()`
+    float gamma;                      // Gamma value of `gamma_table`
+    rgb_t output;                     // Gamma corrected values last written to the pins
+    bool output_valid;                // Whether `output` reflects the pins, false until the first write after `enable()`
+
+    uint8_t gammaCorrection(const uint8_t component) const;
+
+    // Natural logarithm, `x` > 0
+    static constexpr double constexprLog(double x)
+    {
+        // Reduce to x = m * 2^k with m in [1, 2), then ln(m) = 2 * atanh((m - 1) / (m + 1))
+        int k = 0;
+        while (x >= 2.0)
+        {
+            x /= 2.0;
+            k++;
+        }
+        while (x < 1.0)
+        {
+            x *= 2.0;
+            k--;
+        }
+        const double y = (x - 1.0) / (x + 1.0);
+        const double y2 = y * y;
+        double term = y;
+        double sum = 0.0;
+        for (int n = 1; n < 60; n += 2)
+        {
+            sum += term / n;
+            term *= y2;
+        }
+        return 2.0 * sum + k * 0.69314718055994530942;
+    }
+
+    // Exponential function
+    static constexpr double constexprExp(double x)
+    {
+        // Reduce to x = k * ln(2) + r with |r| <= ln(2) / 2, then e^x = 2^k * e^r
+        const double ln2 = 0.69314718055994530942;
+        const int k = static_cast<int>(x / ln2 + (x < 0 ? -0.5 : 0.5));
+        const double r = x - k * ln2;
+        double term = 1.0;
+        double sum = 1.0;
+        for (int n = 1; n < 30; n++)
+        {
+            term *= r / n;
+            sum += term;
+        }
+        for (int i = 0; i < k; i++)
+            sum *= 2.0;
+        for (int i = 0; i > k; i--)
+            sum /= 2.0;
+        return sum;
+    }
+
+    static constexpr uint8_t gammaEntry(int component, float gamma)
+    {
+        // Follow the float operations of the `powf()` based formula so the rounding is identical
+        const float normalized = component / LED_PWM_RESOLUTION;
+        const float corrected = (component == 0) ? (gamma == 0.0f ? 1.0f : 0.0f)
+                                                 : static_cast<float>(constexprExp(gamma * constexprLog(normalized)));
+        return static_cast<uint8_t>(corrected * LED_PWM_RESOLUTION + 0.5f);
+    }
 };
@@ -0,0 +1,144 @@
+#include "ColourLEDAnimator.h" // Include the header file for ColourLEDAnimator class
+
+ColourLEDAnimator::ColourLEDAnimator(BuiltinColourLED &led, uint16_t update_rate)
+    : led(led), update_rate(update_rate ? update_rate : 1),
+      thread(osPriorityAboveNormal, LED_THREAD_STACK_SIZE, thread_stack, "LED"), // Short bursts, keeps animations smooth during inference
+      queue(LED_QUEUE_SIZE, queue_buffer)
+{
+    state = {ANIMATION_STEADY, 0, rgb_t(0, 0, 0), rgb_t(0, 0, 0), 0, 0, 0}; // Start dark
+    shown = rgb_t(0, 0, 0);
+    shown_valid = false; // The LED may still show whatever was set before `begin()`
+    changed = true; // Render the initial state once
+    statistics = {0, 0};
+}
+
+void ColourLEDAnimator::begin(void)
+{
+    queue.call_every(std::chrono::milliseconds(1000 / update_rate), mbed::callback(this, &ColourLEDAnimator::update));
+    thread.start(mbed::callback(&queue, &events::EventQueue::dispatch_forever));
+}
+
+void ColourLEDAnimator::setRGB(const rgb_t &rgb)
+{
+    state_t next = {ANIMATION_STEADY, 0, rgb, rgb, 0, 0, 0};
+    request(next);
+}
+
+void ColourLEDAnimator::setRGB(uint8_t r, uint8_t g, uint8_t b)
+{
+    // Overloaded method to set RGB values directly
+    setRGB(rgb_t(r, g, b));
+}
+
+void ColourLEDAnimator::fadeTo(const rgb_t &rgb, uint16_t duration)
+{
+    mutex.lock();
+    const uint32_t now = millis();
+    state_t next = {ANIMATION_FADE, now, render(now), rgb, duration, 0, 0}; // Continue from wherever the LED is right now
+    mutex.unlock();
+    request(next);
+}
+
+void ColourLEDAnimator::blink(const rgb_t &on, const rgb_t &off, uint16_t on_time, uint16_t off_time, uint16_t count)
+{
+    state_t next = {ANIMATION_BLINK, uint32_t(millis()), on, off, on_time, off_time, count};
+    request(next);
+}
+
+bool ColourLEDAnimator::isAnimating(void)
+{
+    mutex.lock();
+    const bool animating = (state.animation != ANIMATION_STEADY);
+    mutex.unlock();
+    return animating;
+}
+
+ColourLEDAnimator::statistics_t ColourLEDAnimator::getStatistics(void)
+{
+    mutex.lock();
+    const statistics_t copy = statistics;
+    mutex.unlock();
+    return copy;
+}
+
+void ColourLEDAnimator::resetStatistics(void)
+{
+    mutex.lock();
+    statistics = {0, 0};
+    mutex.unlock();
+}
+
+void ColourLEDAnimator::request(const state_t &next)
+{
+    mutex.lock();
+    const bool same = (next.animation == ANIMATION_STEADY && state.animation == ANIMATION_STEADY &&
+                       next.to.r == state.to.r && next.to.g == state.to.g && next.to.b == state.to.b);
+    if (!same)
+    {
+        // Only the latest request before the next frame is rendered
+        state = next;
+        changed = true;
+        statistics.requests++;
+    }
+    mutex.unlock();
+}
+
+void ColourLEDAnimator::update(void)
+{
+    mutex.lock();
+    if (!changed && state.animation == ANIMATION_STEADY)
+    {
+        mutex.unlock();
+        return; // Nothing moves, nothing to send
+    }
+    const rgb_t frame = render(millis());
+    changed = false;
+    const bool different = !shown_valid || frame.r != shown.r || frame.g != shown.g || frame.b != shown.b;
+    shown = frame;
+    shown_valid = true;
+    if (different)
+        statistics.frames++;
+    mutex.unlock();
+
+    // Only this thread drives the LED, so the bus transfer happens outside the lock
+    if (different)
+        led.setRGB(frame);
+}
+
+ColourLEDAnimator::rgb_t ColourLEDAnimator::render(uint32_t now)
+{
+    const uint32_t elapsed = now - state.start;
+
+    switch (state.animation)
+    {
+    case ANIMATION_FADE:
+        if (elapsed < state.on_time)
+            return interpolate(state.from, state.to, elapsed, state.on_time);
+        break;
+    case ANIMATION_BLINK:
+    {
+        const uint32_t period = uint32_t(state.on_time) + state.off_time;
+        if (period == 0)
+            break;
+        if (state.count != LED_BLINK_FOREVER && elapsed / period >= state.count)
+            break;
+        return (elapsed % period < state.on_time) ? state.from : state.to;
+    }
+    case ANIMATION_STEADY:
+    default:
+        return state.to;
+    }
+
+    // Fade or blink is over, hold the final colour
+    state.animation = ANIMATION_STEADY;
+    return state.to;
+}
+
+ColourLEDAnimator::rgb_t ColourLEDAnimator::interpolate(const rgb_t &from, const rgb_t &to, uint32_t position, uint32_t duration)
+{
+    // Fixed-point blend in Q8, no FPU on RP2040
+    const int32_t weight = (position << 8) / duration; // 0 - 255
+    return rgb_t(from.r + (((int32_t(to.r) - from.r) * weight) >> 8),
+                 from.g + (((int32_t(to.g) - from.g) * weight) >> 8),
+                 from.b + (((int32_t(to.b) - from.b) * weight) >> 8));
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+#include <mbed.h>
+
+#include "BuiltinColourLED.h"
+
+#define LED_UPDATE_RATE 50                     // Maximum number of LED updates per second
+#define LED_THREAD_STACK_SIZE 2048             // Stack of the animation thread in bytes
+#define LED_QUEUE_SIZE (4 * EVENTS_EVENT_SIZE) // Only the periodic update is ever queued
+#define LED_BLINK_FOREVER 0                    // Blink `count` that never stops
+
+/** Non-blocking colour, fade and blink animations for `BuiltinColourLED`.
+ * Requests only store the target, a timer thread renders the animation at `LED_UPDATE_RATE`
+ * and forwards it to the LED, which skips channels that did not change.
+ * LED bus traffic is therefore bounded by the update rate, no matter how often the colour is set.
+ * Once `begin()` was called, the LED must only be driven through this class.
+ * */
+class ColourLEDAnimator
+{
+public:
+    typedef BuiltinColourLED::rgb_t rgb_t;
+
+    typedef enum animation
+    {
+        ANIMATION_STEADY, // Constant colour
+        ANIMATION_FADE,   // Linear transition to a colour
+        ANIMATION_BLINK,  // Alternating between two colours
+    } animation_t;
+
+    typedef struct statistics
+    {
+        uint32_t requests; // Colour changes requested
+        uint32_t frames;   // Frames forwarded to the LED, the rest was coalesced or unchanged
+    } statistics_t;
+
+    // Constructor, `update_rate` in Hz
+    ColourLEDAnimator(BuiltinColourLED &led, uint16_t update_rate = LED_UPDATE_RATE);
+
+    // Start the animation thread
+    void begin(void);
+
+    // Show a constant colour
+    void setRGB(const rgb_t &rgb);
+    void setRGB(uint8_t r, uint8_t g, uint8_t b);
+
+    // Fade from the colour currently shown to `rgb` within `duration` ms
+    void fadeTo(const rgb_t &rgb, uint16_t duration);
+
+    // Alternate between `on` for `on_time` ms and `off` for `off_time` ms, `count` times.
+    // Stays at `off` afterwards.
+    void blink(const rgb_t &on, const rgb_t &off, uint16_t on_time, uint16_t off_time, uint16_t count = LED_BLINK_FOREVER);
+
+    // Check whether a fade or blink is still running
+    bool isAnimating(void);
+
+    // Get request and frame counters
+    statistics_t getStatistics(void);
+
+    // Reset the counters
+    void resetStatistics(void);
+
+private:
+    typedef struct state
+    {
+        animation_t animation; // What is being rendered
+        uint32_t start;        // `millis()` when the animation started
+        rgb_t from;            // Fade start colour, blink on colour
+        rgb_t to;              // Steady colour, fade end colour, blink off colour
+        uint16_t on_time;      // Fade duration, blink on time in ms
+        uint16_t off_time;     // Blink off time in ms
+        uint16_t count;        // Number of blinks
+    } state_t;
+
+    BuiltinColourLED &led;
+    const uint16_t update_rate;
+
+    // Thread stack and event storage live in the animator instead of the heap
+    alignas(8) unsigned char thread_stack[LED_THREAD_STACK_SIZE];
+    unsigned char queue_buffer[LED_QUEUE_SIZE];
+
+    rtos::Thread thread;
+    events::EventQueue queue;
+    rtos::Mutex mutex; // Guards everything below, requests come from the main thread
+
+    state_t state;
+    rgb_t shown;      // Last rendered colour
+    bool shown_valid; // `shown` was written to the LED, the first frame always is
+    bool changed;     // A request arrived since the last frame
+    statistics_t statistics;
+
+    // Replace the running animation
+    void request(const state_t &next);
+
+    // Render the current frame, runs on the animation thread
+    void update(void);
+
+    // Colour of `state` at `now`, finishes it when it is over
+    rgb_t render(uint32_t now);
+
+    // Linear interpolation, `position` of `duration`
+    static rgb_t interpolate(const rgb_t &from, const rgb_t &to, uint32_t position, uint32_t duration);
+};
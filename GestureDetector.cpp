@@ -0,0 +1,128 @@
+#include "GestureDetector.h" // Include the header file for GestureDetector class
+
+GestureDetector::GestureDetector(size_t num_gestures, size_t idle_index)
+    : num_gestures(num_gestures), idle_index(idle_index)
+{
+    enter_threshold = GESTURE_ENTER_THRESHOLD;
+    exit_threshold = GESTURE_EXIT_THRESHOLD;
+    debounce_count = GESTURE_DEBOUNCE_COUNT;
+    refractory_period = GESTURE_REFRACTORY_PERIOD;
+
+    active = GESTURE_NONE;
+    active_since = 0;
+    candidate = GESTURE_NONE;
+    candidate_count = 0;
+    last_end = 0;
+    ended_once = false;
+
+    num_callbacks = 0; // No subscribers yet
+}
+
+bool GestureDetector::update(const float *scores, uint32_t timestamp)
+{
+    if (active != GESTURE_NONE)
+    {
+        // Hysteresis: hold the gesture until it falls below the (lower) exit threshold
+        if (scores[active] >= exit_threshold)
+            return false;
+        const size_t gesture = active;
+        emit(GESTURE_END, gesture, timestamp, scores[gesture]);
+        active = GESTURE_NONE;
+        last_end = timestamp;
+        ended_once = true;
+        return true;
+    }
+
+    // Best non-idle gesture
+    int best = GESTURE_NONE;
+    for (size_t i = 0; i < num_gestures; i++)
+        if (i != idle_index && (best == GESTURE_NONE || scores[i] > scores[best]))
+            best = i;
+
+    const bool refractory = ended_once && (timestamp - last_end < refractory_period);
+    if (best == GESTURE_NONE || scores[best] < enter_threshold || refractory)
+    {
+        candidate = GESTURE_NONE;
+        candidate_count = 0;
+        return false;
+    }
+
+    // Debounce: the same gesture has to win several inferences in a row
+    if (best != candidate)
+    {
+        candidate = best;
+        candidate_count = 0;
+    }
+    if (++candidate_count < debounce_count)
+        return false;
+
+    active = best;
+    active_since = timestamp;
+    candidate = GESTURE_NONE;
+    candidate_count = 0;
+    emit(GESTURE_BEGIN, active, timestamp, scores[active]);
+    return true;
+}
+
+void GestureDetector::reset(uint32_t timestamp)
+{
+    if (active != GESTURE_NONE)
+    {
+        const size_t gesture = active;
+        emit(GESTURE_END, gesture, timestamp, 0.0f);
+        active = GESTURE_NONE;
+        last_end = timestamp;
+        ended_once = true;
+    }
+    candidate = GESTURE_NONE;
+    candidate_count = 0;
+}
+
+void GestureDetector::setNumGestures(size_t num_gestures, uint32_t timestamp)
+{
+    reset(timestamp);
+    this->num_gestures = num_gestures;
+}
+
+int GestureDetector::getActiveGesture(void) const
+{
+    return active;
+}
+
+void GestureDetector::setThresholds(float enter, float exit)
+{
+    enter_threshold = enter;
+    exit_threshold = std::min(exit, enter);
+}
+
+void GestureDetector::setDebounceCount(uint8_t count)
+{
+    debounce_count = count ? count : 1;
+}
+
+void GestureDetector::setRefractoryPeriod(uint32_t period)
+{
+    refractory_period = period;
+}
+
+bool GestureDetector::registerEventCallback(event_callback_t callback)
+{
+    if (num_callbacks >= GESTURE_MAX_CALLBACKS)
+        return false; // No free slot
+    callbacks[num_callbacks++] = callback; // Register event callback function
+    return true;
+}
+
+void GestureDetector::emit(event_type_t type, size_t gesture, uint32_t timestamp, float score)
+{
+    gesture_event_t event;
+    event.type = type;
+    event.gesture = gesture;
+    event.timestamp = timestamp;
+    event.duration = (type == GESTURE_END) ? timestamp - active_since : 0;
+    event.score = score;
+
+    for (size_t i = 0; i < num_callbacks; i++)
+        if (callbacks[i])
+            callbacks[i](event);
+}
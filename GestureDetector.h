@@ -0,0 +1,84 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+#define GESTURE_ENTER_THRESHOLD 0.80f // Score a gesture needs to begin
+#define GESTURE_EXIT_THRESHOLD 0.60f  // Score below which an active gesture ends, lower than the enter threshold for hysteresis
+#define GESTURE_DEBOUNCE_COUNT 2      // Consecutive inferences above the enter threshold before a gesture begins
+#define GESTURE_REFRACTORY_PERIOD 300 // Time in ms after a gesture ended before the next one can begin
+#define GESTURE_IDLE_INDEX 0          // Background class, never reported as a gesture
+#define GESTURE_MAX_CALLBACKS 4       // Maximum number of subscribers
+#define GESTURE_NONE (-1)             // No gesture active
+
+/** Turns the stream of inference scores into discrete gesture events.
+ * A gesture begins once its score stayed at or above the enter threshold for the debounce count
+ * and the refractory period since the previous gesture has passed.
+ * It ends as soon as its score drops below the exit threshold.
+ * Subscribers are only called on these transitions, not on every inference.
+ * */
+class GestureDetector
+{
+public:
+    typedef enum event_type
+    {
+        GESTURE_BEGIN, // A gesture was recognized
+        GESTURE_END,   // The active gesture is over
+    } event_type_t;
+
+    typedef struct gesture_event
+    {
+        event_type_t type;  // Transition
+        size_t gesture;     // Index into `gestures[]`
+        uint32_t timestamp; // Time of the transition in ms
+        uint32_t duration;  // Time since the gesture began in ms, 0 for GESTURE_BEGIN
+        float score;        // Score of the gesture at the transition
+    } gesture_event_t;
+
+    typedef std::function<void(const gesture_event_t &)> event_callback_t;
+
+    // Constructor, `num_gestures` scores are expected per inference
+    GestureDetector(size_t num_gestures, size_t idle_index = GESTURE_IDLE_INDEX);
+
+    // Feed the scores of one inference. Returns true if an event was emitted.
+    bool update(const float *scores, uint32_t timestamp);
+
+    // End an active gesture and clear the debounce state
+    void reset(uint32_t timestamp);
+
+    // Index of the active gesture or GESTURE_NONE
+    int getActiveGesture(void) const;
+
+    // Change the number of scores per inference, e.g. after a model switch. Ends an active gesture.
+    void setNumGestures(size_t num_gestures, uint32_t timestamp);
+
+    // Configure the detection, `exit` is clamped to at most `enter`
+    void setThresholds(float enter, float exit);
+    void setDebounceCount(uint8_t count);
+    void setRefractoryPeriod(uint32_t period);
+
+    // Subscribe to gesture events. Returns false if all slots are taken.
+    bool registerEventCallback(event_callback_t callback);
+
+private:
+    size_t num_gestures;
+    const size_t idle_index;
+
+    float enter_threshold;
+    float exit_threshold;
+    uint8_t debounce_count;
+    uint32_t refractory_period;
+
+    int active;              // Active gesture or GESTURE_NONE
+    uint32_t active_since;   // Time the active gesture began
+    int candidate;           // Gesture above the enter threshold that is being debounced
+    uint8_t candidate_count; // Consecutive inferences `candidate` has won
+    uint32_t last_end;       // Time the previous gesture ended
+    bool ended_once;         // Whether `last_end` is valid
+
+    event_callback_t callbacks[GESTURE_MAX_CALLBACKS];
+    size_t num_callbacks;
+
+    void emit(event_type_t type, size_t gesture, uint32_t timestamp, float score);
+};
@@ -0,0 +1,408 @@
+#include "InterleavedFullyConnected.h" // Include the header file for InterleavedFullyConnected class
+
+#include <tensorflow/lite/micro/kernels/kernel_util.h>
+#include <tensorflow/lite/micro/micro_context.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+
+#include <math.h>
+
+#define INTERLEAVED_FC_INPUT 0   // Input index of the activations
+#define INTERLEAVED_FC_WEIGHTS 1 // Input index of the interleaved weights
+#define INTERLEAVED_FC_BIAS 2    // Input index of the optional bias
+#define INTERLEAVED_FC_PALETTE 3 // Input index of the palette, palette formats only
+#define INTERLEAVED_FC_OUTPUT 0  // Output index
+
+typedef struct interleaved_fc_data
+{
+    uint8_t block;        // Interleaved output rows, 0 if the options cannot be run
+    uint8_t format;       // One of the INTERLEAVED_FC_ weight formats
+    float activation_min; // Fused activation as a clamp
+    float activation_max;
+    const float *scales;  // Scale of every output row, int8 only
+    const float *palette; // Values of the weight indices, palette formats only
+    int scratch_index;    // Quantized input, INTERLEAVED_FC_INT8_INPUT only
+} interleaved_fc_data_t;
+
+// Weight formats, `expand()` turns the stored weight of an interleaved row into a float. Packed formats hold the
+// weights of `packed` consecutive rows per element. Scaled formats multiply every output row by its scale.
+struct Float32Weights
+{
+    typedef float storage_t;
+    static const int packed = 1;
+    static const bool scaled = false;
+    static inline float expand(const interleaved_fc_data_t &, float weight, int) { return weight; }
+};
+
+struct Float16Weights
+{
+    typedef uint16_t storage_t;
+    static const int packed = 1;
+    static const bool scaled = false;
+    static inline float expand(const interleaved_fc_data_t &, uint16_t weight, int)
+    {
+        const uint32_t sign = uint32_t(weight & 0x8000) << 16;
+        uint32_t exponent = (weight >> 10) & 0x1F;
+        uint32_t mantissa = weight & 0x3FF;
+        uint32_t bits;
+        if (exponent == 0x1F)
+            bits = sign | 0x7F800000 | (mantissa << 13); // Infinity or NaN
+        else if (exponent != 0)
+            bits = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        else if (mantissa == 0)
+            bits = sign;
+        else
+        {
+            // Subnormal, normalize the mantissa
+            exponent = 127 - 14;
+            while (!(mantissa & 0x400))
+            {
+                mantissa <<= 1;
+                exponent--;
+            }
+            bits = sign | (exponent << 23) | ((mantissa & 0x3FF) << 13);
+        }
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+struct BFloat16Weights
+{
+    typedef uint16_t storage_t;
+    static const int packed = 1;
+    static const bool scaled = false;
+    static inline float expand(const interleaved_fc_data_t &, uint16_t weight, int)
+    {
+        const uint32_t bits = uint32_t(weight) << 16;
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+};
+
+struct Int8Weights
+{
+    typedef int8_t storage_t;
+    static const int packed = 1;
+    static const bool scaled = true;
+    static inline float expand(const interleaved_fc_data_t &, int8_t weight, int) { return float(weight); }
+};
+
+struct Palette8Weights
+{
+    typedef uint8_t storage_t;
+    static const int packed = 1;
+    static const bool scaled = false;
+    static inline float expand(const interleaved_fc_data_t &data, uint8_t weight, int) { return data.palette[weight]; }
+};
+
+struct Palette4Weights
+{
+    typedef uint8_t storage_t;
+    static const int packed = 2;
+    static const bool scaled = false;
+    static inline float expand(const interleaved_fc_data_t &data, uint8_t weights, int row)
+    {
+        return data.palette[(row & 1) ? (weights >> 4) : (weights & 0x0F)];
+    }
+};
+
+// Accumulate `BLOCK` output rows per pass over the input, the weights are consumed strictly in order
+template <int BLOCK, typename WEIGHTS>
+static void InterleavedRows(const interleaved_fc_data_t &data, const float *input, const typename WEIGHTS::storage_t *weights,
+                            const float *bias, float *output, int batches, int depth, int units)
+{
+    for (int batch = 0; batch < batches; batch++)
+    {
+        const typename WEIGHTS::storage_t *block_weights = weights; // Every batch reads all weights again
+        for (int unit = 0; unit < units; unit += BLOCK)
+        {
+            float total[BLOCK] = {};
+            for (int d = 0; d < depth; d++)
+            {
+                const float value = input[d];
+                for (int row = 0; row < BLOCK; row++)
+                    total[row] += value * WEIGHTS::expand(data, block_weights[row / WEIGHTS::packed], row);
+                block_weights += BLOCK / WEIGHTS::packed;
+            }
+
+            // Same order as the reference kernel: sum, then bias, then activation. Padding rows are dropped.
+            const int rows = std::min(BLOCK, units - unit);
+            for (int row = 0; row < rows; row++)
+            {
+                const float sum = WEIGHTS::scaled ? total[row] * data.scales[unit + row] : total[row];
+                const float value = sum + (bias ? bias[unit + row] : 0.0f);
+                output[unit + row] = std::min(std::max(value, data.activation_min), data.activation_max);
+            }
+        }
+        input += depth;
+        output += units;
+    }
+}
+
+// One unrolled loop per block size, checked in prepare
+template <typename WEIGHTS>
+static TfLiteStatus InterleavedBlocks(const interleaved_fc_data_t &data, const float *input, const void *weights, const float *bias,
+                                      float *output, int batches, int depth, int units)
+{
+    const typename WEIGHTS::storage_t *stored = static_cast<const typename WEIGHTS::storage_t *>(weights);
+    switch (data.block)
+    {
+    case 1:
+        InterleavedRows<1, WEIGHTS>(data, input, stored, bias, output, batches, depth, units);
+        break;
+    case 2:
+        InterleavedRows<2, WEIGHTS>(data, input, stored, bias, output, batches, depth, units);
+        break;
+    case 4:
+        InterleavedRows<4, WEIGHTS>(data, input, stored, bias, output, batches, depth, units);
+        break;
+    case 8:
+        InterleavedRows<8, WEIGHTS>(data, input, stored, bias, output, batches, depth, units);
+        break;
+    default:
+        return kTfLiteError;
+    }
+    return kTfLiteOk;
+}
+
+// int8 weights and input: quantize each input row, accumulate `BLOCK` integer dot products per pass, scale once per output
+template <int BLOCK>
+static void InterleavedQuantizedRows(const interleaved_fc_data_t &data, const float *input, const int8_t *weights, const float *bias,
+                                  float *output, int8_t *quantized, int batches, int depth, int units)
+{
+    for (int batch = 0; batch < batches; batch++)
+    {
+        // Symmetric quantization of the input, rounded half away from zero like TFLite
+        float largest = 0.0f;
+        for (int d = 0; d < depth; d++)
+            largest = std::max(largest, fabsf(input[d]));
+        const float input_scale = largest / 127.0f;
+        const float inverse = (largest > 0.0f) ? 127.0f / largest : 0.0f;
+        for (int d = 0; d < depth; d++)
+        {
+            const int32_t value = int32_t(input[d] * inverse + ((input[d] >= 0.0f) ? 0.5f : -0.5f));
+            quantized[d] = int8_t(std::min<int32_t>(std::max<int32_t>(value, -127), 127));
+        }
+
+        const int8_t *block_weights = weights; // Every batch reads all weights again
+        for (int unit = 0; unit < units; unit += BLOCK)
+        {
+            int32_t total[BLOCK] = {};
+            for (int d = 0; d < depth; d++)
+            {
+                const int32_t value = quantized[d];
+                for (int row = 0; row < BLOCK; row++)
+                    total[row] += value * block_weights[row];
+                block_weights += BLOCK;
+            }
+
+            const int rows = std::min(BLOCK, units - unit);
+            for (int row = 0; row < rows; row++)
+            {
+                const float value = float(total[row]) * (input_scale * data.scales[unit + row]) + (bias ? bias[unit + row] : 0.0f);
+                output[unit + row] = std::min(std::max(value, data.activation_min), data.activation_max);
+            }
+        }
+        input += depth;
+        output += units;
+    }
+}
+
+static TfLiteStatus InterleavedQuantizedBlocks(const interleaved_fc_data_t &data, const float *input, const int8_t *weights, const float *bias,
+                                               float *output, int8_t *quantized, int batches, int depth, int units)
+{
+    switch (data.block)
+    {
+    case 1:
+        InterleavedQuantizedRows<1>(data, input, weights, bias, output, quantized, batches, depth, units);
+        break;
+    case 2:
+        InterleavedQuantizedRows<2>(data, input, weights, bias, output, quantized, batches, depth, units);
+        break;
+    case 4:
+        InterleavedQuantizedRows<4>(data, input, weights, bias, output, quantized, batches, depth, units);
+        break;
+    case 8:
+        InterleavedQuantizedRows<8>(data, input, weights, bias, output, quantized, batches, depth, units);
+        break;
+    default:
+        return kTfLiteError;
+    }
+    return kTfLiteOk;
+}
+
+// Copy the row scales of the int8 weights out of their quantization parameters and reserve the quantized input
+static TfLiteStatus InterleavedInt8Prepare(TfLiteContext *context, TfLiteNode *node, interleaved_fc_data_t *data, int depth, int units)
+{
+    tflite::MicroContext *micro_context = tflite::GetMicroContext(context);
+    TfLiteTensor *weights = micro_context->AllocateTempInputTensor(node, INTERLEAVED_FC_WEIGHTS);
+    if (weights == nullptr)
+        return kTfLiteError;
+    const TfLiteAffineQuantization *quantization = static_cast<const TfLiteAffineQuantization *>(weights->quantization.params);
+    const int num_scales = (weights->quantization.type == kTfLiteAffineQuantization && quantization && quantization->scale) ? quantization->scale->size : 0;
+
+    // One scale per row (padding included), or one for the whole tensor
+    float *scales = nullptr;
+    if (num_scales == 1 || num_scales >= units)
+        scales = static_cast<float *>(context->AllocatePersistentBuffer(context, units * sizeof(float)));
+    if (scales != nullptr)
+        for (int unit = 0; unit < units; unit++)
+            scales[unit] = quantization->scale->data[(num_scales == 1) ? 0 : unit];
+    micro_context->DeallocateTempTfLiteTensor(weights);
+    if (scales == nullptr)
+        return kTfLiteError;
+
+    data->scales = scales;
+    if (data->format != INTERLEAVED_FC_INT8_INPUT)
+        return kTfLiteOk;
+    return context->RequestScratchBufferInArena(context, depth, &data->scratch_index);
+}
+
+// Tensor type holding the weights of a format
+static TfLiteType InterleavedWeightsType(uint8_t format)
+{
+    switch (format)
+    {
+    case INTERLEAVED_FC_FLOAT32:
+        return kTfLiteFloat32;
+    case INTERLEAVED_FC_FLOAT16:
+        return kTfLiteFloat16;
+    case INTERLEAVED_FC_BFLOAT16:
+        return kTfLiteInt16;
+    case INTERLEAVED_FC_INT8:
+    case INTERLEAVED_FC_INT8_INPUT:
+        return kTfLiteInt8;
+    case INTERLEAVED_FC_PALETTE8:
+    case INTERLEAVED_FC_PALETTE4:
+        return kTfLiteUInt8;
+    default:
+        return kTfLiteNoType;
+    }
+}
+
+static void *InterleavedFullyConnectedInit(TfLiteContext *context, const char *buffer, size_t length)
+{
+    interleaved_fc_data_t *data = static_cast<interleaved_fc_data_t *>(context->AllocatePersistentBuffer(context, sizeof(interleaved_fc_data_t)));
+    if (data == nullptr)
+        return nullptr;
+
+    data->block = (buffer != nullptr && length >= 2) ? uint8_t(buffer[0]) : 0;
+    data->format = (buffer != nullptr && length >= 3) ? uint8_t(buffer[2]) : INTERLEAVED_FC_FLOAT32;
+    data->scales = nullptr;
+    data->palette = nullptr;
+    data->scratch_index = -1;
+    data->activation_min = -INFINITY;
+    data->activation_max = INFINITY;
+    switch ((buffer != nullptr && length >= 2) ? uint8_t(buffer[1]) : uint8_t(tflite::ActivationFunctionType_NONE))
+    {
+    case tflite::ActivationFunctionType_NONE:
+        break;
+    case tflite::ActivationFunctionType_RELU:
+        data->activation_min = 0.0f;
+        break;
+    case tflite::ActivationFunctionType_RELU_N1_TO_1:
+        data->activation_min = -1.0f;
+        data->activation_max = 1.0f;
+        break;
+    case tflite::ActivationFunctionType_RELU6:
+        data->activation_min = 0.0f;
+        data->activation_max = 6.0f;
+        break;
+    default:
+        data->block = 0; // Not a clamp, prepare fails
+        break;
+    }
+    return data;
+}
+
+static TfLiteStatus InterleavedFullyConnectedPrepare(TfLiteContext *context, TfLiteNode *node)
+{
+    interleaved_fc_data_t *data = static_cast<interleaved_fc_data_t *>(node->user_data);
+    if (data == nullptr || data->block == 0 || data->block > INTERLEAVED_FC_MAX_BLOCK || (data->block & (data->block - 1)))
+        return kTfLiteError;
+    if (node->inputs->size <= INTERLEAVED_FC_WEIGHTS || node->outputs->size != 1)
+        return kTfLiteError;
+
+    const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, INTERLEAVED_FC_INPUT);
+    const TfLiteEvalTensor *weights = tflite::micro::GetEvalInput(context, node, INTERLEAVED_FC_WEIGHTS);
+    const TfLiteEvalTensor *bias = (node->inputs->size > INTERLEAVED_FC_BIAS) ? tflite::micro::GetEvalInput(context, node, INTERLEAVED_FC_BIAS) : nullptr;
+    const TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, INTERLEAVED_FC_OUTPUT);
+    if (input == nullptr || weights == nullptr || output == nullptr)
+        return kTfLiteError;
+    if (input->type != kTfLiteFloat32 || weights->type != InterleavedWeightsType(data->format) || output->type != kTfLiteFloat32)
+        return kTfLiteError;
+    if (weights->dims->size != 2 || output->dims->size == 0)
+        return kTfLiteError;
+
+    // Weights hold the output rows padded to whole blocks, two per byte for 4 bit indices
+    const int packed = (data->format == INTERLEAVED_FC_PALETTE4) ? 2 : 1;
+    const int depth = weights->dims->data[1];
+    const int units = output->dims->data[output->dims->size - 1];
+    const int padded = (units + data->block - 1) / data->block * data->block;
+    if (depth == 0 || data->block % packed != 0 || weights->dims->data[0] != padded / packed)
+        return kTfLiteError;
+    const int input_size = tflite::micro::ElementCount(*input->dims);
+    if (input_size % depth != 0 || tflite::micro::ElementCount(*output->dims) != input_size / depth * units)
+        return kTfLiteError;
+    if (bias != nullptr && (bias->type != kTfLiteFloat32 || tflite::micro::ElementCount(*bias->dims) != units))
+        return kTfLiteError;
+    if (data->format == INTERLEAVED_FC_INT8 || data->format == INTERLEAVED_FC_INT8_INPUT)
+        return InterleavedInt8Prepare(context, node, data, depth, units);
+    if (data->format == INTERLEAVED_FC_PALETTE8 || data->format == INTERLEAVED_FC_PALETTE4)
+    {
+        // Every index has an entry, the palette is constant and stays where the model keeps it
+        const TfLiteEvalTensor *palette = (node->inputs->size > INTERLEAVED_FC_PALETTE) ? tflite::micro::GetEvalInput(context, node, INTERLEAVED_FC_PALETTE) : nullptr;
+        const int entries = (data->format == INTERLEAVED_FC_PALETTE4) ? 16 : 256;
+        if (palette == nullptr || palette->type != kTfLiteFloat32 || tflite::micro::ElementCount(*palette->dims) != entries)
+            return kTfLiteError;
+        data->palette = tflite::micro::GetTensorData<float>(palette);
+    }
+    return kTfLiteOk;
+}
+
+static TfLiteStatus InterleavedFullyConnectedEval(TfLiteContext *context, TfLiteNode *node)
+{
+    const interleaved_fc_data_t &data = *static_cast<const interleaved_fc_data_t *>(node->user_data);
+    const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, INTERLEAVED_FC_INPUT);
+    const TfLiteEvalTensor *weights = tflite::micro::GetEvalInput(context, node, INTERLEAVED_FC_WEIGHTS);
+    const TfLiteEvalTensor *bias = (node->inputs->size > INTERLEAVED_FC_BIAS) ? tflite::micro::GetEvalInput(context, node, INTERLEAVED_FC_BIAS) : nullptr;
+    TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, INTERLEAVED_FC_OUTPUT);
+
+    const int depth = weights->dims->data[1];
+    const int units = output->dims->data[output->dims->size - 1];
+    const int batches = tflite::micro::ElementCount(*input->dims) / depth;
+    const float *input_data = tflite::micro::GetTensorData<float>(input);
+    const void *weights_data = weights->data.data;
+    const float *bias_data = bias ? tflite::micro::GetTensorData<float>(bias) : nullptr;
+    float *output_data = tflite::micro::GetTensorData<float>(output);
+
+    switch (data.format)
+    {
+    case INTERLEAVED_FC_FLOAT16:
+        return InterleavedBlocks<Float16Weights>(data, input_data, weights_data, bias_data, output_data, batches, depth, units);
+    case INTERLEAVED_FC_BFLOAT16:
+        return InterleavedBlocks<BFloat16Weights>(data, input_data, weights_data, bias_data, output_data, batches, depth, units);
+    case INTERLEAVED_FC_INT8:
+        return InterleavedBlocks<Int8Weights>(data, input_data, weights_data, bias_data, output_data, batches, depth, units);
+    case INTERLEAVED_FC_PALETTE8:
+        return InterleavedBlocks<Palette8Weights>(data, input_data, weights_data, bias_data, output_data, batches, depth, units);
+    case INTERLEAVED_FC_PALETTE4:
+        return InterleavedBlocks<Palette4Weights>(data, input_data, weights_data, bias_data, output_data, batches, depth, units);
+    case INTERLEAVED_FC_INT8_INPUT:
+        return InterleavedQuantizedBlocks(data, input_data, static_cast<const int8_t *>(weights_data), bias_data, output_data,
+                                          static_cast<int8_t *>(context->GetScratchBuffer(context, data.scratch_index)), batches, depth, units);
+    default:
+        return InterleavedBlocks<Float32Weights>(data, input_data, weights_data, bias_data, output_data, batches, depth, units);
+    }
+}
+
+InterleavedFullyConnected::registration_t InterleavedFullyConnected::registration(void)
+{
+    registration_t registration = {};
+    registration.init = InterleavedFullyConnectedInit;
+    registration.prepare = InterleavedFullyConnectedPrepare;
+    registration.invoke = InterleavedFullyConnectedEval;
+    return registration;
+}
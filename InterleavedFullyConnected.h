@@ -0,0 +1,50 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <TensorFlowLite.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+
+#define INTERLEAVED_FC_NAME "FC_INTERLEAVED" // Custom operator written by `tools/weight_relayout.py`
+#define INTERLEAVED_FC_MAX_BLOCK 8           // Largest number of interleaved output rows
+
+#define INTERLEAVED_FC_FLOAT32 0    // Weights stored as float32
+#define INTERLEAVED_FC_FLOAT16 1    // Weights stored as IEEE half precision, FLOAT16 tensor
+#define INTERLEAVED_FC_BFLOAT16 2   // Weights stored as the upper half of a float32, INT16 tensor of the raw bits
+#define INTERLEAVED_FC_INT8 3       // Symmetric int8 weights with a scale per output row, INT8 tensor
+#define INTERLEAVED_FC_INT8_INPUT 4 // The same weights, the input is quantized to int8 as well
+#define INTERLEAVED_FC_PALETTE8 5   // 8 bit indices into a palette of 256 floats, UINT8 tensor
+#define INTERLEAVED_FC_PALETTE4 6   // 4 bit indices into a palette of 16 floats, two rows per byte, UINT8 tensor
+
+/** FULLY_CONNECTED on weights relaid out by `tools/weight_relayout.py`.
+ * TFLite stores dense weights row-major as [out, in], so the reference kernel walks the input once per output row.
+ * The relayout interleaves blocks of B output rows as [out / B][in][B]: a single pass over the input feeds B accumulators
+ * and the weights are read once per inference, front to back without a jump, which is the pattern the XIP cache and
+ * the QSPI flash stream best. Rows are padded with zeros up to a multiple of B.
+ * Inputs and output are those of the float FULLY_CONNECTED: input, weights [padded out, in], optional bias [out].
+ * The custom options are [block: u8] [activation: u8] [format: u8], the activation being the fused
+ * ActivationFunctionType of the original layer. B is 1, 2, 4 or 8.
+ * The optional format stores the weights in 16 bits, which halves their flash footprint and the bytes fetched
+ * over QSPI per inference. They are expanded to float one at a time inside the loop, activations and the bias stay
+ * float32. bfloat16 expands with a shift, float16 keeps 3 more mantissa bits for a few integer operations.
+ * TFLM has no BFLOAT16 tensors, so bfloat16 weights travel as the raw bits in an INT16 tensor.
+ * int8 weights are symmetric with a scale per row, the per-channel quantization of the weight tensor (zero points 0).
+ * The dot product runs on the float input and the scale is applied once per row: out = w_scale[row] * sum(in * q_w) + bias.
+ * INTERLEAVED_FC_INT8_INPUT quantizes the input symmetrically to int8 on every evaluation as well, into a scratch buffer
+ * of the arena, like the dynamic range kernels of TFLite. The dot products then run on integers:
+ * out = in_scale * w_scale[row] * sum(q_in * q_w) + bias. A single input scale suits hidden activations, not an input
+ * that mixes features of different ranges.
+ * The palette formats store an index per weight into a palette of the layer, the float32 input 3 (the bias input
+ * has to be present, -1 without a bias). Indices are expanded through the palette inside the loop, so the layer is
+ * decompressed while it streams and needs no scratch buffer. 8 bit indices keep a quarter of the float32 size,
+ * 4 bit ones an eighth, packed two rows per byte with the even row in the low nibble: the tensor is [padded out / 2, in]
+ * and B at least 2. A palette of 16 entries only keeps the accuracy of models clustered while training.
+ * */
+class InterleavedFullyConnected
+{
+public:
+    typedef decltype(tflite::Register_FULLY_CONNECTED()) registration_t; // TfLiteRegistration or TFLMRegistration, depending on the TFLM version
+
+    // Kernel of the FC_INTERLEAVED custom operator, add it with `AddCustom(INTERLEAVED_FC_NAME, ...)`
+    static registration_t registration(void);
+};
@@ -0,0 +1,63 @@
+#include "InternalFlash.h" // Include the header file for InternalFlash class
+
+InternalFlash::InternalFlash(uint32_t offset, uint32_t size)
+{
+    this->offset = offset;    // Region start from the beginning of the flash
+    this->region_size = size; // Region size
+    start = 0;                // Set by `begin()`
+}
+
+bool InternalFlash::begin(void)
+{
+    if (flash.init() != 0)
+        return false;
+    if (uint64_t(offset) + region_size > flash.get_flash_size())
+        return false;
+
+    start = flash.get_flash_start() + offset;
+    if (start % flash.get_sector_size(start) != 0 || region_size % flash.get_sector_size(start) != 0)
+    {
+        start = 0;
+        return false;
+    }
+    return true;
+}
+
+size_t InternalFlash::size(void) const
+{
+    return start ? region_size : 0;
+}
+
+size_t InternalFlash::sectorSize(void) const
+{
+    return start ? flash.get_sector_size(start) : 1;
+}
+
+size_t InternalFlash::pageSize(void) const
+{
+    return start ? flash.get_page_size() : 1;
+}
+
+uint8_t InternalFlash::eraseValue(void) const
+{
+    return flash.get_erase_value();
+}
+
+const uint8_t *InternalFlash::data(void) const
+{
+    return reinterpret_cast<const uint8_t *>(start);
+}
+
+int InternalFlash::erase(size_t offset, size_t length)
+{
+    if (!start || offset + length > region_size)
+        return -1;
+    return flash.erase(start + offset, length);
+}
+
+int InternalFlash::program(size_t offset, const void *data, size_t length)
+{
+    if (!start || offset + length > region_size)
+        return -1;
+    return flash.program(data, start + offset, length);
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <mbed.h>
+
+#include "ModelStore.h"
+
+/** A region of the on-board QSPI flash through `mbed::FlashIAP`.
+ * The flash is memory mapped (XIP), so the contents are read in place and a model runs straight from it.
+ * Erasing and programming stall every access to the flash, including code execution, for their duration.
+ * */
+class InternalFlash : public FlashRegion
+{
+public:
+    // Constructor, `offset` and `size` in bytes from the start of the flash, both sector aligned
+    InternalFlash(uint32_t offset, uint32_t size);
+
+    // Initialize the flash driver. Returns false if the region is not inside the flash.
+    bool begin(void);
+
+    size_t size(void) const override;
+    size_t sectorSize(void) const override;
+    size_t pageSize(void) const override;
+    uint8_t eraseValue(void) const override;
+    const uint8_t *data(void) const override;
+    int erase(size_t offset, size_t length) override;
+    int program(size_t offset, const void *data, size_t length) override;
+
+private:
+    mbed::FlashIAP flash;
+    uint32_t offset;
+    uint32_t region_size;
+    uint32_t start; // Address of the region, 0 before `begin()`
+};
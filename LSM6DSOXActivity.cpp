@@ -0,0 +1,126 @@
+#include "LSM6DSOXActivity.h" // Include the header file for LSM6DSOXActivity class
+
+LSM6DSOXActivity::LSM6DSOXActivity(LSM6DSOXRegisters &registers)
+    : registers(registers) // Register access, owned by the caller
+{
+    enabled = false;          // Detection is off until `enable()`
+    state = ACTIVITY_UNKNOWN; // Nothing read yet
+    state_since = 0;          // Time of the last state change
+    statistics = {0, 0, 0};   // Clear the counters
+    stateCallback = nullptr;  // Initialize the state callback as nullptr
+}
+
+LSM6DSOXActivity::activity_config_t LSM6DSOXActivity::defaultConfig(void)
+{
+    return {IMU_WAKE_UP_THRESHOLD, IMU_WAKE_UP_DURATION, IMU_SLEEP_DURATION, inactivity_mode_t(IMU_INACTIVITY_MODE), false};
+}
+
+bool LSM6DSOXActivity::enable(const activity_config_t &config)
+{
+    bool fine = false;
+    const uint8_t threshold = wakeUpThreshold(config.wake_up_threshold, IMU_ACCELEROMETER_SCALE, &fine);
+    const uint8_t wake_up_duration = constrain(config.wake_up_duration, 1, 4) - 1;
+    const uint8_t sleep_duration = sleepDuration(config.sleep_duration, IMU_SAMPLING_RATE);
+
+    // Non-latched, slope filter, sleep changes rather than the sleep state on the interrupt pin
+    bool ok = updateBits(IMU_REG_TAP_CFG0, IMU_TAP_CFG0_LIR | IMU_TAP_CFG0_SLOPE_FDS | IMU_TAP_CFG0_SLEEP_STATUS_ON_INT, 0);
+    ok = ok && updateBits(IMU_REG_WAKE_UP_THS, IMU_WAKE_UP_THS_WK_THS_MASK, threshold);
+    ok = ok && updateBits(IMU_REG_WAKE_UP_DUR, IMU_WAKE_UP_DUR_WAKE_DUR_MASK | IMU_WAKE_UP_DUR_WAKE_THS_W | IMU_WAKE_UP_DUR_SLEEP_DUR_MASK,
+                          (wake_up_duration << IMU_WAKE_UP_DUR_WAKE_DUR_SHIFT) | (fine ? IMU_WAKE_UP_DUR_WAKE_THS_W : 0) | sleep_duration);
+    ok = ok && updateBits(IMU_REG_MD1_CFG, IMU_MD1_CFG_INT1_SLEEP_CHANGE, config.route_to_int1 ? IMU_MD1_CFG_INT1_SLEEP_CHANGE : 0);
+
+    // Start the engine last, so it never runs with a half written configuration
+    ok = ok && updateBits(IMU_REG_TAP_CFG2, IMU_TAP_CFG2_INTERRUPTS_ENABLE | IMU_TAP_CFG2_INACT_EN_MASK,
+                          IMU_TAP_CFG2_INTERRUPTS_ENABLE | ((config.mode << IMU_TAP_CFG2_INACT_EN_SHIFT) & IMU_TAP_CFG2_INACT_EN_MASK));
+
+    enabled = ok;
+    state = ACTIVITY_UNKNOWN;
+    return ok;
+}
+
+bool LSM6DSOXActivity::disable(void)
+{
+    enabled = false;
+    state = ACTIVITY_UNKNOWN;
+    return updateBits(IMU_REG_TAP_CFG2, IMU_TAP_CFG2_INTERRUPTS_ENABLE | IMU_TAP_CFG2_INACT_EN_MASK, 0);
+}
+
+LSM6DSOXActivity::activity_state_t LSM6DSOXActivity::update(uint32_t now)
+{
+    if (!enabled)
+        return state;
+
+    uint8_t source = 0;
+    if (registers.readRegister(IMU_REG_WAKE_UP_SRC, &source) != 0)
+        return state; // Keep the last known state
+
+    const activity_state_t current = (source & IMU_WAKE_UP_SRC_SLEEP_STATE) ? ACTIVITY_INACTIVE : ACTIVITY_ACTIVE;
+    if (current == state)
+        return state;
+
+    if (current == ACTIVITY_INACTIVE)
+        statistics.sleeps++;
+    else if (state == ACTIVITY_INACTIVE)
+    {
+        statistics.wake_ups++;
+        statistics.inactive_ms += now - state_since;
+    }
+    state = current;
+    state_since = now;
+
+    if (stateCallback)
+        stateCallback(state);
+    return state;
+}
+
+LSM6DSOXActivity::activity_state_t LSM6DSOXActivity::getState(void) const
+{
+    return state;
+}
+
+bool LSM6DSOXActivity::isInactive(void) const
+{
+    return state == ACTIVITY_INACTIVE;
+}
+
+LSM6DSOXActivity::statistics_t LSM6DSOXActivity::getStatistics(void) const
+{
+    return statistics;
+}
+
+void LSM6DSOXActivity::resetStatistics(void)
+{
+    statistics = {0, 0, 0};
+}
+
+void LSM6DSOXActivity::registerStateCallback(const state_callback_t callback)
+{
+    stateCallback = callback; // Register state callback function
+}
+
+uint8_t LSM6DSOXActivity::wakeUpThreshold(uint16_t threshold, uint16_t full_scale, bool *fine)
+{
+    // One step is FS / 256 with WAKE_THS_W set, FS / 64 otherwise. Prefer the finer one while it reaches.
+    const uint32_t range = uint32_t(full_scale) * 1000; // mG
+    uint32_t steps = (uint32_t(threshold) * 256 + range / 2) / range;
+    *fine = steps <= IMU_WAKE_UP_THS_WK_THS_MASK;
+    if (!*fine)
+        steps = (uint32_t(threshold) * 64 + range / 2) / range;
+    return constrain(steps, 1, IMU_WAKE_UP_THS_WK_THS_MASK); // 0 would wake up on noise
+}
+
+uint8_t LSM6DSOXActivity::sleepDuration(uint32_t duration, float odr)
+{
+    // One step is 512 samples, 0 is 16 samples
+    const float step = 512000.0f / odr; // ms
+    const uint32_t steps = uint32_t(duration / step + 0.5f);
+    return (steps < IMU_WAKE_UP_DUR_SLEEP_DUR_MASK) ? steps : IMU_WAKE_UP_DUR_SLEEP_DUR_MASK;
+}
+
+bool LSM6DSOXActivity::updateBits(uint8_t reg, uint8_t mask, uint8_t value)
+{
+    uint8_t current = 0;
+    if (registers.readRegister(reg, &current) != 0)
+        return false;
+    return registers.writeRegister(reg, (current & ~mask) | (value & mask)) == 0;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+#include "LSM6DSOXConfig.h"
+
+// ---------------------------------------
+// LSM6DSOX embedded function registers used by the activity/inactivity engine, see the datasheet (DS12814) section 9.
+// Prefixed with IMU_ so they do not collide with the definitions of the sensor library.
+
+#define IMU_REG_ALL_INT_SRC 0x1A // Source of all interrupts
+#define IMU_REG_WAKE_UP_SRC 0x1B // Wake-up and sleep status
+#define IMU_REG_TAP_CFG0 0x56    // Latching, filter and sleep status routing
+#define IMU_REG_TAP_CFG2 0x58    // Interrupt enable and inactivity mode
+#define IMU_REG_WAKE_UP_THS 0x5B // Wake-up threshold
+#define IMU_REG_WAKE_UP_DUR 0x5C // Wake-up and sleep duration
+#define IMU_REG_MD1_CFG 0x5E     // Routing to the INT1 pin
+
+#define IMU_TAP_CFG0_LIR 0x01                 // Latch interrupt requests
+#define IMU_TAP_CFG0_SLOPE_FDS 0x10           // High-pass instead of slope filter for wake-up
+#define IMU_TAP_CFG0_SLEEP_STATUS_ON_INT 0x20 // Route the sleep state instead of sleep changes
+#define IMU_TAP_CFG2_INTERRUPTS_ENABLE 0x80   // Enable the embedded functions
+#define IMU_TAP_CFG2_INACT_EN_MASK 0x60       // Inactivity mode
+#define IMU_TAP_CFG2_INACT_EN_SHIFT 5
+#define IMU_WAKE_UP_THS_WK_THS_MASK 0x3F      // Wake-up threshold
+#define IMU_WAKE_UP_DUR_WAKE_DUR_MASK 0x60    // Wake-up duration
+#define IMU_WAKE_UP_DUR_WAKE_DUR_SHIFT 5
+#define IMU_WAKE_UP_DUR_WAKE_THS_W 0x10       // Wake-up threshold LSB is FS / 256 instead of FS / 64
+#define IMU_WAKE_UP_DUR_SLEEP_DUR_MASK 0x0F   // Sleep duration
+#define IMU_WAKE_UP_SRC_WU_IA 0x08            // Wake-up event
+#define IMU_WAKE_UP_SRC_SLEEP_STATE 0x10      // Sensor is in sleep (inactivity) state
+#define IMU_WAKE_UP_SRC_SLEEP_CHANGE_IA 0x40  // Activity or inactivity change
+#define IMU_MD1_CFG_INT1_WU 0x20              // Wake-up on INT1
+#define IMU_MD1_CFG_INT1_SLEEP_CHANGE 0x80    // Activity/inactivity change on INT1
+
+/** Register access of the sensor.
+ * Implemented by `LSM6DSOXFIFO` over I2C and by register-level stand-ins on the host.
+ * Both return 0 on success.
+ * */
+class LSM6DSOXRegisters
+{
+public:
+    virtual ~LSM6DSOXRegisters() = default;
+    virtual int readRegister(uint8_t reg, uint8_t *value) = 0;
+    virtual int writeRegister(uint8_t reg, uint8_t value) = 0;
+};
+
+/** Activity/inactivity detection of the LSM6DSOX.
+ * The sensor decides on its own when the board is at rest: once the acceleration (slope) stayed below the
+ * wake-up threshold for the sleep duration it enters the sleep state and lowers the accelerometer rate
+ * to 12.5 Hz, the first sample above the threshold wakes it up again.
+ * `update()` polls the state with a single register read.
+ * */
+class LSM6DSOXActivity
+{
+public:
+    typedef enum inactivity_mode
+    {
+        INACTIVITY_XL_LOW_POWER = 1,    // Accelerometer at 12.5 Hz, gyroscope unchanged
+        INACTIVITY_GYRO_SLEEP = 2,      // Accelerometer at 12.5 Hz, gyroscope in sleep mode
+        INACTIVITY_GYRO_POWER_DOWN = 3, // Accelerometer at 12.5 Hz, gyroscope powered down
+    } inactivity_mode_t;
+
+    typedef enum activity_state
+    {
+        ACTIVITY_UNKNOWN,  // Detection is not running
+        ACTIVITY_ACTIVE,   // Motion
+        ACTIVITY_INACTIVE, // Sensor is in the sleep state
+    } activity_state_t;
+
+    typedef struct activity_config
+    {
+        uint16_t wake_up_threshold; // Acceleration in mG that wakes the sensor up
+        uint8_t wake_up_duration;   // Samples above the threshold needed to wake up: 1 - 4
+        uint32_t sleep_duration;    // Time in ms below the threshold before the sleep state, rounded to the sensor steps
+        inactivity_mode_t mode;     // What the sensor powers down while inactive
+        bool route_to_int1;         // Also signal activity changes on the INT1 pin
+    } activity_config_t;
+
+    typedef struct statistics
+    {
+        uint32_t wake_ups;    // Transitions from ACTIVITY_INACTIVE to ACTIVITY_ACTIVE
+        uint32_t sleeps;      // Transitions to ACTIVITY_INACTIVE
+        uint32_t inactive_ms; // Time spent in ACTIVITY_INACTIVE, up to the last wake-up
+    } statistics_t;
+
+    typedef std::function<void(activity_state_t)> state_callback_t;
+
+    // Constructor, `registers` must outlive this object
+    LSM6DSOXActivity(LSM6DSOXRegisters &registers);
+
+    // Default configuration from `LSM6DSOXConfig.h`
+    static activity_config_t defaultConfig(void);
+
+    // Program the engine and start detection. Returns false if a register access failed.
+    bool enable(const activity_config_t &config);
+
+    // Stop detection, the accelerometer stays at its normal rate
+    bool disable(void);
+
+    // Poll the sensor state, `now` in ms. Returns the current state.
+    activity_state_t update(uint32_t now);
+
+    activity_state_t getState(void) const;
+    bool isInactive(void) const;
+
+    statistics_t getStatistics(void) const;
+    void resetStatistics(void);
+
+    // Register a callback for state changes
+    void registerStateCallback(state_callback_t callback);
+
+    // WK_THS for a threshold in mG at an accelerometer full scale in G, `fine` selects the FS / 256 LSB
+    static uint8_t wakeUpThreshold(uint16_t threshold, uint16_t full_scale, bool *fine);
+
+    // SLEEP_DUR for a duration in ms at an accelerometer rate in Hz, 0 is 16 samples
+    static uint8_t sleepDuration(uint32_t duration, float odr);
+
+private:
+    LSM6DSOXRegisters &registers;
+    bool enabled;
+    activity_state_t state;
+    uint32_t state_since; // Time of the last state change
+    statistics_t statistics;
+    state_callback_t stateCallback;
+
+    // Read-modify-write of the bits in `mask`
+    bool updateBits(uint8_t reg, uint8_t mask, uint8_t value);
+};
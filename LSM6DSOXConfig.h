@@ -10,3 +10,12 @@
 
 #define IMU_FIFO_TAG_GYROSCOPE 1     // Defines the FIFO tag to indicate that the FIFO stores gyroscope data.
 #define IMU_FIFO_TAG_ACCELEROMETER 2 // Defines the FIFO tag to indicate that the FIFO stores accelerometer data.
+
+// ---------------------------------------
+// Activity/inactivity detection of the sensor, see `LSM6DSOXActivity.h`.
+
+#define IMU_WAKE_UP_THRESHOLD 62      // Acceleration in mG (slope filtered) that counts as motion. Resolution is FS / 256 up to 63 steps, FS / 64 above.
+#define IMU_WAKE_UP_DURATION 1        // Samples above the threshold before the sensor wakes up: 1 - 4.
+#define IMU_SLEEP_DURATION 5000       // Time in ms without motion before the sensor reports inactivity. Steps are 512 samples (4.9 s at 104 Hz), up to 15 steps.
+#define IMU_INACTIVITY_MODE 1         // While inactive: 1 accelerometer at 12.5 Hz, 2 also gyroscope in sleep mode, 3 also gyroscope powered down.
+#define IMU_ACTIVITY_POLL_INTERVAL 20 // Minimum time in ms between two reads of the sleep state.
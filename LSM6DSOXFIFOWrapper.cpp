@@ -1,10 +1,20 @@
 #include "LSM6DSOXFIFOWrapper.h" // Include the header file for LSM6DSOX FIFO wrapper
 
+// Log a message, `format` must be a string literal so it can be tokenized
+#define IMU_LOG(format, ...) this->sendTokenizedLog(LOG_TOKEN(format), format, ##__VA_ARGS__)
+#define IMU_LOG_ERROR(format, ...) LOG_IF_ERROR(IMU_LOG(format, ##__VA_ARGS__))
+#define IMU_LOG_WARNING(format, ...) LOG_IF_WARNING(IMU_LOG(format, ##__VA_ARGS__))
+#define IMU_LOG_INFO(format, ...) LOG_IF_INFO(IMU_LOG(format, ##__VA_ARGS__))
+#define IMU_LOG_DEBUG(format, ...) LOG_IF_DEBUG(IMU_LOG(format, ##__VA_ARGS__))
+
 LSM6DSOXFIFO::LSM6DSOXFIFO(TwoWire &wire, uint8_t address)
-    : lsm6dsoxSensor(&wire, address) // Constructor initializes the sensor with the I2C wire and address
+    : lsm6dsoxSensor(&wire, address), // Constructor initializes the sensor with the I2C wire and address
+      activity(*this)                 // Activity engine uses the register access of this object
 {
-    logCallback = nullptr;       // Initialize the log callback as nullptr
-    dataReadyCallback = nullptr; // Initialize the data ready callback as nullptr
+    activity_polled = 0;            // Time of the last activity poll
+    logCallback = nullptr;          // Initialize the log callback as nullptr
+    tokenizedLogCallback = nullptr; // Initialize the tokenized log callback as nullptr
+    dataReadyCallback = nullptr;    // Initialize the data ready callback as nullptr
 }
 
 int LSM6DSOXFIFO::initialize(void)
@@ -15,20 +25,20 @@ int LSM6DSOXFIFO::initialize(void)
     // Enable gyroscope and accelerometer
     if (lsm6dsoxSensor.Enable_G() == LSM6DSOX_OK && lsm6dsoxSensor.Enable_X() != LSM6DSOX_OK)
     {
-        this->sendLog("Error in enabling accelerometer and gyroscope\n");
+        IMU_LOG_ERROR("Error in enabling accelerometer and gyroscope\n");
         return false; // Return failure
     }
-    this->sendLog("Success in enabling accelerometer and gyroscope\n");
+    IMU_LOG_INFO("Success in enabling accelerometer and gyroscope\n");
 
     // Read and check device ID to ensure correct sensor is connected
     uint8_t device_id;
     lsm6dsoxSensor.ReadID(&device_id);
     if (device_id != LSM6DSOX_ID)
     {
-        this->sendLog("Wrong ID (Read:%#02x Expect:%#02x) for LSM6DSOX sensor. Check device is plugged\n", device_id, LSM6DSOX_ID);
+        IMU_LOG_ERROR("Wrong ID (Read:%#02x Expect:%#02x) for LSM6DSOX sensor. Check device is plugged\n", device_id, LSM6DSOX_ID);
         return false; // Return failure
     }
-    this->sendLog("Success checking ID for LSM6DSOX sensor\n");
+    IMU_LOG_INFO("Success checking ID for LSM6DSOX sensor\n");
 
     // Set accelerometer scale. Available values are: 2, 4, 8, 16 G
     lsm6dsoxSensor.Set_X_FS(IMU_ACCELEROMETER_SCALE);
@@ -81,13 +91,70 @@ void LSM6DSOXFIFO::update(void)
 
     if (fifo_full)
     {
-        this->sendLog("-- FIFO is full! Consider reducing Watermark Level or Buffer Data Rate.\n");
-        this->sendLog("Flushing data from FIFO.\n");
-        lsm6dsoxSensor.Set_FIFO_Mode(LSM6DSOX_BYPASS_MODE); // Flush FIFO data
-        lsm6dsoxSensor.Set_FIFO_Mode(LSM6DSOX_STREAM_MODE); // Continue batching
+        IMU_LOG_WARNING("-- FIFO is full! Consider reducing Watermark Level or Buffer Data Rate.\n");
+        IMU_LOG_WARNING("Flushing data from FIFO.\n");
+        flush();
+    }
+
+    // Read the sleep state of the activity engine, one register read. Returns at once while detection is off.
+    const uint32_t now = millis();
+    if (now - activity_polled >= IMU_ACTIVITY_POLL_INTERVAL)
+    {
+        activity_polled = now;
+        const LSM6DSOXActivity::activity_state_t previous = activity.getState();
+        if (activity.update(now) != previous)
+        {
+            IMU_LOG_DEBUG("Sensor is %s.\n", activity.isInactive() ? "inactive" : "active");
+            // Accelerometer samples of the 12.5 Hz inactive rate would pair with gyroscope samples at the full rate
+            if (previous == LSM6DSOXActivity::ACTIVITY_INACTIVE)
+                flush();
+        }
     }
 }
 
+void LSM6DSOXFIFO::flush(void)
+{
+    lsm6dsoxSensor.Set_FIFO_Mode(LSM6DSOX_BYPASS_MODE); // Flush FIFO data
+    lsm6dsoxSensor.Set_FIFO_Mode(LSM6DSOX_STREAM_MODE); // Continue batching
+    data.flags = false;
+}
+
+bool LSM6DSOXFIFO::enableActivityDetection(const LSM6DSOXActivity::activity_config_t &config)
+{
+    if (!activity.enable(config))
+    {
+        IMU_LOG_ERROR("Error in enabling activity detection\n");
+        return false; // Return failure
+    }
+    IMU_LOG_INFO("Success in enabling activity detection\n");
+    return true; // Return success
+}
+
+bool LSM6DSOXFIFO::disableActivityDetection(void)
+{
+    return activity.disable();
+}
+
+LSM6DSOXActivity::activity_state_t LSM6DSOXFIFO::getActivityState(void) const
+{
+    return activity.getState();
+}
+
+bool LSM6DSOXFIFO::isInactive(void) const
+{
+    return activity.isInactive();
+}
+
+LSM6DSOXActivity::statistics_t LSM6DSOXFIFO::getActivityStatistics(void) const
+{
+    return activity.getStatistics();
+}
+
+void LSM6DSOXFIFO::resetActivityStatistics(void)
+{
+    activity.resetStatistics();
+}
+
 int LSM6DSOXFIFO::readFIFObuffer(void)
 {
     int ret_val = 0;
@@ -99,7 +166,7 @@ int LSM6DSOXFIFO::readFIFObuffer(void)
     [[likely]] case IMU_FIFO_TAG_GYROSCOPE:
         // Get gyroscope data
         if (data.rotation_data_ready)
-            this->sendLog("Overwriting rotation data for a more recent ones.\n");
+            IMU_LOG_DEBUG("Overwriting rotation data for a more recent ones.\n");
         lsm6dsoxSensor.Get_FIFO_G_Axes(vector3intSerialize(&data.rotation_data));
         data.rotation_data_ready = true;
         ret_val = IMU_FIFO_TAG_GYROSCOPE;
@@ -107,14 +174,14 @@ int LSM6DSOXFIFO::readFIFObuffer(void)
     [[likely]] case IMU_FIFO_TAG_ACCELEROMETER:
         // Get accelerometer data
         if (data.acceleration_data_ready)
-            this->sendLog("Overwriting acceleration data for a more recent ones.\n");
+            IMU_LOG_DEBUG("Overwriting acceleration data for a more recent ones.\n");
         lsm6dsoxSensor.Get_FIFO_X_Axes(vector3intSerialize(&data.acceleration_data));
         data.acceleration_data_ready = true;
         ret_val = IMU_FIFO_TAG_ACCELEROMETER;
         break;
     [[unlikely]] default:
         // Ignore everything else.
-        this->sendLog("Discarding FIFO data TAG ID %02d.\n", fifo_tag);
+        IMU_LOG_WARNING("Discarding FIFO data TAG ID %02d.\n", fifo_tag);
         ret_val = 0;
         break;
     }
@@ -134,12 +201,12 @@ void LSM6DSOXFIFO::print(imu_data_t *data) const
     if (data == NULL) // Return if data is null
         return;
 
-    this->sendLog("[IMU] [%11ld ms], ", millis()); // Log timestamp
+    IMU_LOG("[IMU] [%11ld ms], ", millis()); // Log timestamp
     if (data->acceleration_data_ready)
-        this->sendLog("Acc: [%6.3f, %6.3f, %6.3f] G, ", data->acceleration_data.X / 1000.0f, data->acceleration_data.Y / 1000.0f, data->acceleration_data.Z / 1000.0f); // Log acceleration data
+        IMU_LOG("Acc: [%6.3f, %6.3f, %6.3f] G, ", data->acceleration_data.X / 1000.0f, data->acceleration_data.Y / 1000.0f, data->acceleration_data.Z / 1000.0f); // Log acceleration data
     if (data->rotation_data_ready)
-        this->sendLog("Gyro: [%8.2f, %8.2f, %8.2f] DPS", data->rotation_data.X / 1000.0f, data->rotation_data.Y / 1000.0f, data->rotation_data.Z / 1000.0f); // Log gyroscope data
-    this->sendLog("%s", "\n");                                                                                                                               // New line in log
+        IMU_LOG("Gyro: [%8.2f, %8.2f, %8.2f] DPS", data->rotation_data.X / 1000.0f, data->rotation_data.Y / 1000.0f, data->rotation_data.Z / 1000.0f); // Log gyroscope data
+    IMU_LOG("%s", "\n");                                                                                                                               // New line in log
 }
 
 void LSM6DSOXFIFO::registerLoggingCallback(const log_callback_t callback)
@@ -147,11 +214,31 @@ void LSM6DSOXFIFO::registerLoggingCallback(const log_callback_t callback)
     logCallback = callback; // Register logging callback function
 }
 
+void LSM6DSOXFIFO::registerTokenizedLoggingCallback(const tokenized_log_callback_t callback)
+{
+    tokenizedLogCallback = callback; // Register tokenized logging callback function
+}
+
 void LSM6DSOXFIFO::registerDataReadyCallback(const data_ready_callback_t callback)
 {
     dataReadyCallback = callback; // Register data ready callback function
 }
 
+void LSM6DSOXFIFO::registerActivityCallback(const LSM6DSOXActivity::state_callback_t callback)
+{
+    activity.registerStateCallback(callback); // Register activity state change callback function
+}
+
+int LSM6DSOXFIFO::readRegister(uint8_t reg, uint8_t *value)
+{
+    return (lsm6dsoxSensor.Read_Reg(reg, value) == LSM6DSOX_OK) ? 0 : -1;
+}
+
+int LSM6DSOXFIFO::writeRegister(uint8_t reg, uint8_t value)
+{
+    return (lsm6dsoxSensor.Write_Reg(reg, value) == LSM6DSOX_OK) ? 0 : -1;
+}
+
 int32_t *LSM6DSOXFIFO::vector3intSerialize(vector3int_t *vector) const
 {
     return reinterpret_cast<int32_t *>(vector); // Serialize vector data
@@ -6,9 +6,12 @@
 #include <stdarg.h>
 
 #include "LSM6DSOXSensor.h" // This library can be installed by searching `STM32duino LSM6DSOX` in the Library Manager
+#include "LSM6DSOXActivity.h"
 #include "LSM6DSOXConfig.h"
+#include "LogLevel.h"
+#include "TokenizedLog.h"
 
-class LSM6DSOXFIFO
+class LSM6DSOXFIFO : public LSM6DSOXRegisters
 {
 public:
     typedef struct vector3int
@@ -34,6 +37,7 @@ public:
     } imu_data_t;
 
     typedef std::function<int(const char *)> log_callback_t;
+    typedef std::function<int(uint32_t, const uint8_t *, size_t)> tokenized_log_callback_t;
     typedef std::function<void(imu_data_t *)> data_ready_callback_t;
 
     // Constructor
@@ -46,22 +50,53 @@ public:
     // Update sensor data
     void update(void);
 
+    // Drop everything batched so far, including a half-assembled sample. Batching goes on.
+    void flush(void);
+
     // Print sensor data
     void print(imu_data_t *data) const;
 
     // Register logging callback
     void registerLoggingCallback(log_callback_t callback);
 
+    // Register tokenized logging callback, takes precedence over the logging callback.
+    // Receives the token of the format string and the encoded arguments, see `TokenizedLog.h`.
+    void registerTokenizedLoggingCallback(tokenized_log_callback_t callback);
+
     // Register data ready callback
     void registerDataReadyCallback(data_ready_callback_t callback);
 
+    // Let the sensor detect activity and inactivity on its own, polled by `update()`.
+    // While inactive the accelerometer runs at 12.5 Hz, see `LSM6DSOXActivity.h`.
+    bool enableActivityDetection(const LSM6DSOXActivity::activity_config_t &config = LSM6DSOXActivity::defaultConfig());
+    bool disableActivityDetection(void);
+
+    // Last activity state read from the sensor, `ACTIVITY_UNKNOWN` while detection is off
+    LSM6DSOXActivity::activity_state_t getActivityState(void) const;
+    bool isInactive(void) const;
+
+    LSM6DSOXActivity::statistics_t getActivityStatistics(void) const;
+    void resetActivityStatistics(void);
+
+    // Register activity state change callback, called from `update()`. The FIFO is flushed right after a wake-up.
+    void registerActivityCallback(LSM6DSOXActivity::state_callback_t callback);
+
+    // Raw register access over I2C, returns 0 on success
+    int readRegister(uint8_t reg, uint8_t *value) override;
+    int writeRegister(uint8_t reg, uint8_t value) override;
+
 private:
     imu_data_t data;
 
     // Declare lsm6dsoxSensor as a member of the class
     LSM6DSOXSensor lsm6dsoxSensor;
 
+    // Activity/inactivity engine, accesses the sensor through this object
+    LSM6DSOXActivity activity;
+    uint32_t activity_polled; // Time of the last activity poll in ms
+
     log_callback_t logCallback;
+    tokenized_log_callback_t tokenizedLogCallback;
     data_ready_callback_t dataReadyCallback;
 
     // Converts vector3int_t into int32_t byte array for use in LSM6DSOX library code.
@@ -70,6 +105,17 @@ private:
     // Log messages
     int sendLog(const char *format, ...) const;
 
+    // Log messages as tokens if possible, formatted text otherwise. Use through `IMU_LOG()`.
+    template <typename... Args>
+    int sendTokenizedLog(uint32_t token, const char *format, Args... args) const
+    {
+        if (!tokenizedLogCallback)
+            return sendLog(format, args...);
+
+        uint8_t buffer[LOG_TOKEN_MAX_ARGS_SIZE];
+        return tokenizedLogCallback(token, buffer, TokenizedLog::encode(buffer, sizeof(buffer), args...));
+    }
+
     // Check if data is ready
     bool isDataReady(void);
 
@@ -1,26 +1,98 @@
 #include <stdarg.h>
 
 #include <TensorFlowLite.h>
-#include <tensorflow/lite/micro/all_ops_resolver.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
 #include <tensorflow/lite/micro/tflite_bridge/micro_error_reporter.h>
 #include <tensorflow/lite/micro/micro_interpreter.h>
 #include <tensorflow/lite/schema/schema_generated.h>
 
+#include "AsyncLogBuffer.h"
+#include "BinaryTelemetry.h"
 #include "BuiltinColourLED.h"
+#include "ColourLEDAnimator.h"
+#include "GestureDetector.h"
+#include "InterleavedFullyConnected.h"
+#include "InternalFlash.h"
 #include "LSM6DSOXFIFOWrapper.h"
+#include "LogLevel.h"
+#include "LogitDecision.h"
+#include "MemoryUsage.h"
+#include "ModelCascade.h"
+#include "ModelRegistry.h"
+#include "ModelUpload.h"
+#include "MotionGate.h"
+#include "PosteriorFilter.h"
+#include "SparseFullyConnected.h"
+#include "TFLMProfiler.h"
+#include "WeightPlacement.h"
+#include "XIPCache.h"
 #include "model.h" // Include the model header file generated from the TensorFlow Lite model
 
-#define UART_CLOCK_RATE 921600 // Does not matter here since RP2040 is using USB Serial Port. (Virtual UART)
-#define IIC_BUS_SPEED 400e3    // I2C bus speed in Hz. Options are: 100 kHz, 400 kHz, and 1.0 Mhz.
-#define PRINT_BUFFER_SIZE 128  // Increase this number if you see the output gets truncated
-
-const size_t num_features = 6;  // There are 6 features for each sample. (aX, aY, aZ, gX, gY, and gZ)
-const size_t num_samples = 120; // Total number of samples
-static size_t samples_read = 0; // How many samples has been read since last inference
-
-// Tensor Arena size
-const size_t tensor_arena_size = 4 * model_parameters;
-// Create a static memory buffer for TFLM, the size may need to
+#define UART_CLOCK_RATE 921600                       // Does not matter here since RP2040 is using USB Serial Port. (Virtual UART)
+#define IIC_BUS_SPEED 400e3                          // I2C bus speed in Hz. Options are: 100 kHz, 400 kHz, and 1.0 Mhz.
+#define PRINT_BUFFER_SIZE 128                        // Increase this number if you see the output gets truncated
+#define LOG_BUFFER_SIZE 4096                         // Size of the asynchronous log buffer in bytes, must be a power of two
+#define LOG_DRAIN_BUDGET 512                         // Maximum number of bytes pushed to Serial per `loop()` iteration
+#define TELEMETRY_BINARY 1                           // Send COBS-framed binary telemetry instead of text. Decode it on the host with `tools/telemetry_decode.py`.
+#define TFLM_PROFILER_ENABLED 1                      // Record per-operator timings of every inference. Send 'p' over serial to print them, 'r' to reset.
+#define LOGIT_DECISION 1                             // Decide on the logits of the last dense layer, SOFTMAX only copies them. See `LogitDecision.h`.
+#define INFERENCE_STRIDE 8                           // New samples between two overlapping inferences, ~77 ms at 104 Hz
+#define MOTION_GATE_ENABLED 1                        // Skip inference and report idle while the window shows no motion. Send 'g' over serial for statistics.
+#define IMU_ACTIVITY_ENABLED 1                       // Skip inference and sleep while the sensor reports inactivity, see `LSM6DSOXActivity.h`. Send 'a' over serial for statistics.
+#define IMU_INACTIVE_SLEEP 100                       // Time in ms `loop()` sleeps per iteration while the sensor is inactive, the FIFO keeps batching meanwhile
+#define CASCADE_ENABLED 0                            // Run the small gate model of `gate_model.h` on every window and the classifier only on motion. Send 'k' over serial for statistics.
+#define CASCADE_GATE_ARENA_SIZE 4096                 // Part of the tensor arena reserved for the gate model
+#define MODEL_ARENA_SIZE (16 * 1024)                 // Tensor arena of the classifier, see below
+#define MODEL_UPLOAD_ENABLED 1                       // Accept models from `tools/model_upload.py` after 'u' over serial and prefer an uploaded model at boot.
+#define WEIGHT_PLACEMENT_ENABLED 1                   // Run FULLY_CONNECTED layers on SRAM copies of their weights instead of XIP flash. Send 'w' over serial to measure the speedup per layer.
+#define WEIGHT_POOL_SIZE (144 * 1024)                // SRAM for the weight copies. All FULLY_CONNECTED weights of the gesture model take 140 KB.
+#define WEIGHT_PLACEMENT_LAYERS WEIGHT_PLACEMENT_ALL // Operators whose weights are copied, in operator order while `WEIGHT_POOL_SIZE` allows, e.g. ((1 << 2) | (1 << 3))
+#define WEIGHT_PLACEMENT_BENCH_RUNS 20               // Invocations per placement when measuring with 'w'
+#define WEIGHT_LAYOUT_INTERLEAVED 1                  // Run models relaid out by `tools/weight_relayout.py`, their dense layers read the weights once, front to back, optionally stored as float16, bfloat16, int8 or palette indices.
+#define SPARSE_FC_ENABLED 1                          // Run pruned models written by `tools/sparsify.py`, their sparse dense layers skip the pruned weight blocks. Compare them per layer with 'p' after 'm'.
+#define XIP_CACHE_PROFILING 1                        // Count XIP cache accesses and misses per operator, printed with the profiler statistics ('p').
+
+#if CASCADE_ENABLED
+#if __has_include("gate_model.h")
+#include "gate_model.h" // Gate model generated by `tools/train_gate_model.py`
+#else
+#error "CASCADE_ENABLED needs gate_model.h, train it on a capture of your board with tools/train_gate_model.py"
+#endif
+#endif
+
+constexpr size_t num_features = model_num_features; // There are 6 features for each sample. (aX, aY, aZ, gX, gY, and gZ)
+constexpr size_t num_samples = model_num_samples;   // Total number of samples
+static size_t samples_read = 0;                     // How many samples has been read since last inference
+
+// Sliding window of the newest samples, owned by the sketch and copied into the input tensor before every inference.
+// TFLM may reuse the input tensor for activations during `Invoke()`, so it cannot keep the window between inferences.
+static float window[num_samples * num_features]; // Ring of samples, the oldest at `window_head` once it is full
+static size_t window_head = 0;                   // Sample the next one overwrites
+static size_t window_count = 0;                  // Samples in the window, up to `window_samples`
+static float sample_millis = 0;                  // Timestamp of the next sample, advances by the sample period
+
+// The window and label table follow the shapes `model.h` was generated from, a retrained model breaks the build instead of the inference
+static_assert(model_input_dims[0] == 1 && sizeof(model_input_dims) / sizeof(model_input_dims[0]) == 3, "The model has to take one window of [samples, features]");
+static_assert(num_features == 6, "`IMUDataReadyCB()` writes 6 features per sample");
+static_assert(model_output_dims[0] == 1 && model_num_classes == gesture_len, "The model has to output one score per gesture");
+static_assert(sizeof(gestures) / sizeof(gestures[0]) == gesture_len, "`gestures[]` has to name every class");
+static_assert(gesture_len <= POSTERIOR_MAX_CLASSES, "Too many gestures for the posterior filter");
+static_assert(MOTION_GATE_WINDOW == num_samples, "The motion gate has to see the window the model classifies");
+
+// Shape and labels of the active model, change with `ModelRegistry::activate()`
+static size_t window_samples = num_samples;       // Samples per window
+static size_t num_classes = gesture_len;          // Scores per inference
+static const char *const *class_names = gestures; // Name of every class
+
+static uint32_t imu_log_interval = LOG_IMU_SAMPLE_INTERVAL; // Only every N-th IMU sample is logged
+
+// Tensor Arena size, the weights stay in the model and only the activations and the TFLM bookkeeping live here.
+// The activations of the gesture model take 5760 bytes (`tools/memory_plan.py --show model.h`). On top come the
+// eval tensors, nodes and registrations, the op data of every layer, the planner temporaries, the row scales of int8
+// layers and the 720 byte input scratch of INTERLEAVED_FC_INT8_INPUT, estimated at 4 KB and not measured on the device
+// yet. 16 KB leaves about 6 KB above both for what the estimate missed, check the use of every model with 'h'.
+const size_t tensor_arena_size = MODEL_ARENA_SIZE + (CASCADE_ENABLED ? CASCADE_GATE_ARENA_SIZE : 0);
+// Create a static memory buffer for TFLM, `MODEL_ARENA_SIZE` may need to
 // be adjusted based on the model you are using
 uint8_t tensor_arena[tensor_arena_size];
 
@@ -30,18 +102,49 @@ uint8_t tensor_arena[tensor_arena_size];
 const tflite::Model *tflModel = nullptr;
 
 tflite::MicroErrorReporter tflMicroErrorReporter; // Not used
-// Pull in all the TFLM ops, you can remove this line and
-// only pull in the TFLM ops you need, it would like to reduce
-// the compiled size of the sketch.
-tflite::AllOpsResolver tflOpsResolver;
+// Only the TFLM ops the model uses: RESHAPE, FULLY_CONNECTED and SOFTMAX, plus FC_INTERLEAVED and FC_SPARSE for converted models.
+// Update this (and the template argument) if the model changes.
+tflite::MicroMutableOpResolver<3 + WEIGHT_LAYOUT_INTERLEAVED + SPARSE_FC_ENABLED> tflOpsResolver;
 tflite::MicroInterpreter *tflInterpreter = nullptr;
 TfLiteTensor *tflInputTensor = nullptr;
 TfLiteTensor *tflOutputTensor = nullptr;
-
-static LSM6DSOXFIFO IMU = LSM6DSOXFIFO(Wire, LSM6DSOX_I2C_ADD_L); // IMU on the I2C bus
-static BuiltinColourLED ColourLED;                                // Arduino Nano RP2040 RGB LED
-
-// Write formatted log message to Serial
+TFLMProfiler tflProfiler; // Per-operator timing statistics
+#if WEIGHT_PLACEMENT_ENABLED
+alignas(WEIGHT_PLACEMENT_ALIGNMENT) static uint8_t weight_pool[WEIGHT_POOL_SIZE]; // SRAM copies of the hot weights
+static WeightPlacement tflPlacement(weight_pool, WEIGHT_POOL_SIZE);              // Which layers run from `weight_pool`
+#endif
+#if CASCADE_ENABLED
+ModelCascade tflCascade(tensor_arena, tensor_arena_size, CASCADE_GATE_ARENA_SIZE); // Gate model in front of `tflModel`
+#else
+ModelRegistry tflModels(tensor_arena, tensor_arena_size, tflOpsResolver, TFLM_PROFILER_ENABLED ? &tflProfiler : nullptr); // Models selectable at runtime
+
+// Models in flash, send 'm' over serial to switch between them. They share `tensor_arena`, which has to fit the largest.
+// Add more with the headers written by `tools/tflite_builder.py model.tflite <name>_model.h --prefix <name>_model --labels ...`,
+// e.g. the relaid out weights of `tools/weight_relayout.py model.h interleaved_model.h --prefix interleaved_model` to compare with 'p'.
+static const ModelRegistry::model_entry_t model_entries[] = {
+    {"gestures", model_data, gestures, gesture_len, num_samples, num_features},
+};
+#endif
+
+#if MODEL_UPLOAD_ENABLED
+static InternalFlash ModelFlash(MODEL_STORE_OFFSET, MODEL_STORE_SIZE); // Flash region reserved for uploaded models
+static ModelStore UploadedModel(ModelFlash);                           // Validated image in `ModelFlash`
+static ModelUpload Uploader(UploadedModel);                            // Serial upload protocol
+static size_t uploaded_index = MODEL_NONE;                             // Index of the uploaded model in `tflModels`
+#endif
+
+static LSM6DSOXFIFO IMU = LSM6DSOXFIFO(Wire, LSM6DSOX_I2C_ADD_L);            // IMU on the I2C bus
+static BuiltinColourLED ColourLED;                                           // Arduino Nano RP2040 RGB LED
+static ColourLEDAnimator LEDAnimator(ColourLED);                             // Drives `ColourLED` from its own thread
+static GestureDetector Gestures(gesture_len);                                // Gesture begin/end events from the inference scores
+static PosteriorFilter Posteriors(gesture_len, PosteriorFilter::FILTER_EMA); // Fuses overlapping inferences before `Gestures`
+static MotionGate Gate;                                                      // Running motion statistics of the window
+static BinaryTelemetry Telemetry;                                            // Binary frames over Serial
+
+static uint8_t log_buffer_storage[LOG_BUFFER_SIZE];                                                // Backing storage of `LogBuffer`
+static AsyncLogBuffer LogBuffer(log_buffer_storage, LOG_BUFFER_SIZE, AsyncLogBuffer::DROP_NEWEST); // Queues output until `loop()` is idle
+
+// Write formatted log message to the log buffer
 static int log(const char *format, ...);
 
 static int log(const char *format, ...)
@@ -52,194 +155,770 @@ static int log(const char *format, ...)
     va_start(va, format);
     ret_val = vsnprintf(print_buffer, PRINT_BUFFER_SIZE, format, va);
     va_end(va);
-    Serial.write(print_buffer);
+#if TELEMETRY_BINARY
+    Telemetry.sendText(print_buffer);
+#else
+    LogBuffer.write(print_buffer, strlen(print_buffer));
+#endif
     return ret_val;
 }
 
-// Rotate an array to the left by `amount`.
-// Refer to: https://godbolt.org/z/z8TnsMzjc
-void leftRotate(float *array, int array_size, int amount);
+// Log a message, `format` must be a string literal.
+// With binary telemetry the message is sent as a token and formatted on the host by `tools/telemetry_decode.py`.
+#if TELEMETRY_BINARY
+#define LOG(format, ...) TOKENIZED_LOG(Telemetry, format, ##__VA_ARGS__)
+#else
+#define LOG(format, ...) log(format, ##__VA_ARGS__)
+#endif
+
+// Leveled logging, see `LogConfig.h` for the compile-time and runtime levels
+#define LOG_ERROR(format, ...) LOG_IF_ERROR(LOG(format, ##__VA_ARGS__))
+#define LOG_WARNING(format, ...) LOG_IF_WARNING(LOG(format, ##__VA_ARGS__))
+#define LOG_INFO(format, ...) LOG_IF_INFO(LOG(format, ##__VA_ARGS__))
+#define LOG_DEBUG(format, ...) LOG_IF_DEBUG(LOG(format, ##__VA_ARGS__))
+
+// Stop execution, the log buffer keeps being flushed so the reason still reaches the host
+[[noreturn]] static void halt(void);
 
-void leftRotate(float *array, int array_size, int amount)
+static void halt(void)
 {
+    while (1)
+        LogBuffer.drain(LOG_DRAIN_BUDGET);
+}
+
+// Copy the window into the input tensor, oldest sample first so newer data are located to the right-most side
+static void loadWindow(void)
+{
+    float *input = tflInputTensor->data.f;
+    const size_t head = window_head * num_features;
+    const size_t size = window_samples * num_features;
+    memcpy(input, window + head, (size - head) * sizeof(float));
+    memcpy(input + (size - head), window, head * sizeof(float));
+}
 
-    if (array_size == 0)
+// Start over with an empty window, the next inference waits for `window_samples` new samples
+static void restartWindow(void)
+{
+    window_head = 0;
+    window_count = 0;
+    samples_read = 0;
+    sample_millis = millis();
+    Gate.reset();
+}
+
+// Continue after a command that kept `loop()` from running. The FIFO holds samples of before it and wrapped meanwhile.
+static void resumeAcquisition(void)
+{
+    IMU.flush();
+    restartWindow();
+}
+
+static int LoggingCB(const char *str)
+{
+    return log("%s", str);
+}
+
+// Log a single IMU sample
+static void logIMUSample(uint32_t timestamp, const LSM6DSOXFIFO::imu_data_t *data)
+{
+#if TELEMETRY_BINARY
+    Telemetry.sendIMUSample(timestamp, &data->acceleration_data.X, &data->rotation_data.X);
+#else
+    log("[IMU] [%11d ms], ", int(timestamp));
+    log("Acc: [%6.3f, %6.3f, %6.3f] G, ", data->acceleration_data.X / 1000.0f, data->acceleration_data.Y / 1000.0f, data->acceleration_data.Z / 1000.0f); // Acceleration
+    log("Gyro: [%8.2f, %8.2f, %8.2f] DPS", data->rotation_data.X / 1000.0f, data->rotation_data.Y / 1000.0f, data->rotation_data.Z / 1000.0f); // Angular Velocity
+    log("%s", "\n");
+#endif
+}
+
+// Log the scores of the latest inference
+static void logInference(size_t max_index)
+{
+#if LOGIT_DECISION
+    // The output holds logits, probabilities are only computed when they are logged
+    float probabilities[POSTERIOR_MAX_CLASSES];
+    LogitDecision::probabilities(tflOutputTensor->data.f, probabilities, num_classes);
+#else
+    const float *probabilities = tflOutputTensor->data.f;
+#endif
+
+#if TELEMETRY_BINARY
+    Telemetry.sendInference(millis(), probabilities, num_classes, max_index);
+#else
+    log("[Res] [%11d ms] |", millis());
+    for (size_t i = 0; i < num_classes; i++)
+        log(" [%6s: %4.2f]", class_names[i], probabilities[i]);
+    log(" | [%6s: %4.2f]\n", class_names[max_index], probabilities[max_index]);
+#endif
+}
+
+// LED colour of every gesture while it is active, refer to `gestures[]` in `model.h` for the full name definition
+static const BuiltinColourLED::rgb_t gesture_colours[] = {
+    BuiltinColourLED::rgb_t(0, 0, 0),   // idle
+    BuiltinColourLED::rgb_t(0, 255, 0), // left
+    BuiltinColourLED::rgb_t(0, 0, 255), // right
+    BuiltinColourLED::rgb_t(255, 0, 0),
+    // Add more colours if needed
+};
+const size_t num_gesture_colours = sizeof(gesture_colours) / sizeof(gesture_colours[0]);
+
+#define GESTURE_FADE_OUT_TIME 200 // Time in ms the LED takes to go dark after a gesture ended
+
+// Show gestures on the LED, only called when a gesture begins or ends
+static void GestureLEDCB(const GestureDetector::gesture_event_t &event)
+{
+    if (event.type == GestureDetector::GESTURE_END)
+    {
+        LEDAnimator.fadeTo(BuiltinColourLED::rgb_t(0, 0, 0), GESTURE_FADE_OUT_TIME);
         return;
+    }
 
-    // Get the effective number of rotations:
-    amount = amount % array_size;
+    if (event.gesture < num_gesture_colours)
+    {
+        LEDAnimator.setRGB(gesture_colours[event.gesture]);
+        return;
+    }
 
-    // Step 1: Reverse the first `amount` elements
-    std::reverse(array, array + amount);
+    // Unhandled case
+    LEDAnimator.setRGB(0, 0, 0);
+#if TELEMETRY_BINARY
+    LOG_IF_WARNING(Telemetry.sendEvent(event.timestamp, BinaryTelemetry::EVENT_GESTURE_UNHANDLED, event.gesture));
+#else
+    LOG_WARNING("Gesture id %d unhandled", int(event.gesture));
+#endif
+}
 
-    // Step 2: Reverse the last (`array_size`-`amount`) elements
-    std::reverse(array + amount, array + array_size);
+// Report gesture transitions to the host
+static void GestureLoggingCB(const GestureDetector::gesture_event_t &event)
+{
+#if TELEMETRY_BINARY
+    const BinaryTelemetry::event_id_t id = (event.type == GestureDetector::GESTURE_BEGIN) ? BinaryTelemetry::EVENT_GESTURE_BEGIN : BinaryTelemetry::EVENT_GESTURE_END;
+    LOG_IF_INFO(Telemetry.sendEvent(event.timestamp, id, event.gesture));
+#else
+    if (event.type == GestureDetector::GESTURE_BEGIN)
+        LOG_INFO("[Gst] [%11d ms] %s begin (%4.2f)\n", int(event.timestamp), class_names[event.gesture], event.score);
+    else
+        LOG_INFO("[Gst] [%11d ms] %s end after %d ms\n", int(event.timestamp), class_names[event.gesture], int(event.duration));
+#endif
+}
+
+// Scores reported for windows the motion gate skips: idle wins with full confidence
+static float idle_scores[POSTERIOR_MAX_CLASSES];
 
-    // Step 3: Reverse the entire array
-    std::reverse(array, array + array_size);
+// Report the window as idle without running the model
+static void reportIdle(void)
+{
+    Gestures.update(Posteriors.update(idle_scores), millis());
+    LogBuffer.drain(LOG_DRAIN_BUDGET);
 }
 
-static int IMULoggingCB(const char *str)
+// Report activity changes detected by the sensor
+static void ActivityCB(LSM6DSOXActivity::activity_state_t state)
 {
-    return log("%s", str);
+#if TELEMETRY_BINARY
+    LOG_IF_INFO(Telemetry.sendEvent(millis(), BinaryTelemetry::EVENT_ACTIVITY, state == LSM6DSOXActivity::ACTIVITY_ACTIVE));
+#else
+    LOG_INFO("[Act] [%11lu ms] sensor %s\n", (unsigned long)millis(), (state == LSM6DSOXActivity::ACTIVITY_ACTIVE) ? "active" : "inactive");
+#endif
+    // The accelerometer ran at 12.5 Hz while inactive, its samples do not line up with the gyroscope ones.
+    // `LSM6DSOXFIFO` flushes the FIFO after this callback, the window starts over at the full rate.
+    if (state == LSM6DSOXActivity::ACTIVITY_ACTIVE)
+        restartWindow();
 }
 
 static void IMUDataReadyCB([[maybe_unused]] LSM6DSOXFIFO::imu_data_t *data)
 {
-    static float last_sample_millis = 0;
     const float delta_millis = (1000.0f / IMU_SAMPLING_RATE);
 
-    log("[IMU] [%11d ms], ", int(last_sample_millis));
-    log("Acc: [%6.3f, %6.3f, %6.3f] G, ", data->acceleration_data.X / 1000.0f, data->acceleration_data.Y / 1000.0f, data->acceleration_data.Z / 1000.0f); // Acceleration
-    log("Gyro: [%8.2f, %8.2f, %8.2f] DPS", data->rotation_data.X / 1000.0f, data->rotation_data.Y / 1000.0f, data->rotation_data.Z / 1000.0f); // Angular Velocity
-    log("%s", "\n");
+    LOG_IF_DEBUG(LOG_EVERY_N(imu_log_interval, logIMUSample(uint32_t(sample_millis), data)));
 
-    last_sample_millis += delta_millis;
+    sample_millis += delta_millis;
 
-    // Populate input, divided by 1000 since the training data is also divided by 1000
-    uint32_t index = samples_read * num_features;
-    tflInputTensor->data.f[index++] = data->acceleration_data.X / 1000.0f;
-    tflInputTensor->data.f[index++] = data->acceleration_data.Y / 1000.0f;
-    tflInputTensor->data.f[index++] = data->acceleration_data.Z / 1000.0f;
-    tflInputTensor->data.f[index++] = data->rotation_data.X / 1000.0f;
-    tflInputTensor->data.f[index++] = data->rotation_data.Y / 1000.0f;
-    tflInputTensor->data.f[index++] = data->rotation_data.Z / 1000.0f;
+    Gate.update(&data->acceleration_data.X, &data->rotation_data.X);
+
+    // Populate the window, divided by 1000 since the training data is also divided by 1000.
+    // The newest sample replaces the oldest, however many arrive between two inferences.
+    float *sample = window + window_head * num_features;
+    sample[0] = data->acceleration_data.X / 1000.0f;
+    sample[1] = data->acceleration_data.Y / 1000.0f;
+    sample[2] = data->acceleration_data.Z / 1000.0f;
+    sample[3] = data->rotation_data.X / 1000.0f;
+    sample[4] = data->rotation_data.Y / 1000.0f;
+    sample[5] = data->rotation_data.Z / 1000.0f;
+    window_head = (window_head + 1) % window_samples;
+    window_count = std::min(window_count + 1, window_samples);
     samples_read++;
 }
 
+// Set up the decision path for `num_classes` scores per inference
+static void configureDecision(void)
+{
+    Gestures.setNumGestures(num_classes, millis());
+    Posteriors.setNumClasses(num_classes);
+#if LOGIT_DECISION
+    // Scores are logit margins. Entering needs a margin that guarantees the probability, a gesture only ends once
+    // its margin rules the exit probability out, so the hysteresis is at least as wide as between the probabilities.
+    Gestures.setThresholds(LogitDecision::marginThreshold(GESTURE_ENTER_THRESHOLD, num_classes),
+                           LogitDecision::marginBound(GESTURE_EXIT_THRESHOLD));
+    Posteriors.setEarlyCommit(LogitDecision::marginThreshold(POSTERIOR_EARLY_COMMIT, num_classes));
+    for (size_t i = 0; i < num_classes; i++)
+        idle_scores[i] = (i == GESTURE_IDLE_INDEX) ? 20.0f : -20.0f; // Margins far beyond every threshold
+#else
+    for (size_t i = 0; i < num_classes; i++)
+        idle_scores[i] = (i == GESTURE_IDLE_INDEX) ? 1.0f : 0.0f;
+#endif
+}
+
+#if WEIGHT_PLACEMENT_ENABLED
+// Copy the hot weights of `tflModel` to SRAM, once per interpreter
+static void placeWeights(void)
+{
+    [[maybe_unused]] const size_t placed = tflPlacement.begin(tflModel, WEIGHT_PLACEMENT_LAYERS);
+    [[maybe_unused]] const WeightPlacement::statistics_t stats = tflPlacement.getStatistics();
+    LOG_INFO("[Place] %u of %u layers in SRAM, %u bytes copied in %lu us, %u bytes stay in flash\n", unsigned(placed),
+             unsigned(tflPlacement.getLayerCount()), unsigned(stats.placed_bytes), (unsigned long)stats.copy_time, unsigned(stats.flash_bytes));
+}
+
+// Time every layer with its weights in flash and in SRAM, `WEIGHT_PLACEMENT_BENCH_RUNS` invocations each
+static void benchmarkPlacement(void)
+{
+    uint32_t average[2][PROFILER_MAX_EVENTS] = {}; // Per operator, in flash and in SRAM
+    uint32_t invoke[2] = {0, 0};                   // Whole `Invoke()`
+    for (int placed = 0; placed < 2; placed++)
+    {
+        tflPlacement.setEnabled(placed);
+        tflInterpreter->Invoke(); // Moves the tensors and warms the XIP cache up as much as it ever is
+
+        tflProfiler.reset();
+        const uint32_t start = micros();
+        for (int i = 0; i < WEIGHT_PLACEMENT_BENCH_RUNS; i++)
+        {
+            tflProfiler.beginInvoke();
+            tflInterpreter->Invoke();
+            tflProfiler.endInvoke();
+        }
+        invoke[placed] = (micros() - start) / WEIGHT_PLACEMENT_BENCH_RUNS;
+        for (uint16_t op = 0; op < tflProfiler.getNumOps(); op++)
+        {
+            const TFLMProfiler::op_stats_t *stats = tflProfiler.getStats(op);
+            average[placed][op] = stats->count ? stats->total_ticks / stats->count : 0;
+        }
+    }
+    tflPlacement.setEnabled(true);
+
+    for (uint16_t op = 0; op < tflProfiler.getNumOps(); op++)
+    {
+        if (!tflPlacement.isPlaced(op))
+            continue;
+        [[maybe_unused]] const TFLMProfiler::op_stats_t *stats = tflProfiler.getStats(op);
+        [[maybe_unused]] const uint32_t speedup = average[1][op] ? (average[0][op] * 100 + average[1][op] / 2) / average[1][op] : 0; // x100
+        LOG_INFO("[Place] %2u %-15s flash %6lu us, SRAM %6lu us, %lu.%02lux\n", unsigned(op), stats->layer,
+                 (unsigned long)average[0][op], (unsigned long)average[1][op], (unsigned long)(speedup / 100), (unsigned long)(speedup % 100));
+    }
+    LOG_INFO("[Place] Invoke(): flash %lu us, placed %lu us\n", (unsigned long)invoke[0], (unsigned long)invoke[1]);
+    if (tflProfiler.getNumOps() == 0)
+        LOG_WARNING("[Place] Per-layer timings need TFLM_PROFILER_ENABLED\n");
+    tflProfiler.reset();
+}
+#endif
+
+#if !CASCADE_ENABLED
+// Switch to a model of `tflModels` and point the sketch at its tensors. Returns false if the previous model stayed active.
+static bool activateModel(size_t index)
+{
+    const ModelRegistry::model_entry_t &entry = tflModels.getEntry(index);
+    if (entry.num_labels > POSTERIOR_MAX_CLASSES || entry.num_features != num_features || entry.num_samples > num_samples)
+    {
+        LOG_ERROR("Model %s does not fit the sketch\n", entry.name);
+        return false;
+    }
+#if MODEL_UPLOAD_ENABLED
+    // A failed or aborted upload leaves the entry in the registry, but not the image it points at
+    if (index == uploaded_index && UploadedModel.getImage() == nullptr)
+    {
+        LOG_ERROR("No valid model in flash, upload it again\n");
+        return false;
+    }
+#endif
+
+    const TfLiteStatus status = tflModels.activate(index);
+    [[maybe_unused]] const ModelRegistry::switch_report_t report = tflModels.getLastSwitch();
+    if (status != kTfLiteOk)
+    {
+        LOG_ERROR("Failed to activate model %s in an arena of %u bytes (`MODEL_ARENA_SIZE`), kept the previous one\n", entry.name, unsigned(tensor_arena_size));
+        if (tflModels.getActive() == nullptr)
+            return false;
+    }
+    else
+        LOG_INFO("[Model] %s active after %lu us: teardown %lu us, construction %lu us, allocation %lu us (%s plan), arena %u bytes\n", entry.name,
+                 (unsigned long)(report.teardown + report.construction + report.allocation), (unsigned long)report.teardown,
+                 (unsigned long)report.construction, (unsigned long)report.allocation, report.offline_plan ? "offline" : "greedy",
+                 unsigned(report.arena_used));
+
+    // Tensors moved, even when the previous model was restored
+    const ModelRegistry::model_entry_t *active = tflModels.getActive();
+    tflModel = tflModels.getModel();
+    tflInterpreter = tflModels.getInterpreter();
+    tflInputTensor = tflInterpreter->input(0);
+    tflOutputTensor = tflInterpreter->output(0);
+    window_samples = active->num_samples;
+    num_classes = active->num_labels;
+    class_names = active->labels;
+
+    // Start with an empty window and a fresh decision path
+    restartWindow();
+    configureDecision();
+    tflProfiler.setLayerNames(tflModel);
+    tflProfiler.reset();
+#if WEIGHT_PLACEMENT_ENABLED
+    placeWeights(); // Fresh interpreter, its tensors point at the model in flash
+#endif
+    return status == kTfLiteOk;
+}
+#endif
+
+#if MODEL_UPLOAD_ENABLED
+#if !CASCADE_ENABLED
+// Add a valid image of `UploadedModel` to `tflModels`, once. The image has no labels, it is expected to classify `gestures`.
+static void registerUploadedModel(void)
+{
+    size_t size = 0;
+    const uint8_t *image = UploadedModel.getImage(&size);
+    if (image == nullptr || uploaded_index != MODEL_NONE)
+        return;
+    if (!tflModels.add({"uploaded", image, gestures, gesture_len, num_samples, num_features}))
+    {
+        LOG_WARNING("No room for the uploaded model in the registry\n");
+        return;
+    }
+    uploaded_index = tflModels.getCount() - 1;
+    LOG_INFO("[Upl] Model of %u bytes in flash\n", unsigned(size));
+}
+#endif
+
+// Receive a model from `tools/model_upload.py`. Inference pauses meanwhile, the flash stalls during every erase and program.
+static void runUpload(void)
+{
+#if !CASCADE_ENABLED
+    // The image is about to be overwritten, run the built-in model meanwhile
+    if (uploaded_index != MODEL_NONE && tflModels.getActiveIndex() == uploaded_index)
+        activateModel(0);
+#endif
+    LOG_INFO("[Upl] Waiting for a model of up to %u bytes\n", unsigned(UploadedModel.getCapacity()));
+
+    // Only replies go out from here on, the delimiter separates them from earlier output
+    const uint8_t delimiter = 0x00;
+    LogBuffer.write(&delimiter, sizeof(delimiter));
+    Uploader.start(millis());
+    while (Uploader.isActive())
+    {
+        while (Serial.available())
+            Uploader.receive(Serial.read(), millis());
+        Uploader.update(millis());
+        LogBuffer.drain(LOG_DRAIN_BUDGET);
+    }
+
+    [[maybe_unused]] const ModelUpload::statistics_t stats = Uploader.getStatistics();
+    if (stats.result != ModelUpload::UPLOAD_OK)
+    {
+        LOG_WARNING("[Upl] Upload ended with status %d after %lu bytes\n", int(stats.result), (unsigned long)stats.bytes);
+        return;
+    }
+    LOG_INFO("[Upl] %lu bytes in %lu ms (%lu bytes/s): %lu chunks, %lu repeated, %lu errors, erase %lu ms, program %lu ms\n",
+             (unsigned long)stats.bytes, (unsigned long)stats.duration, (unsigned long)(stats.duration ? uint64_t(stats.bytes) * 1000 / stats.duration : 0),
+             (unsigned long)stats.chunks, (unsigned long)stats.repeated, (unsigned long)stats.errors,
+             (unsigned long)stats.erase_time, (unsigned long)(stats.program_time / 1000));
+#if !CASCADE_ENABLED
+    registerUploadedModel();
+    LOG_INFO("[Upl] Send 'm' to switch to it, it is also preferred after a reset\n");
+#endif
+}
+#endif
+
+// Heap, stack high-water mark of the main thread and tensor arena. Everything else is static, so it only changes with the model.
+static void reportMemory(void)
+{
+    [[maybe_unused]] const MemoryUsage::heap_t heap = MemoryUsage::getHeap();
+    [[maybe_unused]] const MemoryUsage::stack_t stack = MemoryUsage::getStack();
+#if CASCADE_ENABLED
+    [[maybe_unused]] const size_t arena_used = tflCascade.getArenaUsed(ModelCascade::STAGE_GATE) + tflCascade.getArenaUsed(ModelCascade::STAGE_CLASSIFIER);
+#else
+    [[maybe_unused]] const size_t arena_used = tflInterpreter->arena_used_bytes();
+#endif
+    LOG_INFO("[Mem] heap %u bytes used (%u reserved), stack peak %u of %u bytes, arena %u of %u bytes\n", unsigned(heap.used),
+             unsigned(heap.reserved), unsigned(stack.peak), unsigned(stack.size), unsigned(arena_used), unsigned(tensor_arena_size));
+}
+
+// Handle single character commands received over serial
+static void handleSerialCommand(void)
+{
+    if (!Serial.available())
+        return;
+
+    const int command = Serial.read();
+    switch (command)
+    {
+    case '0': // Set runtime log verbosity, see `LogConfig.h`
+    case '1':
+    case '2':
+    case '3':
+    case '4':
+    case '5':
+        LogLevel::set(command - '0');
+        LOG_INFO("Log level set to %d (compiled up to %d).\n", command - '0', LOG_COMPILE_LEVEL);
+        break;
+    case 'i': // Cycle the IMU sample logging interval: 1, 10, 100, 1000
+        imu_log_interval = (imu_log_interval >= 1000) ? 1 : imu_log_interval * 10;
+        LOG_INFO("Logging every %lu IMU samples.\n", (unsigned long)imu_log_interval);
+        break;
+    case 'p': // Print profiler statistics
+        tflProfiler.print();
+        break;
+    case 'r': // Reset profiler statistics
+        tflProfiler.reset();
+        LOG_INFO("Profiler statistics cleared.\n");
+        break;
+    case 'f': // Cycle the posterior filter: none, EMA, majority vote
+    {
+        static const char *const filter_names[] = {"none", "EMA", "majority vote"};
+        const PosteriorFilter::filter_mode_t mode = PosteriorFilter::filter_mode_t((Posteriors.getMode() + 1) % 3);
+        Posteriors.setMode(mode);
+        LOG_INFO("Posterior filter: %s\n", filter_names[mode]);
+        break;
+    }
+    case 'g': // Print motion gate statistics
+    {
+        [[maybe_unused]] MotionGate::statistics_t stats = Gate.getStatistics();
+        LOG_INFO("[Gate] %lu of %lu windows skipped, acc variance %lu mG^2, gyro energy %lu DPS^2\n",
+                 (unsigned long)stats.gated, (unsigned long)stats.windows,
+                 (unsigned long)Gate.getAccelerationVariance(), (unsigned long)Gate.getRotationEnergy());
+        Gate.resetStatistics();
+        break;
+    }
+    case 'a': // Print sensor activity statistics
+    {
+        [[maybe_unused]] LSM6DSOXActivity::statistics_t stats = IMU.getActivityStatistics();
+        LOG_INFO("[Act] %s, %lu sleeps, %lu wake-ups, %lu ms inactive\n", IMU.isInactive() ? "inactive" : "active",
+                 (unsigned long)stats.sleeps, (unsigned long)stats.wake_ups, (unsigned long)stats.inactive_ms);
+        IMU.resetActivityStatistics();
+        break;
+    }
+#if CASCADE_ENABLED
+    case 'k': // Print model cascade statistics
+    {
+        [[maybe_unused]] ModelCascade::statistics_t stats = tflCascade.getStatistics();
+        LOG_INFO("[Cascade] gate %lu invocations (%lu us), classifier %lu invocations (%lu us), %lu windows flagged\n",
+                 (unsigned long)stats.invocations[ModelCascade::STAGE_GATE], (unsigned long)stats.time[ModelCascade::STAGE_GATE],
+                 (unsigned long)stats.invocations[ModelCascade::STAGE_CLASSIFIER], (unsigned long)stats.time[ModelCascade::STAGE_CLASSIFIER],
+                 (unsigned long)stats.flagged);
+        tflCascade.resetStatistics();
+        break;
+    }
+#endif
+    case 'm': // Switch to the next model
+#if CASCADE_ENABLED
+        LOG_WARNING("Model switching is not available with the cascade\n");
+#else
+        // Skip models that cannot be activated, e.g. the uploaded one after a failed upload
+        for (size_t step = 1; step < tflModels.getCount(); step++)
+            if (activateModel((tflModels.getActiveIndex() + step) % tflModels.getCount()))
+                break;
+#endif
+        break;
+    case 'u': // Receive a model from `tools/model_upload.py`
+#if MODEL_UPLOAD_ENABLED
+        runUpload();
+        resumeAcquisition();
+#else
+        LOG_WARNING("Model upload is disabled\n");
+#endif
+        break;
+    case 'w': // Measure the weight placement per layer
+#if WEIGHT_PLACEMENT_ENABLED
+        benchmarkPlacement();
+        resumeAcquisition();
+#else
+        LOG_WARNING("Weight placement is disabled\n");
+#endif
+        break;
+    case 'c': // Print LED statistics
+    {
+        [[maybe_unused]] ColourLEDAnimator::statistics_t stats = LEDAnimator.getStatistics();
+        LOG_INFO("[LED] %lu colour requests, %lu frames sent\n", (unsigned long)stats.requests, (unsigned long)stats.frames);
+        LEDAnimator.resetStatistics();
+        break;
+    }
+    case 'l': // Print log buffer statistics
+    {
+        [[maybe_unused]] AsyncLogBuffer::statistics_t stats = LogBuffer.getStatistics();
+        LOG_INFO("[Log] used %u/%u bytes, high watermark %u bytes, %lu records, dropped %lu records (%lu bytes)\n",
+                 unsigned(stats.used), unsigned(stats.capacity), unsigned(stats.high_watermark),
+                 (unsigned long)stats.records, (unsigned long)stats.dropped_records, (unsigned long)stats.dropped_bytes);
+        LogBuffer.resetStatistics();
+        break;
+    }
+    case 'h': // Print heap, stack and arena usage
+        reportMemory();
+        break;
+    default: // Ignore everything else, including line endings
+        break;
+    }
+}
+
 void setup()
 {
+    MemoryUsage::paintStack(); // Before anything else runs, for the stack peak of `reportMemory()`
+
     ColourLED.enable();
-    ColourLED.setRGB(0, 0, 0);
+    LEDAnimator.begin(); // From here on the LED is only driven through `LEDAnimator`
+    LEDAnimator.setRGB(0, 0, 0);
 
     Serial.begin(UART_CLOCK_RATE);
+    LogBuffer.registerWriteCallback([](const uint8_t *buffer, size_t length)
+                                    { return Serial.write(buffer, length); });
+    LogBuffer.registerWritableCallback([]()
+                                       {
+                                           // Only what the USB transmit buffer takes right now: nothing while no host has the port open,
+                                           // and a host that reads slowly holds output back instead of blocking `drain()` in `Serial.write()`
+                                           const int space = Serial ? Serial.availableForWrite() : 0;
+                                           return size_t(std::min(std::max(space, 0), LOG_DRAIN_BUDGET)); });
+    Telemetry.registerWriteCallback([](const uint8_t *buffer, size_t length)
+                                    { return LogBuffer.write(buffer, length); });
 
     // Comment out this section to skip waiting for serial:
+    // LEDAnimator.blink(BuiltinColourLED::rgb_t(0, 100, 0), BuiltinColourLED::rgb_t(0, 0, 0), 600, 600);
     // while (!Serial)
-    // {
-    //     static uint32_t last_millis = millis();
-    //     const static uint16_t delta = 600;
-    //     static bool state = true;
-    //     if (millis() - last_millis >= delta)
-    //     {
-    //         ColourLED.setRGB(0, state ? 100 : 0, 0);
-    //         state = !state;
-    //         last_millis += delta;
-    //     }
-    // }
-
-    ColourLED.setRGB(0, 0, 100);
+    //     ;
+
+    LEDAnimator.setRGB(0, 0, 100);
+
+#if MODEL_UPLOAD_ENABLED
+    if (!ModelFlash.begin())
+        LOG_WARNING("Model flash region not available, uploads are rejected\n");
+    Uploader.registerReplyCallback([](ModelUpload::request_type_t request, uint16_t sequence, ModelUpload::upload_status_t status, uint32_t value)
+                                   { Telemetry.sendUploadReply(request, sequence, status, value); });
+#endif
 
     // Get the TFL representation of the model byte array
     tflModel = tflite::GetModel(model_data);
     if (tflModel == nullptr)
     {
-        log("Failed to load model\n");
-        while (1)
-            ; // Halt execution
+        LOG_ERROR("Failed to load model\n");
+        halt(); // Halt execution
     }
-    log("tflModel = %p\n", (void *)tflModel);
+    LOG_DEBUG("tflModel = %p\n", (void *)tflModel);
 
     int32_t model_version = tflModel->version();
     if (model_version != TFLITE_SCHEMA_VERSION)
     {
-        log("Model schema mismatch!\n");
-        while (1)
-            ;
+        LOG_ERROR("Model schema mismatch!\n");
+        halt();
     }
 
     // Create an interpreter to run the model
-    tflInterpreter = new tflite::MicroInterpreter(tflModel, tflOpsResolver, tensor_arena, tensor_arena_size, nullptr, nullptr);
-
-    // Allocate memory for the model's input and output tensors
-    tflInterpreter->AllocateTensors();
+    tflProfiler.registerLoggingCallback(LoggingCB);
+#if XIP_CACHE_PROFILING
+    tflProfiler.registerCacheCounterCallback([](uint32_t &accesses, uint32_t &misses)
+                                             {
+                                                 const XIPCache::counters_t counters = XIPCache::take();
+                                                 accesses = counters.accesses;
+                                                 misses = counters.misses; });
+#endif
+    tflProfiler.setLayerNames(tflModel);
+    tflOpsResolver.AddReshape();
+#if WEIGHT_PLACEMENT_ENABLED
+    tflOpsResolver.AddFullyConnected(WeightPlacement::placedFullyConnected());
+#else
+    tflOpsResolver.AddFullyConnected();
+#endif
+#if WEIGHT_LAYOUT_INTERLEAVED
+#if WEIGHT_PLACEMENT_ENABLED
+    static InterleavedFullyConnected::registration_t interleaved_fc = WeightPlacement::placedInterleavedFullyConnected();
+#else
+    static InterleavedFullyConnected::registration_t interleaved_fc = InterleavedFullyConnected::registration();
+#endif
+    tflOpsResolver.AddCustom(INTERLEAVED_FC_NAME, &interleaved_fc);
+#endif
+#if SPARSE_FC_ENABLED
+#if WEIGHT_PLACEMENT_ENABLED
+    static SparseFullyConnected::registration_t sparse_fc = WeightPlacement::placedSparseFullyConnected();
+#else
+    static SparseFullyConnected::registration_t sparse_fc = SparseFullyConnected::registration();
+#endif
+    tflOpsResolver.AddCustom(SPARSE_FC_NAME, &sparse_fc);
+#endif
+#if LOGIT_DECISION
+    tflOpsResolver.AddSoftmax(LogitDecision::passthroughSoftmax());
+#else
+    tflOpsResolver.AddSoftmax();
+#endif
+#if CASCADE_ENABLED
+    // Both models share the arena, the cascade allocates their tensors
+    if (tflCascade.begin(tflite::GetModel(gate_model_data), tflModel, tflOpsResolver, TFLM_PROFILER_ENABLED ? &tflProfiler : nullptr) != kTfLiteOk)
+    {
+        LOG_ERROR("Failed to set up the model cascade, check that the gate model matches the classifier and both fit the arena\n");
+        halt();
+    }
+    tflInterpreter = tflCascade.getClassifier();
+#if WEIGHT_PLACEMENT_ENABLED
+    placeWeights();
+#endif
+    LOG_DEBUG("Cascade: gate %u bytes, classifier %u bytes of the arena, %u samples per gate sample\n",
+              unsigned(tflCascade.getArenaUsed(ModelCascade::STAGE_GATE)), unsigned(tflCascade.getArenaUsed(ModelCascade::STAGE_CLASSIFIER)),
+              unsigned(tflCascade.getDownsampling()));
 
     // Get pointers for the model's input and output tensors
     tflInputTensor = tflInterpreter->input(0);
     tflOutputTensor = tflInterpreter->output(0);
-
-    // Initialize input tensors to NAN.
-    for (size_t i = 0; i < (num_samples * num_features); i++)
-        tflInputTensor->data.f[i] = NAN;
-
-    log("Model initialization successful.\n");
+#else
+    // The registry creates the interpreter of the active model in place and allocates its tensors
+    for (const ModelRegistry::model_entry_t &entry : model_entries)
+        tflModels.add(entry);
+    bool activated = false;
+#if MODEL_UPLOAD_ENABLED
+    // An uploaded model wins over the built-in one, unless it does not fit the sketch
+    registerUploadedModel();
+    activated = (uploaded_index != MODEL_NONE) && activateModel(uploaded_index);
+#endif
+    if (!activated && !activateModel(0))
+        halt();
+#endif
+
+    LOG_INFO("Model initialization successful.\n");
 
     // I2C, fast mode
     Wire.begin();
     Wire.setClock(IIC_BUS_SPEED);
 
+    // Gesture events drive the LED and the log instead of every single inference
+    configureDecision();
+    Gestures.registerEventCallback(GestureLEDCB);
+    Gestures.registerEventCallback(GestureLoggingCB);
+
     // Initialize sensors
-    IMU.registerLoggingCallback(IMULoggingCB);
+    IMU.registerLoggingCallback(LoggingCB);
+#if TELEMETRY_BINARY
+    IMU.registerTokenizedLoggingCallback([](uint32_t token, const uint8_t *args, size_t length)
+                                         { return int(Telemetry.sendTokenized(token, args, length)); });
+#endif
     IMU.registerDataReadyCallback(IMUDataReadyCB);
     if (!IMU.initialize())
     {
-        log("Failed to initialize IMU\n");
-        while (1)
-            ; // Halt execution
+        LOG_ERROR("Failed to initialize IMU\n");
+        halt(); // Halt execution
     }
-
-    ColourLED.setRGB(100, 100, 100);
-    log("Starting...\n");
+#if IMU_ACTIVITY_ENABLED
+    IMU.registerActivityCallback(ActivityCB);
+    IMU.enableActivityDetection(); // Runs without it, just never sleeps
+#endif
+
+    reportMemory();
+
+    LEDAnimator.setRGB(100, 100, 100);
+#if TELEMETRY_BINARY
+    LOG_IF_INFO(Telemetry.sendEvent(millis(), BinaryTelemetry::EVENT_STARTED));
+#else
+    LOG_INFO("Starting...\n");
+#endif
 }
 
 void loop()
 {
+    handleSerialCommand();
+
     // Read IMU data from FIFO
     IMU.update();
 
     // After here the `samples_read` will contain the number of NEW samples available
 
-    // Arrange buffer so newer data are located to the right-most side
-    leftRotate(tflInputTensor->data.f, num_samples * num_features, samples_read * num_features);
+    // Overlapping windows advance by at least `INFERENCE_STRIDE` samples, an unchanged window gives the same result
+    if (samples_read < INFERENCE_STRIDE)
+    {
+        LogBuffer.drain(LOG_DRAIN_BUDGET);
+#if IMU_ACTIVITY_ENABLED
+        // Nothing to classify while the sensor is at rest, let the core idle instead of polling the FIFO
+        if (IMU.isInactive())
+            delay(IMU_INACTIVE_SLEEP);
+#endif
+        return;
+    }
+
     samples_read = 0;
 
+    // A window that is not full yet holds no gesture, after boot, a model switch or a restart of the window
+    if (window_count < window_samples)
+    {
+        reportIdle();
+        return;
+    }
+
+#if IMU_ACTIVITY_ENABLED
+    // The sensor saw no motion for `IMU_SLEEP_DURATION`
+    if (IMU.isInactive())
+    {
+        reportIdle();
+        return;
+    }
+#endif
+
+#if MOTION_GATE_ENABLED
+    // Quiet window
+    if (!Gate.shouldInvoke())
+    {
+        reportIdle();
+        return;
+    }
+#endif
+
+    loadWindow();
+
+#if CASCADE_ENABLED
+    // The gate model sees no gesture
+    bool motion = false;
+    if (tflCascade.runGate(&motion) == kTfLiteOk && !motion)
+    {
+        reportIdle();
+        return;
+    }
+#endif
+
     // Run inference
+    tflProfiler.beginInvoke();
+#if CASCADE_ENABLED
+    TfLiteStatus invokeStatus = tflCascade.runClassifier();
+#else
     TfLiteStatus invokeStatus = tflInterpreter->Invoke();
+#endif
+    tflProfiler.endInvoke();
     if (invokeStatus != kTfLiteOk)
     {
-        log("Invoke failed!");
-        while (1)
-            ;
-        return;
+#if TELEMETRY_BINARY
+        LOG_IF_ERROR(Telemetry.sendEvent(millis(), BinaryTelemetry::EVENT_INVOKE_FAILED, invokeStatus));
+#else
+        LOG_ERROR("Invoke failed!");
+#endif
+        halt();
     }
 
     // Get the highest score of gesture index
+#if LOGIT_DECISION
+    static float scores[POSTERIOR_MAX_CLASSES]; // Logit margins
+    size_t max_index = LogitDecision::margins(tflOutputTensor->data.f, scores, num_classes);
+#else
+    const float *scores = tflOutputTensor->data.f; // Probabilities
     size_t max_index = 0;
-    float max_value = tflOutputTensor->data.f[0];
-    for (size_t i = 0; i < gesture_len; i++)
-        if (tflOutputTensor->data.f[i] > max_value)
-        {
-            max_value = tflOutputTensor->data.f[i];
+    for (size_t i = 0; i < num_classes; i++)
+        if (scores[i] > scores[max_index])
             max_index = i;
-        }
+#endif
 
-    // Log the inference result
-    log("[Res] [%11d ms] |", millis());
-    for (size_t i = 0; i < gesture_len; i++)
-        log(" [%6s: %4.2f]", gestures[i], tflOutputTensor->data.f[i]);
-    log(" | [%6s: %4.2f]\n", gestures[max_index], max_value);
+    // Log every inference result, gesture transitions are logged at INFO by `GestureLoggingCB`
+    LOG_IF_DEBUG(logInference(max_index));
 
-    // Set LED colour based on the inference result
-    switch (max_index)
-    {
-    case 0: // Refer to `gestures[]` in `model.h` for the full name definition
-        ColourLED.setRGB(0, 0, 0);
-        break;
-    case 1:
-        ColourLED.setRGB(0, 255, 0);
-        break;
-    case 2:
-        ColourLED.setRGB(0, 0, 255);
-        break;
-    case 3:
-        ColourLED.setRGB(255, 0, 0);
-        break;
-
-        // Add more cases if needed
+    // Fuse with the previous inferences, then turn the scores into gesture begin/end events.
+    // Subscribers only run on transitions.
+    Gestures.update(Posteriors.update(scores), millis());
 
-    default: // Unhandled case
-        ColourLED.setRGB(0, 0, 0);
-        log("Gesture id %d unhandled", max_index);
-        break;
-    }
+    // Push buffered log output while waiting for new samples
+    LogBuffer.drain(LOG_DRAIN_BUDGET);
 }
@@ -0,0 +1,13 @@
+#pragma once // Ensures the file is included only once during compilation to prevent multiple definitions
+
+// Log levels, a message is emitted when its level is less than or equal to the configured level.
+#define LOG_LEVEL_NONE 0    // Nothing is logged
+#define LOG_LEVEL_ERROR 1   // Unrecoverable failures
+#define LOG_LEVEL_WARNING 2 // Recoverable problems, e.g. a full IMU FIFO
+#define LOG_LEVEL_INFO 3    // Status messages and inference results
+#define LOG_LEVEL_DEBUG 4   // IMU samples and per-sample diagnostics
+#define LOG_LEVEL_TRACE 5   // Everything else
+
+#define LOG_COMPILE_LEVEL LOG_LEVEL_DEBUG        // Messages above this level are removed at compile time, including the evaluation of their arguments. Use LOG_LEVEL_INFO or lower for production builds.
+#define LOG_RUNTIME_LEVEL_DEFAULT LOG_LEVEL_INFO // Initial runtime verbosity. Can be changed at runtime up to `LOG_COMPILE_LEVEL`.
+#define LOG_IMU_SAMPLE_INTERVAL 1                // Initial sampling interval of IMU sample logs, only every N-th sample is logged.
@@ -0,0 +1,3 @@
+#include "LogLevel.h" // Include the header file for log levels
+
+uint8_t LogLevel::runtime_level = LOG_RUNTIME_LEVEL_DEFAULT;
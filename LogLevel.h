@@ -0,0 +1,79 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include "LogConfig.h"
+
+// Runtime verbosity gate shared by all log call sites
+class LogLevel
+{
+public:
+    // Get the runtime verbosity
+    static uint8_t get(void) { return runtime_level; }
+
+    // Set the runtime verbosity, levels above `LOG_COMPILE_LEVEL` have no effect
+    static void set(uint8_t level) { runtime_level = level; }
+
+    // Check whether messages of `level` are emitted at runtime
+    static bool isEnabled(uint8_t level) { return level <= runtime_level; }
+
+private:
+    static uint8_t runtime_level;
+};
+
+// Run `statement` only every `n`-th time this line is reached. `n` may change at runtime.
+#define LOG_EVERY_N(n, statement)                    \
+    do                                               \
+    {                                                \
+        static uint32_t log_every_n_counter = 0;     \
+        if (++log_every_n_counter >= uint32_t(n))    \
+        {                                            \
+            log_every_n_counter = 0;                 \
+            statement;                               \
+        }                                            \
+    } while (0)
+
+// Run a logging `statement` if its level is enabled at runtime.
+// Levels above `LOG_COMPILE_LEVEL` compile to nothing, so the statement and its arguments are never evaluated.
+#define LOG_IF_ENABLED(level, statement) \
+    do                                   \
+    {                                    \
+        if (LogLevel::isEnabled(level))  \
+        {                                \
+            statement;                   \
+        }                                \
+    } while (0)
+#define LOG_DISABLED(statement) \
+    do                          \
+    {                           \
+    } while (0)
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_IF_ERROR(statement) LOG_IF_ENABLED(LOG_LEVEL_ERROR, statement)
+#else
+#define LOG_IF_ERROR(statement) LOG_DISABLED(statement)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_WARNING
+#define LOG_IF_WARNING(statement) LOG_IF_ENABLED(LOG_LEVEL_WARNING, statement)
+#else
+#define LOG_IF_WARNING(statement) LOG_DISABLED(statement)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_INFO
+#define LOG_IF_INFO(statement) LOG_IF_ENABLED(LOG_LEVEL_INFO, statement)
+#else
+#define LOG_IF_INFO(statement) LOG_DISABLED(statement)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_IF_DEBUG(statement) LOG_IF_ENABLED(LOG_LEVEL_DEBUG, statement)
+#else
+#define LOG_IF_DEBUG(statement) LOG_DISABLED(statement)
+#endif
+
+#if LOG_COMPILE_LEVEL >= LOG_LEVEL_TRACE
+#define LOG_IF_TRACE(statement) LOG_IF_ENABLED(LOG_LEVEL_TRACE, statement)
+#else
+#define LOG_IF_TRACE(statement) LOG_DISABLED(statement)
+#endif
@@ -0,0 +1,83 @@
+#include "LogitDecision.h" // Include the header file for LogitDecision class
+
+#include <tensorflow/lite/micro/kernels/kernel_util.h>
+
+#include <math.h>
+
+// Invoke of the pass-through SOFTMAX: output = input
+static TfLiteStatus PassthroughSoftmaxEval(TfLiteContext *context, TfLiteNode *node)
+{
+    const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, 0);
+    TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, 0);
+    memcpy(tflite::micro::GetTensorData<float>(output), tflite::micro::GetTensorData<float>(input),
+           tflite::micro::ElementCount(*input->dims) * sizeof(float));
+    return kTfLiteOk;
+}
+
+LogitDecision::registration_t LogitDecision::passthroughSoftmax(void)
+{
+    // Keep init and prepare of the real kernel so shapes and types are still checked
+    registration_t registration = tflite::Register_SOFTMAX();
+    registration.invoke = PassthroughSoftmaxEval;
+    return registration;
+}
+
+float LogitDecision::marginThreshold(float probability, size_t num_classes)
+{
+    if (num_classes < 2)
+        return -INFINITY; // A single class always wins
+    if (probability <= 0.0f)
+        return -INFINITY;
+    if (probability >= 1.0f)
+        return INFINITY;
+    return logf((num_classes - 1) * probability / (1.0f - probability));
+}
+
+float LogitDecision::marginBound(float probability)
+{
+    if (probability <= 0.0f)
+        return -INFINITY;
+    if (probability >= 1.0f)
+        return INFINITY;
+    return logf(probability / (1.0f - probability));
+}
+
+size_t LogitDecision::margins(const float *logits, float *margins, size_t num_classes)
+{
+    // Best and second best logit are enough to get every margin
+    size_t best = 0;
+    float first = -INFINITY;
+    float second = -INFINITY;
+    for (size_t i = 0; i < num_classes; i++)
+    {
+        if (logits[i] > first)
+        {
+            second = first;
+            first = logits[i];
+            best = i;
+        }
+        else if (logits[i] > second)
+            second = logits[i];
+    }
+
+    for (size_t i = 0; i < num_classes; i++)
+        margins[i] = logits[i] - ((i == best) ? second : first);
+    return best;
+}
+
+void LogitDecision::probabilities(const float *logits, float *probabilities, size_t num_classes)
+{
+    // Numerically stable softmax
+    float max_logit = logits[0];
+    for (size_t i = 1; i < num_classes; i++)
+        max_logit = std::max(max_logit, logits[i]);
+
+    float sum = 0.0f;
+    for (size_t i = 0; i < num_classes; i++)
+    {
+        probabilities[i] = expf(logits[i] - max_logit);
+        sum += probabilities[i];
+    }
+    for (size_t i = 0; i < num_classes; i++)
+        probabilities[i] /= sum;
+}
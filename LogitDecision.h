@@ -0,0 +1,37 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <TensorFlowLite.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+
+/** Gesture decisions on the logits of the last dense layer instead of the softmax output.
+ * Softmax is monotonic, so the argmax of the logits is the argmax of the probabilities.
+ * A probability threshold T for class i is replaced by a threshold on its margin
+ * m_i = z_i - max_{j != i} z_j over the strongest competitor:
+ *   p_i = 1 / (1 + sum_{j != i} e^(z_j - z_i)) >= 1 / (1 + (N - 1) e^(-m_i))
+ * so m_i >= ln((N - 1) T / (1 - T)) guarantees p_i >= T. The bound is exact for N = 2 and never fires early.
+ * The other way round p_i <= 1 / (1 + e^(-m_i)), so p_i >= T needs m_i >= ln(T / (1 - T)). An exit threshold uses
+ * this bound: a class whose probability is still at least T is never dropped, hysteresis stays as wide as configured.
+ * Thresholds are converted once, the per-inference path has no `expf()`.
+ * */
+class LogitDecision
+{
+public:
+    typedef decltype(tflite::Register_SOFTMAX()) registration_t; // TfLiteRegistration or TFLMRegistration, depending on the TFLM version
+
+    // SOFTMAX kernel that copies its input, so the model output holds the logits
+    static registration_t passthroughSoftmax(void);
+
+    // Margin threshold that guarantees a probability of at least `probability` among `num_classes`
+    static float marginThreshold(float probability, size_t num_classes);
+
+    // Margin every class with a probability of at least `probability` has, whatever the number of classes
+    static float marginBound(float probability);
+
+    // Margin of every class over its strongest competitor. Returns the argmax.
+    static size_t margins(const float *logits, float *margins, size_t num_classes);
+
+    // Softmax probabilities, only meant for logging
+    static void probabilities(const float *logits, float *probabilities, size_t num_classes);
+};
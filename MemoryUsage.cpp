@@ -0,0 +1,39 @@
+#include "MemoryUsage.h" // Include the header file for MemoryUsage class
+
+#include <malloc.h>
+
+MemoryUsage::heap_t MemoryUsage::getHeap(void)
+{
+    const struct mallinfo info = mallinfo();
+    heap_t heap;
+    heap.used = info.uordblks;
+    heap.reserved = info.arena;
+    return heap;
+}
+
+void MemoryUsage::paintStack(void)
+{
+    const osRtxThread_t *thread = static_cast<const osRtxThread_t *>(osThreadGetId());
+    volatile uint32_t *bottom = static_cast<volatile uint32_t *>(thread->stack_mem) + 1; // Keep the magic word RTX checks for overflows
+    volatile uint32_t marker = 0;
+    volatile uint32_t *top = reinterpret_cast<volatile uint32_t *>(reinterpret_cast<uintptr_t>(&marker) - MEMORY_STACK_MARGIN);
+    while (bottom < top)
+        *bottom++ = MEMORY_STACK_FILL;
+}
+
+MemoryUsage::stack_t MemoryUsage::getStack(void)
+{
+    const osRtxThread_t *thread = static_cast<const osRtxThread_t *>(osThreadGetId());
+    const uint32_t *words = static_cast<const uint32_t *>(thread->stack_mem);
+    const size_t count = thread->stack_size / sizeof(uint32_t);
+
+    // The stack grows down, the first overwritten word from the bottom marks the peak
+    size_t untouched = 1;
+    while (untouched < count && words[untouched] == MEMORY_STACK_FILL)
+        untouched++;
+
+    stack_t stack;
+    stack.size = thread->stack_size;
+    stack.peak = (count - untouched) * sizeof(uint32_t);
+    return stack;
+}
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Arduino.h>
+#include <mbed.h>
+
+#define MEMORY_STACK_FILL 0xCCCCCCCC // Pattern painted into unused stack, the fill pattern of RTX
+#define MEMORY_STACK_MARGIN 256      // Bytes below the stack pointer left unpainted, `paintStack()` itself runs there
+
+/** Memory footprint of the sketch for the boot report: heap of the newlib allocator and stack high-water mark.
+ * The sketch keeps interpreters, arena, thread stacks and queues in static storage, so the heap only shows what the core
+ * and libraries allocate. RTX fills thread stacks with a pattern only when stack statistics are compiled into mbed,
+ * so `paintStack()` paints the unused stack of the calling thread itself and `getStack()` finds the deepest word
+ * that was overwritten since. Call both from the same thread, the main thread of `setup()` and `loop()` here.
+ * */
+class MemoryUsage
+{
+public:
+    typedef struct heap
+    {
+        size_t used;     // Bytes in allocated blocks
+        size_t reserved; // Bytes the allocator took from the system, freed blocks included
+    } heap_t;
+
+    typedef struct stack
+    {
+        size_t size; // Stack of the calling thread
+        size_t peak; // Deepest use since `paintStack()`, the whole stack without it
+    } stack_t;
+
+    static heap_t getHeap(void);
+
+    // Fill the stack of the calling thread below the current stack pointer with `MEMORY_STACK_FILL`
+    static void paintStack(void);
+
+    static stack_t getStack(void);
+};
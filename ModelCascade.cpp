@@ -0,0 +1,188 @@
+#include "ModelCascade.h" // Include the header file for ModelCascade class
+
+ModelCascade::ModelCascade(uint8_t *arena, size_t arena_size, size_t gate_arena_size)
+{
+    this->arena = arena;                     // Shared tensor arena
+    this->arena_size = arena_size;           // Size of the shared arena
+    this->gate_arena_size = gate_arena_size; // Leading part of the arena used by the gate
+    gate = nullptr;                          // Created by `begin()`
+    classifier = nullptr;                    // Created by `begin()`
+    features = 0;                            // Derived from the models in `begin()`
+    downsampling = 0;                        // Derived from the models in `begin()`
+    margin = CASCADE_GATE_MARGIN;            // Bias of the gate decision
+    resetStatistics();
+}
+
+TfLiteStatus ModelCascade::begin(const tflite::Model *gate_model, const tflite::Model *classifier_model, const tflite::MicroOpResolver &resolver,
+                                 tflite::MicroProfilerInterface *profiler)
+{
+    if (gate_arena_size >= arena_size)
+        return kTfLiteError;
+
+    // The gate gets the head of the arena, the classifier the rest
+    end();
+    gate = new (gate_storage) tflite::MicroInterpreter(gate_model, resolver, arena, gate_arena_size);
+    classifier = new (classifier_storage) tflite::MicroInterpreter(classifier_model, resolver, arena + gate_arena_size, arena_size - gate_arena_size, nullptr, profiler);
+    if (gate->AllocateTensors() != kTfLiteOk || classifier->AllocateTensors() != kTfLiteOk)
+        return kTfLiteError;
+
+    return checkCompatible() ? kTfLiteOk : kTfLiteError;
+}
+
+TfLiteStatus ModelCascade::runGate(bool *motion)
+{
+    downsample();
+
+    const uint32_t start = micros();
+    const TfLiteStatus status = gate->Invoke();
+    statistics.time[STAGE_GATE] += micros() - start;
+    statistics.invocations[STAGE_GATE]++;
+
+    *motion = (status == kTfLiteOk) && isMotion();
+    if (*motion)
+        statistics.flagged++;
+    return status;
+}
+
+TfLiteStatus ModelCascade::runClassifier(void)
+{
+    const uint32_t start = micros();
+    const TfLiteStatus status = classifier->Invoke();
+    statistics.time[STAGE_CLASSIFIER] += micros() - start;
+    statistics.invocations[STAGE_CLASSIFIER]++;
+    return status;
+}
+
+TfLiteStatus ModelCascade::invoke(bool *classified)
+{
+    bool motion = false;
+    *classified = false;
+    const TfLiteStatus status = runGate(&motion);
+    if (status != kTfLiteOk || !motion)
+        return status;
+
+    *classified = true;
+    return runClassifier();
+}
+
+tflite::MicroInterpreter *ModelCascade::getGate(void) const
+{
+    return gate;
+}
+
+tflite::MicroInterpreter *ModelCascade::getClassifier(void) const
+{
+    return classifier;
+}
+
+size_t ModelCascade::getDownsampling(void) const
+{
+    return downsampling;
+}
+
+size_t ModelCascade::getArenaUsed(stage_t stage) const
+{
+    const tflite::MicroInterpreter *interpreter = (stage == STAGE_GATE) ? gate : classifier;
+    return interpreter ? interpreter->arena_used_bytes() : 0;
+}
+
+void ModelCascade::setMargin(float margin)
+{
+    this->margin = margin;
+}
+
+ModelCascade::statistics_t ModelCascade::getStatistics(void) const
+{
+    return statistics;
+}
+
+void ModelCascade::resetStatistics(void)
+{
+    memset(&statistics, 0, sizeof(statistics));
+}
+
+void ModelCascade::end(void)
+{
+    // Constructed with placement new, the arena is simply reused
+    if (gate != nullptr)
+        gate->~MicroInterpreter();
+    if (classifier != nullptr)
+        classifier->~MicroInterpreter();
+    gate = nullptr;
+    classifier = nullptr;
+}
+
+bool ModelCascade::checkCompatible(void)
+{
+    if (gate->inputs_size() != 1 || gate->outputs_size() != 1 || classifier->inputs_size() != 1 || classifier->outputs_size() != 1)
+        return false;
+
+    const TfLiteTensor *window = classifier->input(0);
+    const TfLiteTensor *gate_input = gate->input(0);
+    const TfLiteTensor *gate_output = gate->output(0);
+    if (window->type != kTfLiteFloat32 || gate_input->type != kTfLiteFloat32 || gate_output->type != kTfLiteFloat32)
+        return false;
+    if (window->dims->size < 2 || elementCount(gate_output) == 0)
+        return false;
+
+    // [..., samples, features] of the classifier, the gate has to hold a whole number of samples
+    features = window->dims->data[window->dims->size - 1];
+    const size_t samples = window->dims->data[window->dims->size - 2];
+    const size_t gate_elements = elementCount(gate_input);
+    if (features == 0 || gate_elements == 0 || gate_elements % features != 0)
+        return false;
+
+    const size_t gate_samples = gate_elements / features;
+    if (samples % gate_samples != 0)
+        return false;
+    downsampling = samples / gate_samples;
+
+    // A multi-class gate needs its idle class
+    const size_t classes = elementCount(gate_output);
+    return classes == 1 || classes > CASCADE_IDLE_INDEX;
+}
+
+void ModelCascade::downsample(void)
+{
+    const float *window = classifier->input(0)->data.f;
+    float *output = gate->input(0)->data.f;
+    const size_t gate_samples = elementCount(gate->input(0)) / features;
+    const float scale = 1.0f / downsampling;
+
+    for (size_t sample = 0; sample < gate_samples; sample++)
+    {
+        const float *block = window + sample * downsampling * features;
+        for (size_t feature = 0; feature < features; feature++)
+        {
+            float sum = 0.0f;
+            for (size_t i = 0; i < downsampling; i++)
+                sum += block[i * features + feature];
+            output[sample * features + feature] = sum * scale;
+        }
+    }
+}
+
+bool ModelCascade::isMotion(void) const
+{
+    const TfLiteTensor *output = gate->output(0);
+    const size_t classes = elementCount(output);
+    const float *scores = output->data.f;
+
+    // A single output is the motion logit against an idle logit of 0
+    if (classes == 1)
+        return scores[0] + margin >= 0.0f;
+
+    float best = -INFINITY;
+    for (size_t i = 0; i < classes; i++)
+        if (i != CASCADE_IDLE_INDEX && scores[i] > best)
+            best = scores[i];
+    return best + margin >= scores[CASCADE_IDLE_INDEX];
+}
+
+size_t ModelCascade::elementCount(const TfLiteTensor *tensor)
+{
+    size_t count = 1;
+    for (int i = 0; i < tensor->dims->size; i++)
+        count *= tensor->dims->data[i];
+    return count;
+}
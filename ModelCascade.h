@@ -0,0 +1,103 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <new>
+
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/micro/micro_op_resolver.h>
+#include <tensorflow/lite/micro/micro_profiler_interface.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+
+#define CASCADE_GATE_MARGIN 0.0f // Motion wins once its best score plus this margin reaches the idle score. Raise it to miss fewer gestures.
+#define CASCADE_IDLE_INDEX 0     // Output index of the idle class of a multi-class gate model
+
+/** Two-stage inference: a small gate model runs on every window, the classifier only when the gate flags motion.
+ * Both interpreters share one arena, the gate takes the first `gate_arena_size` bytes.
+ * Like the one of `ModelRegistry`, they are built in static storage inside the cascade, so `begin()` never touches the heap.
+ * The window is written to the classifier input, the gate sees it downsampled by averaging consecutive samples.
+ *
+ * Two models are compatible when
+ *   both have a single float32 input and output,
+ *   the classifier input ends in [samples, features] and the gate input holds `samples / k` samples of the same features,
+ *   the gate output is either one motion score, compared against an implicit idle score of 0 (a logit),
+ *   or one score per class with idle at `CASCADE_IDLE_INDEX`.
+ * */
+class ModelCascade
+{
+public:
+    typedef enum stage
+    {
+        STAGE_GATE,       // Small model on the downsampled window
+        STAGE_CLASSIFIER, // Full model
+        STAGE_COUNT,
+    } stage_t;
+
+    typedef struct statistics
+    {
+        uint32_t invocations[STAGE_COUNT]; // `Invoke()` calls per stage
+        uint32_t time[STAGE_COUNT];        // Time spent in `Invoke()` per stage in microseconds
+        uint32_t flagged;                  // Windows the gate passed on to the classifier
+    } statistics_t;
+
+    // Constructor, `arena` is shared by both stages
+    ModelCascade(uint8_t *arena, size_t arena_size, size_t gate_arena_size);
+
+    // Create and allocate both interpreters, a second call destroys the previous ones first. `profiler` only records the classifier.
+    // Returns kTfLiteError if an allocation fails or the models are not compatible.
+    TfLiteStatus begin(const tflite::Model *gate, const tflite::Model *classifier, const tflite::MicroOpResolver &resolver,
+                       tflite::MicroProfilerInterface *profiler = nullptr);
+
+    // Run the gate on the current window, `motion` tells whether the classifier should run
+    TfLiteStatus runGate(bool *motion);
+
+    // Run the classifier on the current window
+    TfLiteStatus runClassifier(void);
+
+    // Run the gate and, if it flags motion, the classifier. `classified` tells whether the classifier output is new.
+    TfLiteStatus invoke(bool *classified);
+
+    // Interpreters of the stages, nullptr before `begin()`
+    tflite::MicroInterpreter *getGate(void) const;
+    tflite::MicroInterpreter *getClassifier(void) const;
+
+    // Samples of the classifier window averaged into one gate sample
+    size_t getDownsampling(void) const;
+
+    // Arena bytes used by a stage
+    size_t getArenaUsed(stage_t stage) const;
+
+    void setMargin(float margin);
+
+    statistics_t getStatistics(void) const;
+    void resetStatistics(void);
+
+private:
+    uint8_t *arena;
+    size_t arena_size;
+    size_t gate_arena_size;
+
+    alignas(tflite::MicroInterpreter) uint8_t gate_storage[sizeof(tflite::MicroInterpreter)];       // Holds the gate interpreter
+    alignas(tflite::MicroInterpreter) uint8_t classifier_storage[sizeof(tflite::MicroInterpreter)]; // Holds the classifier interpreter
+    tflite::MicroInterpreter *gate;                                                                  // Points into `gate_storage` after `begin()`
+    tflite::MicroInterpreter *classifier;                                                            // Points into `classifier_storage` after `begin()`
+    size_t features;     // Values per sample
+    size_t downsampling; // Classifier samples per gate sample
+    float margin;
+
+    statistics_t statistics;
+
+    // Destroy both interpreters in place
+    void end(void);
+
+    // Check the shapes and derive `features` and `downsampling`
+    bool checkCompatible(void);
+
+    // Average the classifier window into the gate input
+    void downsample(void);
+
+    // Whether the gate output flags motion
+    bool isMotion(void) const;
+
+    static size_t elementCount(const TfLiteTensor *tensor);
+};
@@ -0,0 +1,151 @@
+#include "ModelRegistry.h" // Include the header file for ModelRegistry class
+
+ModelRegistry::ModelRegistry(uint8_t *arena, size_t arena_size, const tflite::MicroOpResolver &resolver, tflite::MicroProfilerInterface *profiler)
+    : resolver(resolver) // Op resolver shared by all models
+{
+    this->arena = arena;               // Shared tensor arena
+    this->arena_size = arena_size;     // Size of the shared arena
+    this->profiler = profiler;         // Optional profiler of every interpreter
+    num_entries = 0;                   // No models yet
+    interpreter = nullptr;             // No model active
+    model = nullptr;                   // No model active
+    active = MODEL_NONE;               // No model active
+    last_switch = {0, 0, 0, 0, false}; // Nothing switched yet
+}
+
+ModelRegistry::~ModelRegistry()
+{
+    unload();
+}
+
+bool ModelRegistry::add(const model_entry_t &entry)
+{
+    if (num_entries >= MODEL_REGISTRY_MAX_MODELS)
+        return false;
+    entries[num_entries++] = entry;
+    return true;
+}
+
+size_t ModelRegistry::getCount(void) const
+{
+    return num_entries;
+}
+
+const ModelRegistry::model_entry_t &ModelRegistry::getEntry(size_t index) const
+{
+    return entries[index];
+}
+
+TfLiteStatus ModelRegistry::activate(size_t index)
+{
+    if (index >= num_entries)
+        return kTfLiteError;
+
+    const size_t previous = active;
+    const uint32_t start = micros();
+    unload();
+    const uint32_t teardown = micros() - start;
+
+    if (load(index) == kTfLiteOk)
+    {
+        last_switch.teardown = teardown;
+        return kTfLiteOk;
+    }
+
+    // Bring the previous model back, the arena holds nothing of it anymore
+    const switch_report_t failed = last_switch;
+    unload();
+    if (previous != MODEL_NONE)
+        load(previous);
+    last_switch = failed;
+    last_switch.teardown = teardown;
+    return kTfLiteError;
+}
+
+tflite::MicroInterpreter *ModelRegistry::getInterpreter(void) const
+{
+    return interpreter;
+}
+
+const tflite::Model *ModelRegistry::getModel(void) const
+{
+    return model;
+}
+
+const ModelRegistry::model_entry_t *ModelRegistry::getActive(void) const
+{
+    return (active != MODEL_NONE) ? &entries[active] : nullptr;
+}
+
+size_t ModelRegistry::getActiveIndex(void) const
+{
+    return active;
+}
+
+ModelRegistry::switch_report_t ModelRegistry::getLastSwitch(void) const
+{
+    return last_switch;
+}
+
+TfLiteStatus ModelRegistry::load(size_t index)
+{
+    const model_entry_t &entry = entries[index];
+    last_switch = {0, 0, 0, 0, false};
+
+    uint32_t start = micros();
+    const tflite::Model *candidate = tflite::GetModel(entry.data);
+    if (candidate == nullptr || candidate->version() != TFLITE_SCHEMA_VERSION)
+        return kTfLiteError;
+    interpreter = new (storage) tflite::MicroInterpreter(candidate, resolver, arena, arena_size, nullptr, profiler);
+    last_switch.construction = micros() - start;
+    last_switch.offline_plan = hasOfflinePlan(candidate);
+
+    start = micros();
+    const TfLiteStatus status = interpreter->AllocateTensors();
+    last_switch.allocation = micros() - start;
+    if (status != kTfLiteOk)
+        return kTfLiteError;
+    last_switch.arena_used = interpreter->arena_used_bytes();
+
+    // The sketch fills the input and reads the output based on the entry
+    const TfLiteTensor *input = interpreter->input(0);
+    const TfLiteTensor *output = interpreter->output(0);
+    if (input->type != kTfLiteFloat32 || elementCount(input) != entry.num_samples * entry.num_features)
+        return kTfLiteError;
+    if (output->type != kTfLiteFloat32 || elementCount(output) != entry.num_labels)
+        return kTfLiteError;
+
+    model = candidate;
+    active = index;
+    return kTfLiteOk;
+}
+
+bool ModelRegistry::hasOfflinePlan(const tflite::Model *model)
+{
+    if (model == nullptr || model->metadata() == nullptr)
+        return false;
+    for (uint32_t i = 0; i < model->metadata()->size(); i++)
+    {
+        const tflite::Metadata *metadata = model->metadata()->Get(i);
+        if (metadata->name() != nullptr && strcmp(metadata->name()->c_str(), MODEL_OFFLINE_PLAN_METADATA) == 0)
+            return true;
+    }
+    return false;
+}
+
+void ModelRegistry::unload(void)
+{
+    if (interpreter != nullptr)
+        interpreter->~MicroInterpreter(); // Constructed with placement new, the arena is simply reused
+    interpreter = nullptr;
+    model = nullptr;
+    active = MODEL_NONE;
+}
+
+size_t ModelRegistry::elementCount(const TfLiteTensor *tensor)
+{
+    size_t count = 1;
+    for (int i = 0; i < tensor->dims->size; i++)
+        count *= tensor->dims->data[i];
+    return count;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <new>
+
+#include <tensorflow/lite/micro/micro_interpreter.h>
+#include <tensorflow/lite/micro/micro_op_resolver.h>
+#include <tensorflow/lite/micro/micro_profiler_interface.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+
+#define MODEL_REGISTRY_MAX_MODELS 4 // Maximum number of models in flash
+#define MODEL_NONE SIZE_MAX         // No model active
+
+#define MODEL_OFFLINE_PLAN_METADATA "OfflineMemoryAllocation" // Arena plan written by `tools/memory_plan.py`
+
+/** Several models in flash, one of them active at a time.
+ * The interpreter of the active model lives in static storage inside the registry and the tensor arena is reused,
+ * so switching neither touches the heap nor leaks: the old interpreter is destroyed in place before the new one is built.
+ * If the new model does not fit the arena or does not match its entry, the previous model is restored.
+ * */
+class ModelRegistry
+{
+public:
+    typedef struct model_entry
+    {
+        const char *name;          // Shown when switching
+        const unsigned char *data; // Flatbuffer, e.g. `model_data`
+        const char *const *labels; // Class names, e.g. `gestures`
+        size_t num_labels;         // Entries in `labels`, must match the output size
+        size_t num_samples;        // Samples per window, the input holds `num_samples * num_features` values
+        size_t num_features;       // Values per sample
+    } model_entry_t;
+
+    typedef struct switch_report
+    {
+        uint32_t teardown;     // Time to destroy the previous interpreter in microseconds
+        uint32_t construction; // Time to read the model and construct the interpreter in microseconds
+        uint32_t allocation;   // Time spent in `AllocateTensors()` in microseconds
+        size_t arena_used;     // Arena bytes used by the new model
+        bool offline_plan;     // The model carries its arena plan, `AllocateTensors()` only places what it leaves out
+    } switch_report_t;
+
+    // Constructor, all models share `arena`, `resolver` and `profiler`
+    ModelRegistry(uint8_t *arena, size_t arena_size, const tflite::MicroOpResolver &resolver, tflite::MicroProfilerInterface *profiler = nullptr);
+
+    // Destroy the active interpreter
+    ~ModelRegistry();
+
+    // Add a model. Returns false if the registry is full.
+    bool add(const model_entry_t &entry);
+
+    size_t getCount(void) const;
+    const model_entry_t &getEntry(size_t index) const;
+
+    // Make a model active. On failure the previous model stays active and kTfLiteError is returned.
+    TfLiteStatus activate(size_t index);
+
+    // Active model, nullptr or MODEL_NONE before the first `activate()`
+    tflite::MicroInterpreter *getInterpreter(void) const;
+    const tflite::Model *getModel(void) const;
+    const model_entry_t *getActive(void) const;
+    size_t getActiveIndex(void) const;
+
+    // Cost of the last `activate()`
+    switch_report_t getLastSwitch(void) const;
+
+    // Whether `model` carries an offline memory plan in its metadata
+    static bool hasOfflinePlan(const tflite::Model *model);
+
+private:
+    uint8_t *arena;
+    size_t arena_size;
+    const tflite::MicroOpResolver &resolver;
+    tflite::MicroProfilerInterface *profiler;
+
+    model_entry_t entries[MODEL_REGISTRY_MAX_MODELS];
+    size_t num_entries;
+
+    alignas(tflite::MicroInterpreter) uint8_t storage[sizeof(tflite::MicroInterpreter)]; // Holds the active interpreter
+    tflite::MicroInterpreter *interpreter;                                               // Points into `storage` while a model is active
+    const tflite::Model *model;
+    size_t active;
+
+    switch_report_t last_switch;
+
+    // Build the interpreter of an entry and check it against the entry
+    TfLiteStatus load(size_t index);
+
+    // Destroy the active interpreter in place
+    void unload(void);
+
+    static size_t elementCount(const TfLiteTensor *tensor);
+};
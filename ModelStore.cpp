@@ -0,0 +1,114 @@
+#include "ModelStore.h" // Include the header file for ModelStore class
+
+ModelStore::ModelStore(FlashRegion &flash)
+    : flash(flash) // Region holding the header and the image
+{
+}
+
+const uint8_t *ModelStore::getImage(size_t *size) const
+{
+    if (flash.pageSize() > MODEL_STORE_MAX_PAGE_SIZE || flash.size() <= flash.sectorSize())
+        return nullptr;
+
+    image_header_t header;
+    memcpy(&header, flash.data(), sizeof(header));
+    if (header.magic != MODEL_STORE_MAGIC || header.header_crc != headerCrc(header))
+        return nullptr; // Erased or interrupted
+    if (header.size == 0 || header.size > getCapacity())
+        return nullptr;
+
+    const uint8_t *image = flash.data() + imageOffset();
+    if (crc32(image, header.size) != header.crc || !tflite::ModelBufferHasIdentifier(image))
+        return nullptr;
+
+    if (size)
+        *size = header.size;
+    return image;
+}
+
+size_t ModelStore::getCapacity(void) const
+{
+    return (flash.size() > imageOffset()) ? flash.size() - imageOffset() : 0;
+}
+
+size_t ModelStore::getPageSize(void) const
+{
+    return flash.pageSize();
+}
+
+bool ModelStore::erase(size_t size)
+{
+    if (size > getCapacity() || flash.pageSize() > MODEL_STORE_MAX_PAGE_SIZE)
+        return false;
+
+    // Header first, from here on there is no valid image
+    if (flash.erase(0, flash.sectorSize()) != 0)
+        return false;
+    return flash.erase(imageOffset(), sectorAlign(size)) == 0;
+}
+
+bool ModelStore::write(size_t offset, const uint8_t *data, size_t length)
+{
+    const size_t page_size = flash.pageSize();
+    if (offset % page_size != 0 || offset + length > getCapacity())
+        return false;
+
+    // Whole pages straight from `data`
+    const size_t whole = length - length % page_size;
+    if (whole && flash.program(imageOffset() + offset, data, whole) != 0)
+        return false;
+    if (whole == length)
+        return true;
+
+    // Last partial page, padded with the erased value
+    memset(page, flash.eraseValue(), page_size);
+    memcpy(page, data + whole, length - whole);
+    return flash.program(imageOffset() + offset + whole, page, page_size) == 0;
+}
+
+bool ModelStore::commit(size_t size, uint32_t crc)
+{
+    const uint8_t *image = flash.data() + imageOffset();
+    if (size == 0 || size > getCapacity() || crc32(image, size) != crc || !tflite::ModelBufferHasIdentifier(image))
+        return false;
+
+    image_header_t header;
+    header.magic = MODEL_STORE_MAGIC;
+    header.size = size;
+    header.crc = crc;
+    header.header_crc = headerCrc(header);
+
+    memset(page, flash.eraseValue(), flash.pageSize());
+    memcpy(page, &header, sizeof(header));
+    if (flash.program(0, page, flash.pageSize()) != 0)
+        return false;
+    return getImage() == image; // Read back through the mapping
+}
+
+uint32_t ModelStore::crc32(const uint8_t *data, size_t length, uint32_t crc)
+{
+    crc = ~crc;
+    while (length--)
+    {
+        crc ^= *data++;
+        for (uint8_t bit = 0; bit < 8; bit++)
+            crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : (crc >> 1);
+    }
+    return ~crc;
+}
+
+size_t ModelStore::imageOffset(void) const
+{
+    return flash.sectorSize();
+}
+
+size_t ModelStore::sectorAlign(size_t length) const
+{
+    const size_t sector_size = flash.sectorSize();
+    return (length + sector_size - 1) / sector_size * sector_size;
+}
+
+uint32_t ModelStore::headerCrc(const image_header_t &header)
+{
+    return crc32(reinterpret_cast<const uint8_t *>(&header), offsetof(image_header_t, header_crc));
+}
@@ -0,0 +1,81 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <tensorflow/lite/schema/schema_generated.h>
+
+#define MODEL_STORE_OFFSET 0xE00000   // Start of the model region in flash, below the 1 MB the mbed core examples use for file systems
+#define MODEL_STORE_SIZE 0x100000     // Size of the model region, the first sector holds the image header
+#define MODEL_STORE_MAX_PAGE_SIZE 256 // Largest program unit of a supported flash
+#define MODEL_STORE_MAGIC 0x4C444F4D  // "MODL"
+
+/** A region of flash.
+ * Implemented by `InternalFlash` on the board and by file-backed stand-ins on the host.
+ * Offsets are relative to the start of the region. `erase()` and `program()` return 0 on success.
+ * */
+class FlashRegion
+{
+public:
+    virtual ~FlashRegion() = default;
+    virtual size_t size(void) const = 0;
+    virtual size_t sectorSize(void) const = 0; // Erase unit
+    virtual size_t pageSize(void) const = 0;   // Program unit
+    virtual uint8_t eraseValue(void) const = 0;
+    virtual const uint8_t *data(void) const = 0; // Memory mapped contents, the interpreter reads the model from here
+    virtual int erase(size_t offset, size_t length) = 0;
+    virtual int program(size_t offset, const void *data, size_t length) = 0;
+};
+
+/** A model image in a flash region.
+ * Layout: [header sector] [image ...]
+ * The image starts at the second sector, so it is aligned for the flatbuffer.
+ * The header is written last, after the CRC of the whole image checked out, and erased first when a new image is written.
+ * An interrupted write therefore never leaves a valid looking image behind.
+ * */
+class ModelStore
+{
+public:
+    typedef struct image_header
+    {
+        uint32_t magic;      // MODEL_STORE_MAGIC
+        uint32_t size;       // Image size in bytes
+        uint32_t crc;        // CRC-32 of the image
+        uint32_t header_crc; // CRC-32 of the fields above
+    } image_header_t;
+
+    // Constructor
+    ModelStore(FlashRegion &flash);
+
+    // The stored model, nullptr if there is no valid image. `size` receives the image size.
+    const uint8_t *getImage(size_t *size = nullptr) const;
+
+    // Largest image that fits
+    size_t getCapacity(void) const;
+
+    // Program unit, image data is written in multiples of it
+    size_t getPageSize(void) const;
+
+    // Invalidate the stored image and erase room for `size` bytes
+    bool erase(size_t size);
+
+    // Write image data. `offset` must be a multiple of the page size, a partial last page is padded.
+    bool write(size_t offset, const uint8_t *data, size_t length);
+
+    // Check the written image against `size` and `crc` and write the header that makes it valid
+    bool commit(size_t size, uint32_t crc);
+
+    // CRC-32 (IEEE 802.3), the same as Python's `zlib.crc32`
+    static uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0);
+
+private:
+    FlashRegion &flash;
+    uint8_t page[MODEL_STORE_MAX_PAGE_SIZE]; // Padded page and header
+
+    // Offset of the image in the region
+    size_t imageOffset(void) const;
+
+    // Round `length` up to whole sectors
+    size_t sectorAlign(size_t length) const;
+
+    static uint32_t headerCrc(const image_header_t &header);
+};
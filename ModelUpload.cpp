@@ -0,0 +1,238 @@
+#include "ModelUpload.h" // Include the header file for ModelUpload class
+
+#define UPLOAD_FRAME_OVERHEAD 5 // Type, sequence and CRC
+
+ModelUpload::ModelUpload(ModelStore &store)
+    : store(store) // Destination of the image
+{
+    state = STATE_IDLE;      // Not receiving
+    frame_length = 0;        // No request bytes yet
+    frame_overflow = false;  // No request bytes yet
+    image_size = 0;          // Set by UPLOAD_BEGIN
+    image_crc = 0;           // Set by UPLOAD_BEGIN
+    next_offset = 0;         // Set by UPLOAD_BEGIN
+    last_offset = 0;         // Set by UPLOAD_DATA
+    begin_time = 0;          // Set by UPLOAD_BEGIN
+    last_receive = 0;        // Set by `start()`
+    replyCallback = nullptr; // Initialize the reply callback as nullptr
+    memset(&statistics, 0, sizeof(statistics));
+}
+
+void ModelUpload::start(uint32_t now)
+{
+    state = STATE_WAITING;
+    frame_length = 0;
+    frame_overflow = false;
+    last_receive = now;
+    memset(&statistics, 0, sizeof(statistics));
+    statistics.result = UPLOAD_ERROR_STATE; // Nothing uploaded yet
+}
+
+void ModelUpload::receive(uint8_t byte, uint32_t now)
+{
+    if (state == STATE_IDLE)
+        return;
+    last_receive = now;
+
+    if (byte != 0x00)
+    {
+        if (frame_length < sizeof(frame))
+            frame[frame_length++] = byte;
+        else
+            frame_overflow = true;
+        return;
+    }
+
+    // Delimiter, empty frames only resynchronize
+    if (frame_length && !frame_overflow)
+        handleFrame();
+    frame_length = 0;
+    frame_overflow = false;
+}
+
+void ModelUpload::update(uint32_t now)
+{
+    if (state == STATE_IDLE || now - last_receive <= MODEL_UPLOAD_TIMEOUT)
+        return;
+
+    // An image in the middle of its transfer is lost, a committed one stays
+    reply(UPLOAD_ABORT, 0, UPLOAD_ERROR_TIMEOUT, next_offset);
+    if (state == STATE_RECEIVING)
+        statistics.result = UPLOAD_ERROR_TIMEOUT;
+    state = STATE_IDLE;
+}
+
+bool ModelUpload::isActive(void) const
+{
+    return state != STATE_IDLE;
+}
+
+ModelUpload::upload_state_t ModelUpload::getState(void) const
+{
+    return state;
+}
+
+ModelUpload::statistics_t ModelUpload::getStatistics(void) const
+{
+    return statistics;
+}
+
+void ModelUpload::registerReplyCallback(const reply_callback_t callback)
+{
+    replyCallback = callback; // Register reply callback function
+}
+
+void ModelUpload::handleFrame(void)
+{
+    const size_t length = BinaryTelemetry::cobsDecode(frame, frame_length, frame);
+    if (length < UPLOAD_FRAME_OVERHEAD || BinaryTelemetry::crc16(frame, length - 2) != (frame[length - 2] | (frame[length - 1] << 8)))
+    {
+        // Nothing in it can be trusted, the host repeats its request
+        reply(request_type_t(0), 0, UPLOAD_ERROR_FRAME, next_offset);
+        return;
+    }
+
+    const request_type_t request = request_type_t(frame[0]);
+    const uint16_t sequence = frame[1] | (frame[2] << 8);
+    const uint8_t *payload = frame + 3;
+    const size_t payload_length = length - UPLOAD_FRAME_OVERHEAD;
+
+    uint32_t value = 0;
+    upload_status_t status = UPLOAD_ERROR_STATE;
+    switch (request)
+    {
+    case UPLOAD_BEGIN:
+        status = begin(payload, payload_length, &value);
+        break;
+    case UPLOAD_DATA:
+        status = data(payload, payload_length, &value);
+        break;
+    case UPLOAD_END:
+        status = end(&value);
+        break;
+    case UPLOAD_ABORT:
+        status = UPLOAD_OK; // Acknowledged, the session ends below
+        break;
+    default:
+        status = UPLOAD_ERROR_FRAME;
+        break;
+    }
+    reply(request, sequence, status, value);
+
+    if (request == UPLOAD_ABORT)
+    {
+        if (state == STATE_RECEIVING)
+            statistics.result = UPLOAD_ERROR_STATE;
+        state = STATE_IDLE;
+    }
+}
+
+ModelUpload::upload_status_t ModelUpload::begin(const uint8_t *payload, size_t length, uint32_t *value)
+{
+    *value = MODEL_UPLOAD_CHUNK_SIZE;
+    if (length != 8)
+        return UPLOAD_ERROR_FRAME;
+    if (MODEL_UPLOAD_CHUNK_SIZE % store.getPageSize() != 0)
+        return UPLOAD_ERROR_FLASH;
+
+    image_size = readU32(payload);
+    image_crc = readU32(payload + 4);
+    if (image_size == 0 || image_size > store.getCapacity())
+    {
+        *value = store.getCapacity();
+        return UPLOAD_ERROR_SIZE;
+    }
+
+    // A repeated UPLOAD_BEGIN starts over
+    begin_time = last_receive;
+    statistics.result = UPLOAD_ERROR_STATE;
+    const uint32_t start = millis();
+    const bool erased = store.erase(image_size);
+    statistics.erase_time += millis() - start;
+    if (!erased)
+    {
+        state = STATE_WAITING;
+        return UPLOAD_ERROR_FLASH;
+    }
+
+    state = STATE_RECEIVING;
+    next_offset = 0;
+    last_offset = 0;
+    statistics.bytes = 0;
+    statistics.chunks = 0;
+    last_receive = millis(); // Erasing took a while
+    return UPLOAD_OK;
+}
+
+ModelUpload::upload_status_t ModelUpload::data(const uint8_t *payload, size_t length, uint32_t *value)
+{
+    *value = next_offset;
+    if (state != STATE_RECEIVING)
+        return UPLOAD_ERROR_STATE;
+    if (length < 4 || length - 4 > MODEL_UPLOAD_CHUNK_SIZE)
+        return UPLOAD_ERROR_FRAME;
+
+    const uint32_t offset = readU32(payload);
+    const uint32_t chunk_length = length - 4;
+
+    // The reply of the last chunk got lost
+    if (next_offset && offset == last_offset)
+    {
+        statistics.repeated++;
+        return UPLOAD_OK;
+    }
+    if (offset != next_offset)
+        return UPLOAD_ERROR_SEQUENCE;
+    if (chunk_length == 0 || offset + chunk_length > image_size)
+        return UPLOAD_ERROR_SIZE;
+    // Only the last chunk may end inside a page
+    if (chunk_length % store.getPageSize() != 0 && offset + chunk_length != image_size)
+        return UPLOAD_ERROR_FRAME;
+
+    const uint32_t start = micros();
+    const bool written = store.write(offset, payload + 4, chunk_length);
+    statistics.program_time += micros() - start;
+    if (!written)
+        return UPLOAD_ERROR_FLASH;
+
+    last_offset = offset;
+    next_offset += chunk_length;
+    statistics.bytes += chunk_length;
+    statistics.chunks++;
+    *value = next_offset;
+    return UPLOAD_OK;
+}
+
+ModelUpload::upload_status_t ModelUpload::end(uint32_t *value)
+{
+    *value = statistics.duration;
+    if (state == STATE_WAITING && statistics.result == UPLOAD_OK)
+        return UPLOAD_OK; // The reply of UPLOAD_END got lost
+    if (state != STATE_RECEIVING)
+        return UPLOAD_ERROR_STATE;
+    if (next_offset != image_size)
+    {
+        *value = next_offset;
+        return UPLOAD_ERROR_SIZE;
+    }
+
+    // Either way the image is complete, the next upload starts with UPLOAD_BEGIN
+    state = STATE_WAITING;
+    statistics.result = store.commit(image_size, image_crc) ? UPLOAD_OK : UPLOAD_ERROR_IMAGE;
+    statistics.duration = millis() - begin_time;
+    *value = statistics.duration;
+    return statistics.result;
+}
+
+void ModelUpload::reply(request_type_t request, uint16_t sequence, upload_status_t status, uint32_t value)
+{
+    if (status != UPLOAD_OK)
+        statistics.errors++;
+    if (replyCallback)
+        replyCallback(request, sequence, status, value);
+}
+
+uint32_t ModelUpload::readU32(const uint8_t *data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (uint32_t(data[3]) << 24);
+}
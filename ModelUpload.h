@@ -0,0 +1,121 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+
+#include "BinaryTelemetry.h"
+#include "ModelStore.h"
+
+#define MODEL_UPLOAD_CHUNK_SIZE 256 // Image bytes per data request, a multiple of the flash page size
+#define MODEL_UPLOAD_TIMEOUT 3000   // Time in ms without a byte from the host before the upload is abandoned
+
+/** Receives a model image from `tools/model_upload.py` into a `ModelStore`.
+ * Requests use the frame layout of `BinaryTelemetry`, COBS encoded and terminated with 0x00:
+ *   [type: u8] [sequence: u16] [payload] [crc: u16]
+ *   UPLOAD_BEGIN  payload [size: u32] [crc32: u32] of the image, erases the store
+ *   UPLOAD_DATA   payload [offset: u32] [up to MODEL_UPLOAD_CHUNK_SIZE image bytes]
+ *   UPLOAD_END    no payload, checks the image and makes it valid
+ *   UPLOAD_ABORT  no payload, ends the session, an incomplete image stays invalid
+ * Every request is answered with a `BinaryTelemetry::FRAME_UPLOAD` frame. The host sends one request at a time and
+ * repeats it when the reply is missing, a repeated chunk or UPLOAD_END that was already handled is acknowledged again.
+ * The session also ends after `MODEL_UPLOAD_TIMEOUT` without a byte, with an UPLOAD_ERROR_TIMEOUT reply.
+ * The reply value is the chunk size for UPLOAD_BEGIN, the next expected offset for UPLOAD_DATA
+ * and the device side duration of the upload in ms for UPLOAD_END.
+ * */
+class ModelUpload
+{
+public:
+    typedef enum request_type : uint8_t
+    {
+        UPLOAD_BEGIN = 0x01,
+        UPLOAD_DATA = 0x02,
+        UPLOAD_END = 0x03,
+        UPLOAD_ABORT = 0x04,
+    } request_type_t;
+
+    typedef enum upload_status : uint8_t
+    {
+        UPLOAD_OK = 0x00,
+        UPLOAD_ERROR_FRAME = 0x01,    // Corrupted or malformed request
+        UPLOAD_ERROR_SEQUENCE = 0x02, // Data for an unexpected offset, the value is the expected one
+        UPLOAD_ERROR_SIZE = 0x03,     // The image does not fit the store
+        UPLOAD_ERROR_FLASH = 0x04,    // Erasing or programming failed
+        UPLOAD_ERROR_IMAGE = 0x05,    // CRC or model identifier of the written image is wrong
+        UPLOAD_ERROR_STATE = 0x06,    // Request not valid in the current state, or the upload was aborted
+        UPLOAD_ERROR_TIMEOUT = 0x07,  // The host went quiet
+    } upload_status_t;
+
+    typedef enum upload_state
+    {
+        STATE_IDLE,      // Not receiving
+        STATE_WAITING,   // Waiting for UPLOAD_BEGIN
+        STATE_RECEIVING, // Between UPLOAD_BEGIN and UPLOAD_END
+    } upload_state_t;
+
+    typedef struct statistics
+    {
+        uint32_t bytes;         // Image bytes written
+        uint32_t chunks;        // Data requests written
+        uint32_t repeated;      // Data requests acknowledged again
+        uint32_t errors;        // Requests answered with an error
+        uint32_t erase_time;    // Time spent erasing in ms
+        uint32_t program_time;  // Time spent programming in us
+        uint32_t duration;      // Time from UPLOAD_BEGIN to UPLOAD_END in ms
+        upload_status_t result; // UPLOAD_OK once an image was committed, otherwise why there is none
+    } statistics_t;
+
+    typedef std::function<void(request_type_t, uint16_t, upload_status_t, uint32_t)> reply_callback_t;
+
+    // Constructor
+    ModelUpload(ModelStore &store);
+
+    // Wait for an upload
+    void start(uint32_t now);
+
+    // Feed a byte received from the host
+    void receive(uint8_t byte, uint32_t now);
+
+    // Abandon the upload once the host went quiet for `MODEL_UPLOAD_TIMEOUT`
+    void update(uint32_t now);
+
+    // Whether `start()` was called and the session did not end yet
+    bool isActive(void) const;
+
+    upload_state_t getState(void) const;
+
+    statistics_t getStatistics(void) const;
+
+    // Register the callback that sends replies to the host, e.g. through `BinaryTelemetry::sendUploadReply()`
+    void registerReplyCallback(reply_callback_t callback);
+
+private:
+    ModelStore &store;
+    upload_state_t state;
+
+    uint8_t frame[MODEL_UPLOAD_CHUNK_SIZE + 16]; // Encoded request until the delimiter, decoded in place
+    size_t frame_length;
+    bool frame_overflow; // Request longer than `frame`, dropped at the delimiter
+
+    uint32_t image_size;
+    uint32_t image_crc;
+    uint32_t next_offset;  // Image bytes written so far
+    uint32_t last_offset;  // Offset of the last chunk written, for repeated requests
+    uint32_t begin_time;   // ms of UPLOAD_BEGIN
+    uint32_t last_receive; // ms of the last byte
+
+    statistics_t statistics;
+
+    reply_callback_t replyCallback;
+
+    // Decode, check and handle a complete request
+    void handleFrame(void);
+
+    upload_status_t begin(const uint8_t *payload, size_t length, uint32_t *value);
+    upload_status_t data(const uint8_t *payload, size_t length, uint32_t *value);
+    upload_status_t end(uint32_t *value);
+
+    void reply(request_type_t request, uint16_t sequence, upload_status_t status, uint32_t value);
+
+    static uint32_t readU32(const uint8_t *data);
+};
@@ -0,0 +1,101 @@
+#include "MotionGate.h" // Include the header file for MotionGate class
+
+MotionGate::MotionGate(uint32_t acc_variance, uint32_t gyro_energy)
+{
+    acc_variance_threshold = acc_variance;
+    gyro_energy_threshold = gyro_energy;
+    statistics = {0, 0};
+    reset();
+}
+
+void MotionGate::update(const int32_t *acceleration, const int32_t *rotation)
+{
+    sample_t &slot = samples[index];
+
+    // Drop the sample leaving the window
+    if (count == MOTION_GATE_WINDOW)
+    {
+        for (size_t axis = 0; axis < 3; axis++)
+        {
+            acc_sum[axis] -= slot.acceleration[axis];
+            acc_squares -= int32_t(slot.acceleration[axis]) * slot.acceleration[axis];
+        }
+        rotation_sum -= slot.rotation_energy;
+    }
+    else
+        count++;
+
+    // Add the new one, clamped to the sensor range
+    uint32_t energy = 0;
+    for (size_t axis = 0; axis < 3; axis++)
+    {
+        slot.acceleration[axis] = constrain(acceleration[axis], INT16_MIN, INT16_MAX);
+        acc_sum[axis] += slot.acceleration[axis];
+        acc_squares += int32_t(slot.acceleration[axis]) * slot.acceleration[axis];
+
+        const int32_t dps = constrain(rotation[axis] / 1000, -4000, 4000);
+        energy += dps * dps;
+    }
+    slot.rotation_energy = energy;
+    rotation_sum += energy;
+
+    index = (index + 1) % MOTION_GATE_WINDOW;
+}
+
+bool MotionGate::shouldInvoke(void)
+{
+    const bool motion = isMotion();
+    statistics.windows++;
+    if (!motion)
+        statistics.gated++;
+    return motion;
+}
+
+bool MotionGate::isMotion(void) const
+{
+    if (count < MOTION_GATE_WINDOW)
+        return true; // Not enough data to rule anything out
+    return getAccelerationVariance() >= acc_variance_threshold || getRotationEnergy() >= gyro_energy_threshold;
+}
+
+uint32_t MotionGate::getAccelerationVariance(void) const
+{
+    if (count == 0)
+        return 0;
+
+    // n * sum(x^2) - sum(x)^2 = n^2 * variance, per axis
+    int64_t scaled = int64_t(count) * acc_squares;
+    for (size_t axis = 0; axis < 3; axis++)
+        scaled -= int64_t(acc_sum[axis]) * acc_sum[axis];
+    return uint32_t(scaled / (int64_t(count) * count));
+}
+
+uint32_t MotionGate::getRotationEnergy(void) const
+{
+    return count ? uint32_t(rotation_sum / count) : 0;
+}
+
+void MotionGate::setThresholds(uint32_t acc_variance, uint32_t gyro_energy)
+{
+    acc_variance_threshold = acc_variance;
+    gyro_energy_threshold = gyro_energy;
+}
+
+MotionGate::statistics_t MotionGate::getStatistics(void) const
+{
+    return statistics;
+}
+
+void MotionGate::resetStatistics(void)
+{
+    statistics = {0, 0};
+}
+
+void MotionGate::reset(void)
+{
+    index = 0;
+    count = 0;
+    memset(acc_sum, 0, sizeof(acc_sum));
+    acc_squares = 0;
+    rotation_sum = 0;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define MOTION_GATE_WINDOW 120        // Samples the statistics are taken over, the sketch checks it against the model window
+#define MOTION_GATE_ACC_VARIANCE 2500 // Accelerometer variance in mG^2 (sum over the axes) that counts as motion, 50 mG RMS
+#define MOTION_GATE_GYRO_ENERGY 400   // Mean gyroscope energy in DPS^2 (sum over the axes) that counts as motion, 20 DPS RMS
+
+/** Cheap motion detector that decides whether a window is worth a full inference.
+ * Keeps running sums over the last `MOTION_GATE_WINDOW` samples, updated in O(1) per sample:
+ *   accelerometer variance, summed over the axes, which ignores gravity and a constant tilt
+ *   mean gyroscope energy, summed over the axes
+ * The window counts as motion once either one reaches its threshold.
+ * All sums are integers, so adding and removing samples never drifts.
+ * */
+class MotionGate
+{
+public:
+    typedef struct statistics
+    {
+        uint32_t windows; // Windows checked with `shouldInvoke()`
+        uint32_t gated;   // Windows reported as idle without inference
+    } statistics_t;
+
+    // Constructor
+    MotionGate(uint32_t acc_variance = MOTION_GATE_ACC_VARIANCE, uint32_t gyro_energy = MOTION_GATE_GYRO_ENERGY);
+
+    // Add a sample, acceleration in mG and rotation in mDPS as X, Y, Z
+    void update(const int32_t *acceleration, const int32_t *rotation);
+
+    // Whether the current window shows motion, counted in the statistics
+    bool shouldInvoke(void);
+
+    // Whether the current window shows motion. Also true until the window is filled.
+    bool isMotion(void) const;
+
+    // Accelerometer variance in mG^2, summed over the axes
+    uint32_t getAccelerationVariance(void) const;
+
+    // Mean gyroscope energy in DPS^2, summed over the axes
+    uint32_t getRotationEnergy(void) const;
+
+    void setThresholds(uint32_t acc_variance, uint32_t gyro_energy);
+
+    // Get and reset the window counters
+    statistics_t getStatistics(void) const;
+    void resetStatistics(void);
+
+    // Forget all samples
+    void reset(void);
+
+private:
+    typedef struct sample
+    {
+        int16_t acceleration[3];  // mG
+        uint32_t rotation_energy; // DPS^2, summed over the axes
+    } sample_t;
+
+    sample_t samples[MOTION_GATE_WINDOW]; // Ring of the window
+    size_t index;                         // Next slot in `samples`
+    size_t count;                         // Valid samples
+
+    int32_t acc_sum[3];    // Sum of the acceleration per axis
+    int64_t acc_squares;   // Sum of the squared acceleration over all axes
+    uint64_t rotation_sum; // Sum of `rotation_energy`
+
+    uint32_t acc_variance_threshold;
+    uint32_t gyro_energy_threshold;
+
+    statistics_t statistics;
+};
@@ -0,0 +1,133 @@
+#include "PosteriorFilter.h" // Include the header file for PosteriorFilter class
+
+PosteriorFilter::PosteriorFilter(size_t num_classes, filter_mode_t mode)
+    : num_classes(std::min<size_t>(num_classes, POSTERIOR_MAX_CLASSES)), mode(mode)
+{
+    alpha = POSTERIOR_EMA_ALPHA;
+    vote_length = POSTERIOR_VOTE_LENGTH;
+    early_commit = POSTERIOR_EARLY_COMMIT;
+    statistics = {0, 0};
+    reset();
+}
+
+const float *PosteriorFilter::update(const float *scores)
+{
+    const size_t best = argmax(scores, num_classes);
+    statistics.updates++;
+
+    // Confident enough on its own, skip the smoothing delay
+    early = (mode != FILTER_NONE) && (scores[best] >= early_commit);
+    if (mode == FILTER_NONE || early || !primed)
+    {
+        memcpy(output, scores, num_classes * sizeof(float));
+        primed = true;
+        if (early)
+            statistics.early_commits++;
+        if (mode == FILTER_MAJORITY)
+            vote(nullptr, best); // Keep the history going
+        return output;
+    }
+
+    switch (mode)
+    {
+    case FILTER_EMA:
+        for (size_t i = 0; i < num_classes; i++)
+            output[i] += alpha * (scores[i] - output[i]);
+        break;
+    case FILTER_MAJORITY:
+        vote(scores, best);
+        break;
+    default:
+        break;
+    }
+    return output;
+}
+
+void PosteriorFilter::reset(void)
+{
+    memset(output, 0, sizeof(output));
+    primed = false;
+    early = false;
+    vote_count = 0;
+    vote_index = 0;
+}
+
+bool PosteriorFilter::isEarlyCommit(void) const
+{
+    return early;
+}
+
+void PosteriorFilter::setNumClasses(size_t num_classes)
+{
+    this->num_classes = std::min<size_t>(num_classes, POSTERIOR_MAX_CLASSES);
+    reset();
+}
+
+void PosteriorFilter::setMode(filter_mode_t mode)
+{
+    this->mode = mode;
+    reset();
+}
+
+PosteriorFilter::filter_mode_t PosteriorFilter::getMode(void) const
+{
+    return mode;
+}
+
+void PosteriorFilter::setAlpha(float alpha)
+{
+    this->alpha = std::min(std::max(alpha, 0.0f), 1.0f);
+}
+
+void PosteriorFilter::setVoteLength(uint8_t length)
+{
+    vote_length = std::min<uint8_t>(std::max<uint8_t>(length, 1), POSTERIOR_MAX_VOTES);
+    reset();
+}
+
+void PosteriorFilter::setEarlyCommit(float threshold)
+{
+    early_commit = threshold;
+}
+
+PosteriorFilter::statistics_t PosteriorFilter::getStatistics(void) const
+{
+    return statistics;
+}
+
+size_t PosteriorFilter::argmax(const float *scores, size_t count)
+{
+    size_t best = 0;
+    for (size_t i = 1; i < count; i++)
+        if (scores[i] > scores[best])
+            best = i;
+    return best;
+}
+
+void PosteriorFilter::vote(const float *scores, size_t best)
+{
+    votes[vote_index] = best;
+    vote_index = (vote_index + 1) % vote_length;
+    if (vote_count < vote_length)
+        vote_count++;
+
+    if (scores == nullptr)
+        return; // Only record the vote
+
+    uint8_t tally[POSTERIOR_MAX_CLASSES] = {0};
+    for (uint8_t i = 0; i < vote_count; i++)
+        tally[votes[i]]++;
+    size_t winner = 0;
+    for (size_t i = 1; i < num_classes; i++)
+        if (tally[i] > tally[winner])
+            winner = i;
+    if (2 * tally[winner] <= vote_count)
+        return; // No majority, hold the previous output
+
+    // The winner keeps its latest score, nobody else may outrank it
+    float lowest = scores[0];
+    for (size_t i = 1; i < num_classes; i++)
+        lowest = std::min(lowest, scores[i]);
+    for (size_t i = 0; i < num_classes; i++)
+        output[i] = (i == winner) ? scores[i] : lowest;
+}
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define POSTERIOR_MAX_CLASSES 8      // Maximum number of classes
+#define POSTERIOR_MAX_VOTES 16       // Maximum majority vote length
+#define POSTERIOR_EMA_ALPHA 0.5f     // Weight of the newest inference in exponential smoothing
+#define POSTERIOR_VOTE_LENGTH 5      // Number of inferences a majority vote is taken over
+#define POSTERIOR_EARLY_COMMIT 0.95f // Probability at which a single inference bypasses the smoothing
+
+/** Fuses the scores of overlapping inferences before they reach the gesture detector.
+ * FILTER_EMA:      exponential moving average of the scores
+ * FILTER_MAJORITY: only the class that won more than half of the last N inferences keeps its score,
+ *                  all others are pushed down to the lowest score. Without a majority the previous output is held.
+ * In both modes a single inference whose best score reaches the early commit threshold
+ * is passed through unchanged, so confident gestures are not delayed by the smoothing.
+ * Scores can be probabilities or logit margins, the thresholds have to be in the same domain.
+ * */
+class PosteriorFilter
+{
+public:
+    typedef enum filter_mode
+    {
+        FILTER_NONE,     // Pass the scores through
+        FILTER_EMA,      // Exponential smoothing
+        FILTER_MAJORITY, // Majority vote over the last N inferences
+    } filter_mode_t;
+
+    typedef struct statistics
+    {
+        uint32_t updates;       // Inferences fused
+        uint32_t early_commits; // Inferences that bypassed the smoothing
+    } statistics_t;
+
+    // Constructor, `num_classes` scores are expected per inference
+    PosteriorFilter(size_t num_classes, filter_mode_t mode = FILTER_NONE);
+
+    // Fuse the scores of one inference. Returns the filtered scores, valid until the next call.
+    const float *update(const float *scores);
+
+    // Forget the history
+    void reset(void);
+
+    // Whether the last update was an early commit
+    bool isEarlyCommit(void) const;
+
+    // Change the number of scores per inference, e.g. after a model switch. Forgets the history.
+    void setNumClasses(size_t num_classes);
+
+    void setMode(filter_mode_t mode);
+    filter_mode_t getMode(void) const;
+    void setAlpha(float alpha);
+    void setVoteLength(uint8_t length);
+    void setEarlyCommit(float threshold);
+
+    // Get the update and early commit counters
+    statistics_t getStatistics(void) const;
+
+private:
+    size_t num_classes;
+    filter_mode_t mode;
+    float alpha;
+    uint8_t vote_length;
+    float early_commit;
+
+    float output[POSTERIOR_MAX_CLASSES]; // Filtered scores
+    bool primed;                         // Whether `output` holds a previous result
+    bool early;                          // Last update was an early commit
+
+    uint8_t votes[POSTERIOR_MAX_VOTES]; // Winners of the last inferences, ring buffer
+    uint8_t vote_count;                 // Valid entries in `votes`
+    uint8_t vote_index;                 // Next slot in `votes`
+
+    statistics_t statistics;
+
+    static size_t argmax(const float *scores, size_t count);
+    void vote(const float *scores, size_t best);
+};
@@ -0,0 +1,197 @@
+#include "SparseFullyConnected.h" // Include the header file for SparseFullyConnected class
+
+#include <tensorflow/lite/micro/kernels/kernel_util.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+
+#include <math.h>
+
+#define SPARSE_FC_INPUT 0          // Input index of the activations
+#define SPARSE_FC_VALUES 1         // Input index of the stored blocks
+#define SPARSE_FC_BIAS 2           // Input index of the optional bias
+#define SPARSE_FC_ROW_POINTERS 3   // Input index of the first block of every block row
+#define SPARSE_FC_COLUMN_INDICES 4 // Input index of the block columns
+#define SPARSE_FC_OUTPUT 0         // Output index
+
+typedef struct sparse_fc_data
+{
+    uint8_t block_rows;   // Output rows per block, 0 if the options cannot be run
+    uint8_t block_cols;   // Input columns per block
+    float activation_min; // Fused activation as a clamp
+    float activation_max;
+} sparse_fc_data_t;
+
+// Accumulate the stored blocks of `BLOCK` output rows, values are consumed strictly in order and skipped blocks cost nothing
+template <int BLOCK>
+static void SparseRows(const sparse_fc_data_t &data, const float *input, const float *values, const float *bias,
+                       const int32_t *row_pointers, const int16_t *column_indices, float *output, int batches, int depth, int units)
+{
+    const int block_cols = data.block_cols;
+    for (int batch = 0; batch < batches; batch++)
+    {
+        const float *block_values = values; // Every batch reads all blocks again
+        for (int unit = 0, block_row = 0; unit < units; unit += BLOCK, block_row++)
+        {
+            float total[BLOCK] = {};
+            for (int32_t block = row_pointers[block_row]; block < row_pointers[block_row + 1]; block++)
+            {
+                // The last block column may extend past the input, its padding weights are zero
+                const int column = column_indices[block] * block_cols;
+                const int columns = std::min(block_cols, depth - column);
+                for (int c = 0; c < columns; c++)
+                {
+                    const float value = input[column + c];
+                    for (int row = 0; row < BLOCK; row++)
+                        total[row] += value * block_values[c * BLOCK + row];
+                }
+                block_values += block_cols * BLOCK;
+            }
+
+            // Same order as the reference kernel: sum, then bias, then activation. Padding rows are dropped.
+            const int rows = std::min(BLOCK, units - unit);
+            for (int row = 0; row < rows; row++)
+            {
+                const float value = total[row] + (bias ? bias[unit + row] : 0.0f);
+                output[unit + row] = std::min(std::max(value, data.activation_min), data.activation_max);
+            }
+        }
+        input += depth;
+        output += units;
+    }
+}
+
+static void *SparseFullyConnectedInit(TfLiteContext *context, const char *buffer, size_t length)
+{
+    sparse_fc_data_t *data = static_cast<sparse_fc_data_t *>(context->AllocatePersistentBuffer(context, sizeof(sparse_fc_data_t)));
+    if (data == nullptr)
+        return nullptr;
+
+    data->block_rows = (buffer != nullptr && length >= 3) ? uint8_t(buffer[0]) : 0;
+    data->block_cols = (buffer != nullptr && length >= 3) ? uint8_t(buffer[1]) : 0;
+    data->activation_min = -INFINITY;
+    data->activation_max = INFINITY;
+    switch ((buffer != nullptr && length >= 3) ? uint8_t(buffer[2]) : uint8_t(tflite::ActivationFunctionType_NONE))
+    {
+    case tflite::ActivationFunctionType_NONE:
+        break;
+    case tflite::ActivationFunctionType_RELU:
+        data->activation_min = 0.0f;
+        break;
+    case tflite::ActivationFunctionType_RELU_N1_TO_1:
+        data->activation_min = -1.0f;
+        data->activation_max = 1.0f;
+        break;
+    case tflite::ActivationFunctionType_RELU6:
+        data->activation_min = 0.0f;
+        data->activation_max = 6.0f;
+        break;
+    default:
+        data->block_rows = 0; // Not a clamp, prepare fails
+        break;
+    }
+    return data;
+}
+
+static TfLiteStatus SparseFullyConnectedPrepare(TfLiteContext *context, TfLiteNode *node)
+{
+    const sparse_fc_data_t *data = static_cast<const sparse_fc_data_t *>(node->user_data);
+    if (data == nullptr || data->block_rows == 0 || data->block_rows > SPARSE_FC_MAX_BLOCK || (data->block_rows & (data->block_rows - 1)))
+        return kTfLiteError;
+    if (data->block_cols == 0 || data->block_cols > SPARSE_FC_MAX_BLOCK)
+        return kTfLiteError;
+    if (node->inputs->size <= SPARSE_FC_COLUMN_INDICES || node->outputs->size != 1)
+        return kTfLiteError;
+
+    const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, SPARSE_FC_INPUT);
+    const TfLiteEvalTensor *values = tflite::micro::GetEvalInput(context, node, SPARSE_FC_VALUES);
+    const TfLiteEvalTensor *bias = tflite::micro::GetEvalInput(context, node, SPARSE_FC_BIAS);
+    const TfLiteEvalTensor *row_pointers = tflite::micro::GetEvalInput(context, node, SPARSE_FC_ROW_POINTERS);
+    const TfLiteEvalTensor *column_indices = tflite::micro::GetEvalInput(context, node, SPARSE_FC_COLUMN_INDICES);
+    const TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, SPARSE_FC_OUTPUT);
+    if (input == nullptr || values == nullptr || row_pointers == nullptr || column_indices == nullptr || output == nullptr)
+        return kTfLiteError;
+    if (input->type != kTfLiteFloat32 || values->type != kTfLiteFloat32 || output->type != kTfLiteFloat32)
+        return kTfLiteError;
+    if (row_pointers->type != kTfLiteInt32 || column_indices->type != kTfLiteInt16)
+        return kTfLiteError;
+    if (input->dims->size == 0 || output->dims->size == 0)
+        return kTfLiteError;
+
+    const int depth = input->dims->data[input->dims->size - 1];
+    const int units = output->dims->data[output->dims->size - 1];
+    const int block_rows = (units + data->block_rows - 1) / data->block_rows;
+    const int block_cols = (depth + data->block_cols - 1) / data->block_cols;
+    const int blocks = tflite::micro::ElementCount(*column_indices->dims);
+    if (depth == 0 || tflite::micro::ElementCount(*output->dims) != tflite::micro::ElementCount(*input->dims) / depth * units)
+        return kTfLiteError;
+    if (tflite::micro::ElementCount(*values->dims) != blocks * data->block_rows * data->block_cols)
+        return kTfLiteError;
+    if (tflite::micro::ElementCount(*row_pointers->dims) != block_rows + 1)
+        return kTfLiteError;
+    if (bias != nullptr && (bias->type != kTfLiteFloat32 || tflite::micro::ElementCount(*bias->dims) != units))
+        return kTfLiteError;
+
+    // The indices come from the model, validate them once so evaluation cannot read past the blocks or the input
+    const int32_t *pointers = tflite::micro::GetTensorData<int32_t>(row_pointers);
+    const int16_t *columns = tflite::micro::GetTensorData<int16_t>(column_indices);
+    if (pointers[0] != 0 || pointers[block_rows] != blocks)
+        return kTfLiteError;
+    for (int row = 0; row < block_rows; row++)
+    {
+        if (pointers[row] > pointers[row + 1])
+            return kTfLiteError;
+        for (int32_t block = pointers[row]; block < pointers[row + 1]; block++)
+            if (columns[block] < 0 || columns[block] >= block_cols || (block > pointers[row] && columns[block] <= columns[block - 1]))
+                return kTfLiteError;
+    }
+    return kTfLiteOk;
+}
+
+static TfLiteStatus SparseFullyConnectedEval(TfLiteContext *context, TfLiteNode *node)
+{
+    const sparse_fc_data_t &data = *static_cast<const sparse_fc_data_t *>(node->user_data);
+    const TfLiteEvalTensor *input = tflite::micro::GetEvalInput(context, node, SPARSE_FC_INPUT);
+    const TfLiteEvalTensor *values = tflite::micro::GetEvalInput(context, node, SPARSE_FC_VALUES);
+    const TfLiteEvalTensor *bias = tflite::micro::GetEvalInput(context, node, SPARSE_FC_BIAS);
+    const TfLiteEvalTensor *row_pointers = tflite::micro::GetEvalInput(context, node, SPARSE_FC_ROW_POINTERS);
+    const TfLiteEvalTensor *column_indices = tflite::micro::GetEvalInput(context, node, SPARSE_FC_COLUMN_INDICES);
+    TfLiteEvalTensor *output = tflite::micro::GetEvalOutput(context, node, SPARSE_FC_OUTPUT);
+
+    const int depth = input->dims->data[input->dims->size - 1];
+    const int units = output->dims->data[output->dims->size - 1];
+    const int batches = tflite::micro::ElementCount(*input->dims) / depth;
+    const float *input_data = tflite::micro::GetTensorData<float>(input);
+    const float *values_data = tflite::micro::GetTensorData<float>(values);
+    const float *bias_data = bias ? tflite::micro::GetTensorData<float>(bias) : nullptr;
+    const int32_t *pointers = tflite::micro::GetTensorData<int32_t>(row_pointers);
+    const int16_t *columns = tflite::micro::GetTensorData<int16_t>(column_indices);
+    float *output_data = tflite::micro::GetTensorData<float>(output);
+
+    // One unrolled loop per block height, checked in prepare
+    switch (data.block_rows)
+    {
+    case 1:
+        SparseRows<1>(data, input_data, values_data, bias_data, pointers, columns, output_data, batches, depth, units);
+        break;
+    case 2:
+        SparseRows<2>(data, input_data, values_data, bias_data, pointers, columns, output_data, batches, depth, units);
+        break;
+    case 4:
+        SparseRows<4>(data, input_data, values_data, bias_data, pointers, columns, output_data, batches, depth, units);
+        break;
+    case 8:
+        SparseRows<8>(data, input_data, values_data, bias_data, pointers, columns, output_data, batches, depth, units);
+        break;
+    default:
+        return kTfLiteError;
+    }
+    return kTfLiteOk;
+}
+
+SparseFullyConnected::registration_t SparseFullyConnected::registration(void)
+{
+    registration_t registration = {};
+    registration.init = SparseFullyConnectedInit;
+    registration.prepare = SparseFullyConnectedPrepare;
+    registration.invoke = SparseFullyConnectedEval;
+    return registration;
+}
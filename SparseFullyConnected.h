@@ -0,0 +1,31 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <TensorFlowLite.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+
+#define SPARSE_FC_NAME "FC_SPARSE" // Custom operator written by `tools/sparsify.py`
+#define SPARSE_FC_MAX_BLOCK 8      // Largest block height and width
+
+/** FULLY_CONNECTED on pruned weights in block compressed sparse row (BCSR) form, written by `tools/sparsify.py`.
+ * The weight matrix [out, in] is cut into blocks of R output rows by C input columns and only blocks with a non-zero
+ * weight are stored, so the kernel neither fetches nor multiplies the pruned ones. Inputs:
+ *   0 input, float32 [batches, in]
+ *   1 values, float32 [blocks, C, R], the weights of every stored block, column by column
+ *   2 bias, float32 [out], optional (index -1)
+ *   3 row pointers, int32 [out / R + 1], first stored block of every block row and the total at the end
+ *   4 column indices, int16 [blocks], input column of every stored block divided by C
+ * Block rows are sorted by column, so every output sums its products in the order of the dense kernel and the
+ * results match FULLY_CONNECTED on the pruned weights. The last block row and column may extend past `out` and `in`,
+ * the converter pads them with zeros. The custom options are [R: u8] [C: u8] [activation: u8],
+ * the activation being the fused ActivationFunctionType of the original layer. R is 1, 2, 4 or 8, C up to 8.
+ * */
+class SparseFullyConnected
+{
+public:
+    typedef decltype(tflite::Register_FULLY_CONNECTED()) registration_t; // TfLiteRegistration or TFLMRegistration, depending on the TFLM version
+
+    // Kernel of the FC_SPARSE custom operator, add it with `AddCustom(SPARSE_FC_NAME, ...)`
+    static registration_t registration(void);
+};
@@ -0,0 +1,206 @@
+#include "TFLMProfiler.h" // Include the header file for TFLM profiler
+
+TFLMProfiler::TFLMProfiler()
+{
+    logCallback = nullptr;          // Initialize the log callback as nullptr
+    cacheCounterCallback = nullptr; // No cache counters
+    for (uint16_t i = 0; i < PROFILER_MAX_EVENTS; i++)
+        stats[i].layer[0] = '\0';
+    reset();
+}
+
+void TFLMProfiler::setLayerNames(const tflite::Model *model)
+{
+    if (model == nullptr || model->subgraphs() == nullptr || model->subgraphs()->size() == 0)
+        return;
+
+    const tflite::SubGraph *subgraph = model->subgraphs()->Get(0);
+    const uint32_t num_operators = subgraph->operators()->size();
+
+    for (uint32_t i = 0; i < num_operators && i < PROFILER_MAX_EVENTS; i++)
+    {
+        // Operators are named after their first output tensor,
+        // e.g. "sequential_13/dense_104/MatMul;sequential_13/dense_104/Relu;..."
+        const int32_t tensor_index = subgraph->operators()->Get(i)->outputs()->Get(0);
+        const char *name = subgraph->tensors()->Get(tensor_index)->name()->c_str();
+
+        // Only look at the first fused name, and take its second-to-last path component ("dense_104")
+        const char *end = strchr(name, ';');
+        if (end == nullptr)
+            end = name + strlen(name);
+        const char *begin = name;
+        const char *last_slash = nullptr;
+        for (const char *c = name; c < end; c++)
+            if (*c == '/')
+            {
+                if (last_slash)
+                    begin = last_slash + 1;
+                last_slash = c;
+            }
+        if (last_slash && begin <= last_slash)
+            end = last_slash;
+
+        size_t length = std::min<size_t>(end - begin, PROFILER_LAYER_NAME_SIZE - 1);
+        memcpy(stats[i].layer, begin, length);
+        stats[i].layer[length] = '\0';
+    }
+}
+
+void TFLMProfiler::beginInvoke(void)
+{
+    event_index = 0;
+    recording = true;
+    invoke_start = micros();
+}
+
+void TFLMProfiler::endInvoke(void)
+{
+    if (!recording)
+        return;
+    accumulate(invoke, micros() - invoke_start);
+    recording = false;
+}
+
+uint32_t TFLMProfiler::BeginEvent(const char *tag)
+{
+    // Ignore events outside of `Invoke()` (e.g. during `AllocateTensors()`) and operators beyond the table size
+    if (!recording || event_index >= PROFILER_MAX_EVENTS)
+        return PROFILER_MAX_EVENTS;
+
+    const uint32_t handle = event_index++;
+    if (event_index > num_ops)
+        num_ops = event_index;
+    stats[handle].tag = tag;
+    if (cacheCounterCallback)
+    {
+        uint32_t accesses, misses;
+        cacheCounterCallback(accesses, misses); // Start counting from here
+    }
+    event_start[handle] = micros();
+    return handle;
+}
+
+void TFLMProfiler::EndEvent(uint32_t event_handle)
+{
+    if (event_handle >= PROFILER_MAX_EVENTS)
+        return;
+    accumulate(stats[event_handle], micros() - event_start[event_handle]);
+    if (cacheCounterCallback)
+    {
+        uint32_t accesses = 0, misses = 0;
+        cacheCounterCallback(accesses, misses);
+        stats[event_handle].total_accesses += accesses;
+        stats[event_handle].total_misses += misses;
+    }
+}
+
+void TFLMProfiler::reset(void)
+{
+    for (uint16_t i = 0; i < PROFILER_MAX_EVENTS; i++)
+        clear(stats[i]);
+    clear(invoke);
+    invoke.layer[0] = '\0';
+    num_ops = 0;
+    event_index = 0;
+    recording = false;
+}
+
+void TFLMProfiler::print(void) const
+{
+    if (invoke.count == 0)
+    {
+        this->sendLog("[Prof] No inference recorded yet.\n");
+        return;
+    }
+
+    const uint32_t invoke_avg = invoke.total_ticks / invoke.count;
+    this->sendLog("[Prof] %u invokes, %u ops, Invoke(): last %lu us, min %lu us, max %lu us, avg %lu us\n",
+                  unsigned(invoke.count), unsigned(num_ops), (unsigned long)invoke.last_ticks, (unsigned long)invoke.min_ticks, (unsigned long)invoke.max_ticks, (unsigned long)invoke_avg);
+    this->sendLog("[Prof] %2s %-16s %-15s %8s %8s %8s %8s %6s\n", "#", "Operator", "Layer", "Last", "Min", "Max", "Avg", "Share");
+
+    for (uint16_t i = 0; i < num_ops; i++)
+    {
+        const op_stats_t &entry = stats[i];
+        if (entry.count == 0)
+            continue;
+        const uint32_t avg = entry.total_ticks / entry.count;
+        const uint32_t share_permille = invoke_avg ? (uint64_t(avg) * 1000 + invoke_avg / 2) / invoke_avg : 0; // Share of the average `Invoke()` time
+        this->sendLog("[Prof] %2u %-16s %-15s %8lu %8lu %8lu %8lu %3lu.%lu%%\n",
+                      unsigned(i), entry.tag ? entry.tag : "?", entry.layer,
+                      (unsigned long)entry.last_ticks, (unsigned long)entry.min_ticks, (unsigned long)entry.max_ticks, (unsigned long)avg,
+                      (unsigned long)(share_permille / 10), (unsigned long)(share_permille % 10));
+    }
+
+    if (!cacheCounterCallback)
+        return;
+    this->sendLog("[Prof] %2s %-16s %-15s %10s %10s %6s\n", "#", "Operator", "Layer", "Accesses", "Misses", "Hits");
+    for (uint16_t i = 0; i < num_ops; i++)
+    {
+        const op_stats_t &entry = stats[i];
+        if (entry.count == 0)
+            continue;
+        const uint32_t hit_permille = entry.total_accesses ? ((entry.total_accesses - entry.total_misses) * 1000 + entry.total_accesses / 2) / entry.total_accesses : 0;
+        this->sendLog("[Prof] %2u %-16s %-15s %10lu %10lu %3lu.%lu%%\n",
+                      unsigned(i), entry.tag ? entry.tag : "?", entry.layer,
+                      (unsigned long)(entry.total_accesses / entry.count), (unsigned long)(entry.total_misses / entry.count),
+                      (unsigned long)(hit_permille / 10), (unsigned long)(hit_permille % 10));
+    }
+}
+
+uint16_t TFLMProfiler::getNumOps(void) const
+{
+    return num_ops;
+}
+
+const TFLMProfiler::op_stats_t *TFLMProfiler::getStats(uint16_t op) const
+{
+    return (op < num_ops) ? &stats[op] : nullptr;
+}
+
+void TFLMProfiler::registerLoggingCallback(const log_callback_t callback)
+{
+    logCallback = callback; // Register logging callback function
+}
+
+void TFLMProfiler::registerCacheCounterCallback(const cache_counter_callback_t callback)
+{
+    cacheCounterCallback = callback; // Register cache counter callback function
+}
+
+void TFLMProfiler::clear(op_stats_t &entry)
+{
+    entry.tag = nullptr;
+    entry.last_ticks = 0;
+    entry.min_ticks = UINT32_MAX;
+    entry.max_ticks = 0;
+    entry.total_ticks = 0;
+    entry.count = 0;
+    entry.total_accesses = 0;
+    entry.total_misses = 0;
+}
+
+void TFLMProfiler::accumulate(op_stats_t &entry, uint32_t ticks)
+{
+    entry.last_ticks = ticks;
+    if (ticks < entry.min_ticks)
+        entry.min_ticks = ticks;
+    if (ticks > entry.max_ticks)
+        entry.max_ticks = ticks;
+    entry.total_ticks += ticks;
+    entry.count++;
+}
+
+int TFLMProfiler::sendLog(const char *format, ...) const
+{
+    if (!logCallback)
+        return 0; // Return if log callback is not set
+
+    char buffer[128]; // Buffer for formatted log message
+    int ret_val;
+    va_list va;
+    va_start(va, format);
+    ret_val = vsnprintf(buffer, sizeof(buffer), format, va); // Format log message
+    va_end(va);
+    logCallback(buffer); // Call the log callback with the formatted message
+    return ret_val;      // Return the formatted message length
+}
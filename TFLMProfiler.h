@@ -0,0 +1,89 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <functional>
+#include <stdarg.h>
+
+#include <tensorflow/lite/micro/micro_profiler_interface.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+
+#define PROFILER_MAX_EVENTS 16     // Maximum number of operators tracked per `Invoke()`. The gesture model has 10.
+#define PROFILER_LAYER_NAME_SIZE 16 // Maximum length of a layer name, including the null terminator
+
+// Per-operator profiler for the TFLM interpreter.
+// TFLM calls `BeginEvent()`/`EndEvent()` around every operator it evaluates, in graph order,
+// so the N-th event of an `Invoke()` always belongs to the N-th operator of the model.
+class TFLMProfiler : public tflite::MicroProfilerInterface
+{
+public:
+    typedef struct op_stats
+    {
+        const char *tag;                      // Operator type reported by TFLM, e.g. "FULLY_CONNECTED"
+        char layer[PROFILER_LAYER_NAME_SIZE]; // Layer name resolved from the model, e.g. "dense_104"
+        uint32_t last_ticks;                  // Duration of the latest run in microseconds
+        uint32_t min_ticks;                   // Shortest run in microseconds
+        uint32_t max_ticks;                   // Longest run in microseconds
+        uint64_t total_ticks;                 // Accumulated duration in microseconds
+        uint32_t count;                       // Number of runs recorded
+        uint64_t total_accesses;              // Accumulated cache accesses, with a cache counter callback
+        uint64_t total_misses;                // Accumulated cache misses
+    } op_stats_t;
+
+    typedef std::function<int(const char *)> log_callback_t;
+
+    // Cache accesses and misses since the previous call, e.g. from `XIPCache::take()`
+    typedef std::function<void(uint32_t &accesses, uint32_t &misses)> cache_counter_callback_t;
+
+    // Constructor
+    TFLMProfiler();
+
+    // Resolve a readable layer name for every operator of the model's first subgraph.
+    // Must be called with the same model that is given to the interpreter.
+    void setLayerNames(const tflite::Model *model);
+
+    // Mark the boundaries of an `Invoke()`. Events outside of these are ignored.
+    void beginInvoke(void);
+    void endInvoke(void);
+
+    // Implements tflite::MicroProfilerInterface
+    uint32_t BeginEvent(const char *tag) override;
+    void EndEvent(uint32_t event_handle) override;
+
+    // Clear all recorded statistics, layer names are kept
+    void reset(void);
+
+    // Print per-operator statistics
+    void print(void) const;
+
+    // Operators seen in a single `Invoke()` and their statistics, nullptr beyond that
+    uint16_t getNumOps(void) const;
+    const op_stats_t *getStats(uint16_t op) const;
+
+    // Register logging callback
+    void registerLoggingCallback(log_callback_t callback);
+
+    // Register the cache counters read around every operator
+    void registerCacheCounterCallback(cache_counter_callback_t callback);
+
+private:
+    op_stats_t stats[PROFILER_MAX_EVENTS];
+    uint32_t event_start[PROFILER_MAX_EVENTS];
+    uint16_t num_ops;      // Highest number of operators seen in a single `Invoke()`
+    uint16_t event_index;  // Index of the next event within the current `Invoke()`
+    bool recording;        // Set between `beginInvoke()` and `endInvoke()`
+    uint32_t invoke_start; // Start time of the current `Invoke()`
+    op_stats_t invoke;     // Whole `Invoke()` statistics
+
+    log_callback_t logCallback;
+    cache_counter_callback_t cacheCounterCallback;
+
+    // Reset the running statistics of an entry
+    static void clear(op_stats_t &entry);
+
+    // Fold a duration into the running statistics
+    static void accumulate(op_stats_t &entry, uint32_t ticks);
+
+    // Log messages
+    int sendLog(const char *format, ...) const;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <type_traits>
+
+#define LOG_TOKEN_FNV_OFFSET 2166136261u // FNV-1a 32-bit offset basis
+#define LOG_TOKEN_FNV_PRIME 16777619u    // FNV-1a 32-bit prime
+#define LOG_TOKEN_MAX_ARGS_SIZE 48       // Maximum size of the encoded arguments of one message
+#define LOG_TOKEN_MAX_STRING 32          // Longest string argument that is sent, longer ones are truncated
+
+// Compile-time token of a format string literal
+#define LOG_TOKEN(format) (std::integral_constant<uint32_t, TokenizedLog::token(format)>::value)
+
+/** Tokenized logging.
+ * Instead of formatting on the device, a message is sent as the FNV-1a hash of its format string
+ * followed by its raw arguments. `tools/log_tokens.py` builds the token to format string table
+ * from the sources and formats the messages on the host.
+ * Arguments are encoded in order as:
+ *   integers, enums, pointers: zigzag varint
+ *   float, double:             float32, little-endian
+ *   strings:                   u8 length followed by the characters
+ * */
+class TokenizedLog
+{
+public:
+    // FNV-1a hash of a null-terminated string
+    static constexpr uint32_t token(const char *string, uint32_t hash = LOG_TOKEN_FNV_OFFSET)
+    {
+        return *string ? token(string + 1, (hash ^ uint8_t(*string)) * LOG_TOKEN_FNV_PRIME) : hash;
+    }
+
+    // Encode `args` into `buffer`. Arguments that do not fit are left out.
+    // Returns the encoded length.
+    template <typename... Args>
+    static size_t encode(uint8_t *buffer, size_t size, Args... args)
+    {
+        size_t length = 0;
+        int expand[] = {0, (length = encodeArgument(buffer, size, length, args), 0)...};
+        (void)expand, (void)buffer, (void)size; // Unused when there are no arguments
+        return length;
+    }
+
+private:
+    static size_t encodeVarint(uint8_t *buffer, size_t size, size_t length, int64_t value)
+    {
+        uint8_t encoded[10];
+        size_t count = 0;
+        uint64_t zigzag = (uint64_t(value) << 1) ^ uint64_t(value >> 63);
+        do
+        {
+            encoded[count] = zigzag & 0x7F;
+            zigzag >>= 7;
+            if (zigzag)
+                encoded[count] |= 0x80;
+            count++;
+        } while (zigzag);
+
+        if (length + count > size)
+            return size; // Mark the buffer as full so no later argument is sent out of place
+        memcpy(buffer + length, encoded, count);
+        return length + count;
+    }
+
+    template <typename T>
+    static typename std::enable_if<std::is_integral<T>::value || std::is_enum<T>::value, size_t>::type
+    encodeArgument(uint8_t *buffer, size_t size, size_t length, T value)
+    {
+        return encodeVarint(buffer, size, length, int64_t(value));
+    }
+
+    static size_t encodeArgument(uint8_t *buffer, size_t size, size_t length, double value)
+    {
+        const float single = value;
+        if (length + sizeof(single) > size)
+            return size;
+        memcpy(buffer + length, &single, sizeof(single));
+        return length + sizeof(single);
+    }
+
+    static size_t encodeArgument(uint8_t *buffer, size_t size, size_t length, const char *value)
+    {
+        if (value == nullptr)
+            value = "(null)";
+        const size_t string_length = std::min<size_t>(strlen(value), LOG_TOKEN_MAX_STRING);
+        if (length + 1 + string_length > size)
+            return size;
+        buffer[length] = string_length;
+        memcpy(buffer + length + 1, value, string_length);
+        return length + 1 + string_length;
+    }
+
+    static size_t encodeArgument(uint8_t *buffer, size_t size, size_t length, const void *value)
+    {
+        return encodeVarint(buffer, size, length, int64_t(uintptr_t(value)));
+    }
+};
@@ -0,0 +1,213 @@
+#include "WeightPlacement.h" // Include the header file for WeightPlacement class
+
+#include <tensorflow/lite/micro/kernels/kernel_util.h>
+#include <tensorflow/lite/schema/schema_utils.h>
+
+#define FULLY_CONNECTED_WEIGHTS 1 // Input index of the weights
+#define FULLY_CONNECTED_BIAS 2    // Input index of the optional bias
+
+WeightPlacement *WeightPlacement::active = nullptr;
+TfLiteStatus (*WeightPlacement::fullyConnectedInvoke)(TfLiteContext *, TfLiteNode *) = nullptr;
+TfLiteStatus (*WeightPlacement::interleavedInvoke)(TfLiteContext *, TfLiteNode *) = nullptr;
+TfLiteStatus (*WeightPlacement::sparseInvoke)(TfLiteContext *, TfLiteNode *) = nullptr;
+
+WeightPlacement::WeightPlacement(uint8_t *pool, size_t pool_size)
+{
+    this->pool = pool;           // Receives the copies
+    this->pool_size = pool_size; // Size of the pool
+    enabled = true;              // Run on the copies
+    num_layers = 0;              // Set by `begin()`
+    memset(&statistics, 0, sizeof(statistics));
+}
+
+size_t WeightPlacement::begin(const tflite::Model *model, uint32_t mask)
+{
+    num_layers = 0;
+    memset(&statistics, 0, sizeof(statistics));
+    active = this;
+    if (model == nullptr || model->subgraphs() == nullptr || model->subgraphs()->size() == 0)
+        return 0;
+
+    const uint32_t start = micros();
+    const auto *operators = model->subgraphs()->Get(0)->operators();
+    size_t used = 0;
+    size_t placed = 0;
+    for (uint32_t i = 0; i < operators->size() && num_layers < WEIGHT_PLACEMENT_MAX_LAYERS; i++)
+    {
+        const tflite::Operator *op = operators->Get(i);
+        if (!isDense(model, op))
+            continue;
+
+        size_t weights_size = 0;
+        size_t bias_size = 0;
+        layer_t &layer = layers[num_layers];
+        layer.op = i;
+        layer.flash = constantData(model, op->inputs()->Get(FULLY_CONNECTED_WEIGHTS), &weights_size);
+        layer.bias = (op->inputs()->size() > FULLY_CONNECTED_BIAS) ? constantData(model, op->inputs()->Get(FULLY_CONNECTED_BIAS), &bias_size) : nullptr;
+        layer.sram = nullptr;
+        layer.sram_bias = nullptr;
+        layer.bytes = weights_size + bias_size;
+        if (layer.flash == nullptr)
+            continue; // Weights computed at runtime, nothing to place
+        num_layers++;
+
+        // Weights and bias back to back, both aligned
+        const size_t weights_slot = (weights_size + WEIGHT_PLACEMENT_ALIGNMENT - 1) & ~size_t(WEIGHT_PLACEMENT_ALIGNMENT - 1);
+        const size_t bias_slot = (bias_size + WEIGHT_PLACEMENT_ALIGNMENT - 1) & ~size_t(WEIGHT_PLACEMENT_ALIGNMENT - 1);
+        const bool selected = (i < 32) && (mask & (1UL << i));
+        if (!selected || used + weights_slot + bias_slot > pool_size)
+        {
+            statistics.flash_bytes += layer.bytes;
+            continue;
+        }
+
+        layer.sram = pool + used;
+        memcpy(layer.sram, layer.flash, weights_size);
+        if (layer.bias)
+        {
+            layer.sram_bias = pool + used + weights_slot;
+            memcpy(layer.sram_bias, layer.bias, bias_size);
+        }
+        used += weights_slot + bias_slot;
+        statistics.placed_bytes += layer.bytes;
+        placed++;
+    }
+    statistics.copy_time = micros() - start;
+    return placed;
+}
+
+void WeightPlacement::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+bool WeightPlacement::isEnabled(void) const
+{
+    return enabled;
+}
+
+size_t WeightPlacement::getLayerCount(void) const
+{
+    return num_layers;
+}
+
+const WeightPlacement::layer_t &WeightPlacement::getLayer(size_t index) const
+{
+    return layers[index];
+}
+
+bool WeightPlacement::isPlaced(uint16_t op) const
+{
+    for (size_t i = 0; i < num_layers; i++)
+        if (layers[i].op == op)
+            return enabled && layers[i].sram != nullptr;
+    return false;
+}
+
+WeightPlacement::statistics_t WeightPlacement::getStatistics(void) const
+{
+    return statistics;
+}
+
+WeightPlacement::registration_t WeightPlacement::placedFullyConnected(void)
+{
+    // Keep init and prepare of the real kernel, only the weights it reads change
+    registration_t registration = tflite::Register_FULLY_CONNECTED();
+    fullyConnectedInvoke = registration.invoke;
+    registration.invoke = placedFullyConnectedEval;
+    return registration;
+}
+
+WeightPlacement::registration_t WeightPlacement::placedInterleavedFullyConnected(void)
+{
+    registration_t registration = InterleavedFullyConnected::registration();
+    interleavedInvoke = registration.invoke;
+    registration.invoke = placedInterleavedEval;
+    return registration;
+}
+
+WeightPlacement::registration_t WeightPlacement::placedSparseFullyConnected(void)
+{
+    registration_t registration = SparseFullyConnected::registration();
+    sparseInvoke = registration.invoke;
+    registration.invoke = placedSparseEval;
+    return registration;
+}
+
+TfLiteStatus WeightPlacement::placedFullyConnectedEval(TfLiteContext *context, TfLiteNode *node)
+{
+    redirectInputs(context, node);
+    return fullyConnectedInvoke(context, node);
+}
+
+TfLiteStatus WeightPlacement::placedInterleavedEval(TfLiteContext *context, TfLiteNode *node)
+{
+    redirectInputs(context, node);
+    return interleavedInvoke(context, node);
+}
+
+TfLiteStatus WeightPlacement::placedSparseEval(TfLiteContext *context, TfLiteNode *node)
+{
+    redirectInputs(context, node);
+    return sparseInvoke(context, node);
+}
+
+void WeightPlacement::redirectInputs(TfLiteContext *context, TfLiteNode *node)
+{
+    if (active == nullptr)
+        return;
+    active->redirect(tflite::micro::GetMutableEvalInput(context, node, FULLY_CONNECTED_WEIGHTS));
+    if (node->inputs->size > FULLY_CONNECTED_BIAS && node->inputs->data[FULLY_CONNECTED_BIAS] >= 0)
+        active->redirect(tflite::micro::GetMutableEvalInput(context, node, FULLY_CONNECTED_BIAS));
+}
+
+void WeightPlacement::redirect(TfLiteEvalTensor *tensor)
+{
+    if (tensor == nullptr)
+        return;
+
+    // The eval tensors of constants persist, so they point wherever the last evaluation left them
+    const void *data = tensor->data.data;
+    for (size_t i = 0; i < num_layers; i++)
+    {
+        layer_t &layer = layers[i];
+        if (layer.sram == nullptr)
+            continue;
+        if (data == layer.flash || data == layer.sram)
+        {
+            tensor->data.data = enabled ? layer.sram : const_cast<void *>(layer.flash);
+            if (enabled)
+                statistics.redirected++;
+            return;
+        }
+        if (data == layer.bias || data == layer.sram_bias)
+        {
+            tensor->data.data = enabled ? layer.sram_bias : const_cast<void *>(layer.bias);
+            return;
+        }
+    }
+}
+
+bool WeightPlacement::isDense(const tflite::Model *model, const tflite::Operator *op)
+{
+    const tflite::OperatorCode *code = model->operator_codes()->Get(op->opcode_index());
+    const tflite::BuiltinOperator builtin = tflite::GetBuiltinCode(code);
+    if (builtin == tflite::BuiltinOperator_FULLY_CONNECTED)
+        return true;
+    if (builtin != tflite::BuiltinOperator_CUSTOM || code->custom_code() == nullptr)
+        return false;
+    return strcmp(code->custom_code()->c_str(), INTERLEAVED_FC_NAME) == 0 || strcmp(code->custom_code()->c_str(), SPARSE_FC_NAME) == 0;
+}
+
+const uint8_t *WeightPlacement::constantData(const tflite::Model *model, int32_t tensor_index, size_t *size)
+{
+    *size = 0;
+    if (tensor_index < 0)
+        return nullptr;
+    const tflite::Tensor *tensor = model->subgraphs()->Get(0)->tensors()->Get(tensor_index);
+    const tflite::Buffer *buffer = model->buffers()->Get(tensor->buffer());
+    if (buffer == nullptr || buffer->data() == nullptr || buffer->data()->size() == 0)
+        return nullptr;
+    *size = buffer->data()->size();
+    return buffer->data()->data();
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <Arduino.h>
+
+#include <TensorFlowLite.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+#include <tensorflow/lite/schema/schema_generated.h>
+
+#include "InterleavedFullyConnected.h"
+#include "SparseFullyConnected.h"
+
+#define WEIGHT_PLACEMENT_MAX_LAYERS 16  // Maximum number of FULLY_CONNECTED layers tracked
+#define WEIGHT_PLACEMENT_ALL 0xFFFFFFFF // Layer mask selecting every layer
+#define WEIGHT_PLACEMENT_ALIGNMENT 16   // Alignment of the copies in the pool
+
+/** Copies of the weights of selected FULLY_CONNECTED (or FC_INTERLEAVED, FC_SPARSE) layers in SRAM.
+ * The model stays in flash, where every weight fetch goes through the 16 KB XIP cache of the RP2040.
+ * The dense layers are much larger than that cache, so each `Invoke()` streams them from the QSPI flash again.
+ * `begin()` copies the weights and bias of the selected layers into `pool`, in operator order, skipping
+ * layers that no longer fit. The FULLY_CONNECTED kernel of `placedFullyConnected()` then points the
+ * weight tensors at the copies right before every evaluation, so placement can be toggled at runtime
+ * to measure the speedup per layer with the profiler.
+ * */
+class WeightPlacement
+{
+public:
+    typedef decltype(tflite::Register_FULLY_CONNECTED()) registration_t; // TfLiteRegistration or TFLMRegistration, depending on the TFLM version
+
+    typedef struct layer
+    {
+        uint16_t op;       // Operator index in the model
+        const void *flash; // Weights in the model
+        const void *bias;  // Bias in the model, nullptr without one
+        void *sram;        // Weight copy in the pool, nullptr if the layer stays in flash
+        void *sram_bias;   // Bias copy in the pool
+        size_t bytes;      // Weights and bias
+    } layer_t;
+
+    typedef struct statistics
+    {
+        uint32_t copy_time;  // Time spent copying in `begin()` in microseconds
+        size_t placed_bytes; // Bytes copied to the pool
+        size_t flash_bytes;  // Bytes of layers left in flash
+        uint32_t redirected; // Evaluations that ran on a copy
+    } statistics_t;
+
+    // Constructor, `pool` receives the copies
+    WeightPlacement(uint8_t *pool, size_t pool_size);
+
+    // Copy the layers of `model` selected by `mask`, a mask of operator indices. Returns the number of layers copied.
+    // Call it once per interpreter, a second call leaves tensors pointing at the old copies.
+    size_t begin(const tflite::Model *model, uint32_t mask = WEIGHT_PLACEMENT_ALL);
+
+    // Use the copies (default) or the weights in flash
+    void setEnabled(bool enabled);
+    bool isEnabled(void) const;
+
+    // FULLY_CONNECTED layers of the model
+    size_t getLayerCount(void) const;
+    const layer_t &getLayer(size_t index) const;
+
+    // Whether the weights of operator `op` run from SRAM
+    bool isPlaced(uint16_t op) const;
+
+    statistics_t getStatistics(void) const;
+
+    // FULLY_CONNECTED kernel that runs on the copies of the active placement
+    static registration_t placedFullyConnected(void);
+
+    // `InterleavedFullyConnected` kernel that runs on the copies of the active placement
+    static registration_t placedInterleavedFullyConnected(void);
+
+    // `SparseFullyConnected` kernel that runs on the copies of the active placement, the block indices stay in flash
+    static registration_t placedSparseFullyConnected(void);
+
+private:
+    uint8_t *pool;
+    size_t pool_size;
+    bool enabled;
+
+    layer_t layers[WEIGHT_PLACEMENT_MAX_LAYERS];
+    size_t num_layers;
+
+    statistics_t statistics;
+
+    // Kernels have no user data, they find the copies through the placement that ran `begin()` last
+    static WeightPlacement *active;
+
+    // Invoke of the real kernels
+    static TfLiteStatus (*fullyConnectedInvoke)(TfLiteContext *context, TfLiteNode *node);
+    static TfLiteStatus (*interleavedInvoke)(TfLiteContext *context, TfLiteNode *node);
+    static TfLiteStatus (*sparseInvoke)(TfLiteContext *context, TfLiteNode *node);
+
+    static TfLiteStatus placedFullyConnectedEval(TfLiteContext *context, TfLiteNode *node);
+    static TfLiteStatus placedInterleavedEval(TfLiteContext *context, TfLiteNode *node);
+    static TfLiteStatus placedSparseEval(TfLiteContext *context, TfLiteNode *node);
+
+    // Point the weights and bias of a node at the copies of the active placement
+    static void redirectInputs(TfLiteContext *context, TfLiteNode *node);
+
+    // Whether an operator is a dense layer with the weights and bias at the FULLY_CONNECTED input indices
+    static bool isDense(const tflite::Model *model, const tflite::Operator *op);
+
+    // Point a tensor at its copy or back at the model
+    void redirect(TfLiteEvalTensor *tensor);
+
+    // Data of a constant tensor, nullptr if it has none
+    static const uint8_t *constantData(const tflite::Model *model, int32_t tensor_index, size_t *size);
+};
@@ -0,0 +1,23 @@
+#include "XIPCache.h" // Include the header file for XIPCache class
+
+static volatile uint32_t *const xip_ctr_hit = reinterpret_cast<volatile uint32_t *>(XIP_CTRL_BASE + XIP_CTRL_CTR_HIT);
+static volatile uint32_t *const xip_ctr_acc = reinterpret_cast<volatile uint32_t *>(XIP_CTRL_BASE + XIP_CTRL_CTR_ACC);
+
+XIPCache::counters_t XIPCache::take(void)
+{
+    // Hits first, an access between the two reads must not turn into a negative miss count
+    const uint32_t hits = *xip_ctr_hit;
+    const uint32_t accesses = *xip_ctr_acc;
+    reset();
+
+    counters_t counters;
+    counters.accesses = accesses;
+    counters.misses = (accesses > hits) ? accesses - hits : 0;
+    return counters;
+}
+
+void XIPCache::reset(void)
+{
+    *xip_ctr_hit = 0;
+    *xip_ctr_acc = 0;
+}
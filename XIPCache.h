@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Arduino.h>
+
+#define XIP_CTRL_BASE 0x14000000 // XIP cache control registers of the RP2040
+#define XIP_CTRL_CTR_HIT 0x0C    // Cache hit counter, cleared by any write
+#define XIP_CTRL_CTR_ACC 0x10    // Cache access counter, cleared by any write
+
+/** Hit and access counters of the RP2040 XIP cache, the 16 KB two-way cache in front of the QSPI flash.
+ * Every cached read of flash counts, instruction fetches as well as model weights. A miss fetches an 8 byte line.
+ * The 32 bit counters saturate instead of wrapping, so `take()` reads and clears them together.
+ * */
+class XIPCache
+{
+public:
+    typedef struct counters
+    {
+        uint32_t accesses; // Cached reads of flash
+        uint32_t misses;   // Reads that went out to the flash
+    } counters_t;
+
+    // Counts since the previous call or `reset()`
+    static counters_t take(void);
+
+    // Clear both counters
+    static void reset(void);
+};
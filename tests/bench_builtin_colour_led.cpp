@@ -0,0 +1,72 @@
+// Time per `BuiltinColourLED::hsv2rgb()` call, fixed-point against the float formula it replaced, as the median of
+// alternating rounds. Absolute times on a shared host drift between runs, the ratio of a round is steadier.
+// The host has an FPU, on the RP2040 every float operation of the reference is a soft-float library call.
+
+#include "BuiltinColourLED.h"
+#include "colour_reference.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdlib.h>
+#include <vector>
+
+#define BENCH_ROUNDS 31 // Alternating rounds of both conversions, the medians count
+#define BENCH_REPEATS 4 // Passes over the input grid per round
+#define BENCH_STEP 5    // Saturation and value step of the input grid
+
+typedef void (*convert_t)(const BuiltinColourLED::hsv_t &hsv, BuiltinColourLED::rgb_t &rgb);
+
+static volatile uint32_t sink; // Keeps the results alive
+static BuiltinColourLED led;
+
+// Both conversions are called out of line, like the sketch calls `hsv2rgb()` from another translation unit
+__attribute__((noinline)) static void fixedHsv2rgb(const BuiltinColourLED::hsv_t &hsv, BuiltinColourLED::rgb_t &rgb)
+{
+    led.hsv2rgb(hsv, rgb);
+}
+
+__attribute__((noinline)) static void referenceHsv2rgb(const BuiltinColourLED::hsv_t &hsv, BuiltinColourLED::rgb_t &rgb)
+{
+    floatHsv2rgb(hsv, rgb);
+}
+
+static double nanosecondsPerCall(convert_t volatile convert)
+{
+    size_t calls = 0;
+    uint32_t total = 0;
+    const auto start = std::chrono::steady_clock::now();
+    for (int repeat = 0; repeat < BENCH_REPEATS; repeat++)
+        for (int h = 0; h <= 360; h++)
+            for (int s = 0; s <= 100; s += BENCH_STEP)
+                for (int v = 0; v <= 100; v += BENCH_STEP, calls++)
+                {
+                    BuiltinColourLED::rgb_t rgb(0, 0, 0);
+                    convert(BuiltinColourLED::hsv_t(h, s, v), rgb);
+                    total += rgb.r + rgb.g + rgb.b;
+                }
+    const auto end = std::chrono::steady_clock::now();
+    sink = total;
+    return std::chrono::duration<double, std::nano>(end - start).count() / calls;
+}
+
+static double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+int main(void)
+{
+    // Rounds alternate, so a slow phase of the host hits both conversions and the ratio of a round stays fair
+    std::vector<double> reference, fixed, ratio;
+    for (int round = 0; round < BENCH_ROUNDS; round++)
+    {
+        reference.push_back(nanosecondsPerCall(referenceHsv2rgb));
+        fixed.push_back(nanosecondsPerCall(fixedHsv2rgb));
+        ratio.push_back(reference.back() / fixed.back());
+    }
+    std::sort(ratio.begin(), ratio.end());
+    printf("hsv2rgb, median of %d rounds: fixed-point %.1f ns/call, float %.1f ns/call, float / fixed-point %.2fx (rounds %.2fx to %.2fx, middle half %.2fx to %.2fx)\n",
+           BENCH_ROUNDS, median(fixed), median(reference), median(ratio), ratio.front(), ratio.back(), ratio[BENCH_ROUNDS / 4], ratio[BENCH_ROUNDS * 3 / 4]);
+    return EXIT_SUCCESS;
+}
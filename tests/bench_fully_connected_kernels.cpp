@@ -0,0 +1,63 @@
+// Timings of the FC_SPARSE and FC_INTERLEAVED palette kernels on a 32x720 layer, the size of the first layers of the gesture model
+
+#include "fully_connected_layers.h"
+
+#include <utility>
+
+#define BENCH_UNITS 32
+#define BENCH_DEPTH 720
+#define BENCH_RUNS 500
+
+// The block-sparse kernel against the row-by-row dense loop on the same pruned weights
+static void benchSparse(void)
+{
+    printf("FC_SPARSE against the dense loop, %dx%d:\n", BENCH_UNITS, BENCH_DEPTH);
+    for (std::pair<int, int> blocks : {std::make_pair(8, 1), std::make_pair(4, 4)})
+        for (float sparsity : {0.0f, 0.5f, 0.75f, 0.9f})
+        {
+            SparseLayer layer(blocks.first, blocks.second, BENCH_UNITS, BENCH_DEPTH, 1, sparsity, true, true);
+            KernelHarness harness(SparseFullyConnected::registration());
+            if (layer.prepare(harness) != kTfLiteOk)
+            {
+                printf("  %dx%d sparsity %.2f: prepare failed\n", layer.block_rows, layer.block_cols, sparsity);
+                continue;
+            }
+            const KernelHarness::timing_t timing = KernelHarness::compare([&layer]()
+                                                                          { layer.dense(); },
+                                                                          [&harness]()
+                                                                          { harness.invoke(); }, BENCH_RUNS);
+            printf("  %dx%d blocks, sparsity %.2f: dense %6.1f us, sparse %6.1f us, %5.2fx\n", layer.block_rows, layer.block_cols, sparsity,
+                   timing.baseline, timing.candidate, timing.speedup);
+        }
+}
+
+// The palette formats against the float32 format of the same interleaved layer, blocks of 4 rows
+static void benchPalette(void)
+{
+    printf("FC_INTERLEAVED palettes against float32, %dx%d, blocks of 4, 2 batches:\n", BENCH_UNITS, BENCH_DEPTH);
+    for (int format : {INTERLEAVED_FC_PALETTE8, INTERLEAVED_FC_PALETTE4})
+    {
+        PaletteLayer layer(format, 4, BENCH_UNITS, BENCH_DEPTH, 2);
+        KernelHarness palette(InterleavedFullyConnected::registration());
+        KernelHarness float32(InterleavedFullyConnected::registration());
+        if (layer.prepare(palette) != kTfLiteOk || layer.prepareFloat(float32) != kTfLiteOk)
+        {
+            printf("  format %d: prepare failed\n", format);
+            continue;
+        }
+        const KernelHarness::timing_t timing = KernelHarness::compare([&float32]()
+                                                                      { float32.invoke(); },
+                                                                      [&palette]()
+                                                                      { palette.invoke(); }, BENCH_RUNS);
+        printf("  %s: %6.1f us (%.0f M weights/s), float32 %6.1f us, %5.2fx\n", (format == INTERLEAVED_FC_PALETTE4) ? "palette4" : "palette8",
+               timing.candidate, layer.batches * layer.padded * layer.depth / timing.candidate, timing.baseline, timing.speedup);
+    }
+}
+
+int main(void)
+{
+    srand(1);
+    benchSparse();
+    benchPalette();
+    return EXIT_SUCCESS;
+}
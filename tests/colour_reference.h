@@ -0,0 +1,57 @@
+#pragma once
+
+// Floating-point implementations `BuiltinColourLED` replaced, the references of its checks and benchmarks
+
+#include "BuiltinColourLED.h"
+
+// `BuiltinColourLED::hsv2rgb()` before the fixed-point conversion
+static inline void floatHsv2rgb(const BuiltinColourLED::hsv_t &hsv, BuiltinColourLED::rgb_t &rgb)
+{
+    // Convert HSV color model to RGB color model
+    float h = hsv.h / 360.0f;           // Normalize hue to [0, 1]
+    float s = hsv.s / 100.0f;           // Normalize saturation to [0, 1]
+    float v = hsv.v / 100.0f;           // Normalize value (brightness) to [0, 1]
+    int8_t i = static_cast<int>(h * 6); // Sector 0 to 5
+
+    // Fractional part of h
+    float f = h * 6 - i;
+    // Calculate intermediate values
+    float p = v * (1 - s);
+    float q = v * (1 - f * s);
+    float t = v * (1 - (1 - f) * s);
+
+    // Assign RGB values based on the sector of the hue
+    switch (i % 6)
+    {
+    case 0:
+        rgb.r = v * LED_PWM_RESOLUTION;
+        rgb.g = t * LED_PWM_RESOLUTION;
+        rgb.b = p * LED_PWM_RESOLUTION;
+        break;
+    case 1:
+        rgb.r = q * LED_PWM_RESOLUTION;
+        rgb.g = v * LED_PWM_RESOLUTION;
+        rgb.b = p * LED_PWM_RESOLUTION;
+        break;
+    case 2:
+        rgb.r = p * LED_PWM_RESOLUTION;
+        rgb.g = v * LED_PWM_RESOLUTION;
+        rgb.b = t * LED_PWM_RESOLUTION;
+        break;
+    case 3:
+        rgb.r = p * LED_PWM_RESOLUTION;
+        rgb.g = q * LED_PWM_RESOLUTION;
+        rgb.b = v * LED_PWM_RESOLUTION;
+        break;
+    case 4:
+        rgb.r = t * LED_PWM_RESOLUTION;
+        rgb.g = p * LED_PWM_RESOLUTION;
+        rgb.b = v * LED_PWM_RESOLUTION;
+        break;
+    case 5:
+        rgb.r = v * LED_PWM_RESOLUTION;
+        rgb.g = p * LED_PWM_RESOLUTION;
+        rgb.b = q * LED_PWM_RESOLUTION;
+        break;
+    }
+}
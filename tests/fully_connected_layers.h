@@ -0,0 +1,346 @@
+#pragma once
+
+// Random dense layers in the FC_SPARSE and FC_INTERLEAVED forms of `tools/sparsify.py` and `tools/weight_relayout.py`,
+// with the results of the row-by-row dense loop they have to reproduce
+
+#include "InterleavedFullyConnected.h"
+#include "SparseFullyConnected.h"
+#include "kernel_harness.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <tensorflow/lite/schema/schema_generated.h>
+
+static float uniform(float low, float high)
+{
+    return low + (high - low) * (rand() / float(RAND_MAX));
+}
+
+/** A pruned layer: the blocks of R rows by C columns are zeroed with probability `sparsity`.
+ * Tensors: 0 input, 1 values, 2 bias, 3 row pointers, 4 column indices, 5 output.
+ * */
+struct SparseLayer
+{
+    int block_rows, block_cols, units, depth, batches;
+    bool relu, with_bias;
+    std::vector<float> input, weights, bias, values, output, expected;
+    std::vector<int32_t> row_pointers;
+    std::vector<int16_t> column_indices;
+
+    SparseLayer(int block_rows, int block_cols, int units, int depth, int batches, float sparsity, bool relu, bool with_bias)
+        : block_rows(block_rows), block_cols(block_cols), units(units), depth(depth), batches(batches), relu(relu), with_bias(with_bias),
+          input(batches * depth), weights(units * depth), bias(units), output(batches * units), expected(batches * units)
+    {
+        for (float &value : input)
+            value = uniform(-2.0f, 2.0f);
+        for (float &value : weights)
+            value = uniform(-1.0f, 1.0f);
+        for (float &value : bias)
+            value = uniform(-0.5f, 0.5f);
+
+        // Keep or prune every block, then store the kept ones column by column
+        const int block_row_count = (units + block_rows - 1) / block_rows;
+        const int block_column_count = (depth + block_cols - 1) / block_cols;
+        std::vector<bool> kept(block_row_count * block_column_count);
+        for (size_t block = 0; block < kept.size(); block++)
+            kept[block] = uniform(0.0f, 1.0f) >= sparsity;
+        for (int unit = 0; unit < units; unit++)
+            for (int column = 0; column < depth; column++)
+                if (!kept[(unit / block_rows) * block_column_count + column / block_cols])
+                    weights[unit * depth + column] = 0.0f;
+
+        row_pointers.push_back(0);
+        for (int block_row = 0; block_row < block_row_count; block_row++)
+        {
+            for (int block_column = 0; block_column < block_column_count; block_column++)
+            {
+                if (!kept[block_row * block_column_count + block_column])
+                    continue;
+                column_indices.push_back(int16_t(block_column));
+                for (int c = 0; c < block_cols; c++)
+                    for (int r = 0; r < block_rows; r++)
+                    {
+                        const int unit = block_row * block_rows + r;
+                        const int column = block_column * block_cols + c;
+                        values.push_back((unit < units && column < depth) ? weights[unit * depth + column] : 0.0f);
+                    }
+            }
+            row_pointers.push_back(int32_t(column_indices.size()));
+        }
+        dense();
+    }
+
+    // FULLY_CONNECTED on the pruned weights, one row after the other
+    void dense(void)
+    {
+        for (int batch = 0; batch < batches; batch++)
+            for (int unit = 0; unit < units; unit++)
+            {
+                float sum = 0.0f;
+                for (int column = 0; column < depth; column++)
+                    sum += input[batch * depth + column] * weights[unit * depth + column];
+                if (with_bias)
+                    sum += bias[unit];
+                expected[batch * units + unit] = relu ? std::max(sum, 0.0f) : sum;
+            }
+    }
+
+    TfLiteStatus prepare(KernelHarness &harness)
+    {
+        harness.setTensor(0, input.data(), kTfLiteFloat32, {batches, depth});
+        harness.setTensor(1, values.data(), kTfLiteFloat32, {int(column_indices.size()), block_cols, block_rows});
+        harness.setTensor(2, bias.data(), kTfLiteFloat32, {units});
+        harness.setTensor(3, row_pointers.data(), kTfLiteInt32, {int(row_pointers.size())});
+        harness.setTensor(4, column_indices.data(), kTfLiteInt16, {int(column_indices.size())});
+        harness.setTensor(5, output.data(), kTfLiteFloat32, {batches, units});
+        const char activation = relu ? tflite::ActivationFunctionType_RELU : tflite::ActivationFunctionType_NONE;
+        return harness.prepare({0, 1, with_bias ? 2 : -1, 3, 4}, {5}, {char(block_rows), char(block_cols), activation});
+    }
+};
+
+/** A layer of palette indices, interleaved in blocks of B rows, and the same layer expanded to float32.
+ * Tensors: 0 input, 1 indices, 2 bias, 3 output, 4 palette, 5 float32 weights.
+ * */
+struct PaletteLayer
+{
+    int format, block, units, depth, batches, padded;
+    std::vector<float> input, palette, bias, output, expected, weights;
+    std::vector<uint8_t> indices;
+
+    PaletteLayer(int format, int block, int units, int depth, int batches)
+        : format(format), block(block), units(units), depth(depth), batches(batches), padded((units + block - 1) / block * block),
+          input(batches * depth), palette(entries()), bias(units), output(batches * units), expected(batches * units),
+          weights(padded * depth, 0.0f), indices(padded * depth / packed(), 0)
+    {
+        for (float &value : input)
+            value = uniform(-2.0f, 2.0f);
+        for (float &value : palette)
+            value = uniform(-1.0f, 1.0f);
+        for (float &value : bias)
+            value = uniform(-0.5f, 0.5f);
+
+        std::vector<int> index(units * depth);
+        for (int &value : index)
+            value = rand() % entries();
+        for (int unit = 0; unit < units; unit++)
+            for (int column = 0; column < depth; column++)
+            {
+                // Position in the [padded out / B][in][B] stream, 4 bit indices hold the even row in the low nibble
+                const int position = (unit / block) * block * depth + column * block + unit % block;
+                const int value = index[unit * depth + column];
+                weights[position] = palette[value];
+                if (packed() == 2)
+                    indices[position / 2] |= uint8_t(value << ((position & 1) * 4));
+                else
+                    indices[position] = uint8_t(value);
+            }
+
+        // FULLY_CONNECTED with a fused RELU, one row after the other
+        for (int batch = 0; batch < batches; batch++)
+            for (int unit = 0; unit < units; unit++)
+            {
+                float sum = 0.0f;
+                for (int column = 0; column < depth; column++)
+                    sum += input[batch * depth + column] * palette[index[unit * depth + column]];
+                expected[batch * units + unit] = std::max(sum + bias[unit], 0.0f);
+            }
+    }
+
+    int entries(void) const
+    {
+        return (format == INTERLEAVED_FC_PALETTE4) ? 16 : 256;
+    }
+
+    int packed(void) const
+    {
+        return (format == INTERLEAVED_FC_PALETTE4) ? 2 : 1;
+    }
+
+    TfLiteStatus prepare(KernelHarness &harness)
+    {
+        setTensors(harness);
+        harness.setTensor(1, indices.data(), kTfLiteUInt8, {padded / packed(), depth});
+        return harness.prepare({0, 1, 2, 4}, {3}, {char(block), tflite::ActivationFunctionType_RELU, char(format)});
+    }
+
+    // The same layer in the float32 format, the baseline of the palette formats
+    TfLiteStatus prepareFloat(KernelHarness &harness)
+    {
+        setTensors(harness);
+        harness.setTensor(5, weights.data(), kTfLiteFloat32, {padded, depth});
+        return harness.prepare({0, 5, 2}, {3}, {char(block), tflite::ActivationFunctionType_RELU, INTERLEAVED_FC_FLOAT32});
+    }
+
+private:
+    void setTensors(KernelHarness &harness)
+    {
+        harness.setTensor(0, input.data(), kTfLiteFloat32, {batches, depth});
+        harness.setTensor(2, bias.data(), kTfLiteFloat32, {units});
+        harness.setTensor(3, output.data(), kTfLiteFloat32, {batches, units});
+        harness.setTensor(4, palette.data(), kTfLiteFloat32, {entries()});
+    }
+};
+
+/** A layer of float16 or bfloat16 weights, interleaved in blocks of B rows. Random weights span the subnormals,
+ * a few rows hold infinities and NaN. Tensors: 0 input, 1 weights, 2 bias, 3 output.
+ * */
+struct HalfLayer
+{
+    int format, block, units, depth, batches, padded;
+    std::vector<float> input, bias, output, expected;
+    std::vector<uint16_t> weights;
+
+    HalfLayer(int format, int block, int units, int depth, int batches)
+        : format(format), block(block), units(units), depth(depth), batches(batches), padded((units + block - 1) / block * block),
+          input(batches * depth), bias(units), output(batches * units), expected(batches * units), weights(padded * depth, 0)
+    {
+        for (float &value : input)
+            value = uniform(-2.0f, 2.0f);
+        for (float &value : bias)
+            value = uniform(-0.5f, 0.5f);
+
+        // Exponents from the subnormals up to 2, any mantissa and sign
+        const bool float16 = (format == INTERLEAVED_FC_FLOAT16);
+        std::vector<uint16_t> bits(units * depth);
+        for (uint16_t &value : bits)
+        {
+            const int sign = rand() % 2;
+            if (float16)
+                value = uint16_t((sign << 15) | ((rand() % 16) << 10) | (rand() % 0x400));
+            else
+                value = uint16_t((sign << 15) | (((rand() % 5) ? 100 + rand() % 28 : 0) << 7) | (rand() % 0x80));
+        }
+        bits[0] = float16 ? 0x7C00 : 0x7F80;                 // Infinity
+        bits[depth + 1] = float16 ? 0x7E01 : 0x7FC1;         // NaN with a payload
+        bits[2 * depth] = 0x0001;                            // Smallest subnormal
+        bits[2 * depth + 1] = float16 ? 0x83FF : 0x807F;     // Negative subnormal of the largest magnitude
+        bits[units * depth - 1] = float16 ? 0xFC00 : 0xFF80; // Negative infinity
+        for (int unit = 0; unit < units; unit++)
+            for (int column = 0; column < depth; column++)
+                weights[(unit / block) * block * depth + column * block + unit % block] = bits[unit * depth + column];
+
+        // FULLY_CONNECTED with a fused RELU on the expanded weights, one row after the other
+        for (int batch = 0; batch < batches; batch++)
+            for (int unit = 0; unit < units; unit++)
+            {
+                float sum = 0.0f;
+                for (int column = 0; column < depth; column++)
+                    sum += input[batch * depth + column] * expand(bits[unit * depth + column]);
+                expected[batch * units + unit] = std::max(sum + bias[unit], 0.0f);
+            }
+    }
+
+    // Value of the stored bits, float16 decoded from its fields instead of the bit moves of the kernel
+    float expand(uint16_t value) const
+    {
+        if (format == INTERLEAVED_FC_BFLOAT16)
+        {
+            const uint32_t bits = uint32_t(value) << 16;
+            float expanded;
+            memcpy(&expanded, &bits, sizeof(expanded));
+            return expanded;
+        }
+        const float sign = (value & 0x8000) ? -1.0f : 1.0f;
+        const int exponent = (value >> 10) & 0x1F;
+        const int mantissa = value & 0x3FF;
+        if (exponent == 0x1F)
+            return mantissa ? NAN : sign * INFINITY;
+        if (exponent == 0)
+            return sign * ldexpf(float(mantissa), -24);
+        return sign * ldexpf(float(0x400 | mantissa), exponent - 25);
+    }
+
+    TfLiteStatus prepare(KernelHarness &harness)
+    {
+        harness.setTensor(0, input.data(), kTfLiteFloat32, {batches, depth});
+        harness.setTensor(1, weights.data(), (format == INTERLEAVED_FC_FLOAT16) ? kTfLiteFloat16 : kTfLiteInt16, {padded, depth});
+        harness.setTensor(2, bias.data(), kTfLiteFloat32, {units});
+        harness.setTensor(3, output.data(), kTfLiteFloat32, {batches, units});
+        return harness.prepare({0, 1, 2}, {3}, {char(block), tflite::ActivationFunctionType_RELU, char(format)});
+    }
+};
+
+/** A layer of symmetric int8 weights with `num_scales` scales, interleaved in blocks of B rows, for both int8 formats.
+ * The first batch has its largest input at 127, so halves of the int8 input steps stay exact and show the rounding.
+ * Tensors: 0 input, 1 weights, 2 bias, 3 output.
+ * */
+struct Int8Layer
+{
+    int format, block, units, depth, batches, padded;
+    std::vector<float> input, scales, bias, output, expected;
+    std::vector<int8_t> weights;
+    std::vector<int8_t> quantized; // Input of the last batch quantized by the dense loop, INTERLEAVED_FC_INT8_INPUT only
+
+    Int8Layer(int format, int block, int units, int depth, int batches, int num_scales)
+        : format(format), block(block), units(units), depth(depth), batches(batches), padded((units + block - 1) / block * block),
+          input(batches * depth), scales(num_scales), bias(units), output(batches * units), expected(batches * units),
+          weights(padded * depth, 0), quantized(depth)
+    {
+        for (float &value : input)
+            value = uniform(-2.0f, 2.0f);
+        for (int column = 0; column < depth; column++)
+            input[column] = (column % 3) ? float(rand() % 254 - 127) + 0.5f : uniform(-127.0f, 127.0f);
+        input[depth / 2] = (depth % 2) ? 127.0f : -127.0f;
+        for (float &value : scales)
+            value = uniform(0.001f, 0.02f);
+        for (float &value : bias)
+            value = uniform(-0.5f, 0.5f);
+
+        std::vector<int8_t> values(units * depth);
+        for (int8_t &value : values)
+            value = int8_t(rand() % 255 - 127);
+        for (int unit = 0; unit < units; unit++)
+            for (int column = 0; column < depth; column++)
+                weights[(unit / block) * block * depth + column * block + unit % block] = values[unit * depth + column];
+        if (num_scales != 1 && num_scales < units)
+            return; // `prepare()` has to fail, there is nothing to compare
+
+        // FULLY_CONNECTED with a fused RELU, one row after the other, scaled as the kernel documents
+        for (int batch = 0; batch < batches; batch++)
+        {
+            const float *row_input = &input[batch * depth];
+            float input_scale = 1.0f;
+            if (format == INTERLEAVED_FC_INT8_INPUT)
+            {
+                float largest = 0.0f;
+                for (int column = 0; column < depth; column++)
+                    largest = std::max(largest, fabsf(row_input[column]));
+                input_scale = largest / 127.0f;
+                for (int column = 0; column < depth; column++)
+                    quantized[column] = int8_t((largest > 0.0f) ? lroundf(row_input[column] * (127.0f / largest)) : 0);
+            }
+            for (int unit = 0; unit < units; unit++)
+            {
+                const float scale = scales[(num_scales == 1) ? 0 : unit];
+                float sum;
+                if (format == INTERLEAVED_FC_INT8_INPUT)
+                {
+                    int32_t total = 0;
+                    for (int column = 0; column < depth; column++)
+                        total += int32_t(quantized[column]) * values[unit * depth + column];
+                    sum = float(total) * (input_scale * scale);
+                }
+                else
+                {
+                    sum = 0.0f;
+                    for (int column = 0; column < depth; column++)
+                        sum += row_input[column] * float(values[unit * depth + column]);
+                    sum *= scale;
+                }
+                expected[batch * units + unit] = std::max(sum + bias[unit], 0.0f);
+            }
+        }
+    }
+
+    TfLiteStatus prepare(KernelHarness &harness)
+    {
+        harness.setTensor(0, input.data(), kTfLiteFloat32, {batches, depth});
+        harness.setTensor(1, weights.data(), kTfLiteInt8, {padded, depth});
+        harness.setTensor(2, bias.data(), kTfLiteFloat32, {units});
+        harness.setTensor(3, output.data(), kTfLiteFloat32, {batches, units});
+        harness.setQuantization(1, scales);
+        return harness.prepare({0, 1, 2}, {3}, {char(block), tflite::ActivationFunctionType_RELU, char(format)});
+    }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+// Stand-in for the Arduino core on the host, only what the modules under test use
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+
+#define PROGMEM
+#define __packed __attribute__((packed))
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+
+#define constrain(amount, low, high) ((amount) < (low) ? (low) : ((amount) > (high) ? (high) : (amount)))
+
+// Time since the start of the program
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+
+// No pins on the host, writes are ignored
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+void analogWrite(int pin, int value);
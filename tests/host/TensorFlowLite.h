@@ -0,0 +1,3 @@
+#pragma once
+
+// Stand-in for the TensorFlow Lite Micro library on the host, see the headers under tensorflow/
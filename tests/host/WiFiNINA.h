@@ -0,0 +1,7 @@
+#pragma once
+
+// Stand-in for the RGB LED pins the WiFiNINA co-processor drives on the Nano RP2040 Connect
+
+#define LEDR 25
+#define LEDG 26
+#define LEDB 27
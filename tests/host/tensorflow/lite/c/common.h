@@ -0,0 +1,97 @@
+#pragma once
+
+// Stand-in for the TFLite C API on the host, only the types the custom kernels of the sketch use
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef enum
+{
+    kTfLiteOk = 0,
+    kTfLiteError = 1,
+} TfLiteStatus;
+
+typedef enum
+{
+    kTfLiteNoType = 0,
+    kTfLiteFloat32 = 1,
+    kTfLiteInt32 = 2,
+    kTfLiteUInt8 = 3,
+    kTfLiteInt16 = 7,
+    kTfLiteInt8 = 9,
+    kTfLiteFloat16 = 10,
+} TfLiteType;
+
+typedef struct TfLiteIntArray
+{
+    int size;
+    int data[];
+} TfLiteIntArray;
+
+typedef struct TfLiteFloatArray
+{
+    int size;
+    float data[];
+} TfLiteFloatArray;
+
+typedef union TfLitePtrUnion
+{
+    int32_t *i32;
+    int16_t *i16;
+    float *f;
+    uint8_t *uint8;
+    int8_t *int8;
+    void *data;
+} TfLitePtrUnion;
+
+typedef enum
+{
+    kTfLiteNoQuantization = 0,
+    kTfLiteAffineQuantization = 1,
+} TfLiteQuantizationType;
+
+typedef struct TfLiteQuantization
+{
+    TfLiteQuantizationType type;
+    void *params;
+} TfLiteQuantization;
+
+typedef struct TfLiteAffineQuantization
+{
+    TfLiteFloatArray *scale;
+    TfLiteIntArray *zero_point;
+    int32_t quantized_dimension;
+} TfLiteAffineQuantization;
+
+typedef struct TfLiteTensor
+{
+    TfLiteType type;
+    TfLitePtrUnion data;
+    TfLiteIntArray *dims;
+    TfLiteQuantization quantization;
+} TfLiteTensor;
+
+typedef struct TfLiteEvalTensor
+{
+    TfLitePtrUnion data;
+    TfLiteIntArray *dims;
+    TfLiteType type;
+} TfLiteEvalTensor;
+
+typedef struct TfLiteNode
+{
+    TfLiteIntArray *inputs;
+    TfLiteIntArray *outputs;
+    void *user_data;
+    const void *custom_initial_data;
+    int custom_initial_data_size;
+} TfLiteNode;
+
+typedef struct TfLiteContext
+{
+    TfLiteEvalTensor *(*GetEvalTensor)(const struct TfLiteContext *context, int tensor_index);
+    void *(*AllocatePersistentBuffer)(struct TfLiteContext *context, size_t bytes);
+    TfLiteStatus (*RequestScratchBufferInArena)(struct TfLiteContext *context, size_t bytes, int *buffer_index);
+    void *(*GetScratchBuffer)(struct TfLiteContext *context, int buffer_index);
+    void *impl_; // tflite::MicroContext of the kernel
+} TfLiteContext;
@@ -0,0 +1,42 @@
+#pragma once
+
+// Stand-in for the TFLM kernel helpers on the host
+
+#include "tensorflow/lite/c/common.h"
+
+namespace tflite
+{
+    namespace micro
+    {
+        inline const TfLiteEvalTensor *GetEvalInput(const TfLiteContext *context, const TfLiteNode *node, int index)
+        {
+            const int tensor = node->inputs->data[index];
+            return (tensor < 0) ? nullptr : context->GetEvalTensor(context, tensor);
+        }
+
+        inline TfLiteEvalTensor *GetEvalOutput(const TfLiteContext *context, const TfLiteNode *node, int index)
+        {
+            return context->GetEvalTensor(context, node->outputs->data[index]);
+        }
+
+        template <typename T>
+        const T *GetTensorData(const TfLiteEvalTensor *tensor)
+        {
+            return static_cast<const T *>(tensor->data.data);
+        }
+
+        template <typename T>
+        T *GetTensorData(TfLiteEvalTensor *tensor)
+        {
+            return static_cast<T *>(tensor->data.data);
+        }
+
+        inline int ElementCount(const TfLiteIntArray &dims)
+        {
+            int count = 1;
+            for (int i = 0; i < dims.size; i++)
+                count *= dims.data[i];
+            return count;
+        }
+    }
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+// Stand-in for the TFLM micro context on the host. Temporary tensors come from whoever set `impl_` of the context,
+// without one they fail like an allocation that ran out of arena.
+
+#include "tensorflow/lite/c/common.h"
+
+namespace tflite
+{
+    class MicroContext
+    {
+    public:
+        virtual ~MicroContext() = default;
+
+        virtual TfLiteTensor *AllocateTempInputTensor(const TfLiteNode *, int)
+        {
+            return nullptr;
+        }
+
+        virtual void DeallocateTempTfLiteTensor(TfLiteTensor *)
+        {
+        }
+    };
+
+    inline MicroContext *GetMicroContext(const TfLiteContext *context)
+    {
+        static MicroContext none;
+        return context->impl_ ? static_cast<MicroContext *>(context->impl_) : &none;
+    }
+}
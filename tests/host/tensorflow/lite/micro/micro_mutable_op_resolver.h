@@ -0,0 +1,18 @@
+#pragma once
+
+// Stand-in for the TFLM op resolver on the host, only the registration type the custom kernels return
+
+#include "tensorflow/lite/c/common.h"
+
+namespace tflite
+{
+    struct TFLMRegistration
+    {
+        void *(*init)(TfLiteContext *context, const char *buffer, size_t length);
+        void (*free)(TfLiteContext *context, void *buffer);
+        TfLiteStatus (*prepare)(TfLiteContext *context, TfLiteNode *node);
+        TfLiteStatus (*invoke)(TfLiteContext *context, TfLiteNode *node);
+    };
+
+    TFLMRegistration Register_FULLY_CONNECTED(void);
+}
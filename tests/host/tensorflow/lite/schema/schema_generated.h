@@ -0,0 +1,29 @@
+#pragma once
+
+// Stand-in for the TFLite schema on the host, only the file identifier check of `ModelStore` and the fused activations of the kernels
+
+#include <string.h>
+
+namespace tflite
+{
+    enum ActivationFunctionType
+    {
+        ActivationFunctionType_NONE = 0,
+        ActivationFunctionType_RELU = 1,
+        ActivationFunctionType_RELU_N1_TO_1 = 2,
+        ActivationFunctionType_RELU6 = 3,
+        ActivationFunctionType_TANH = 4,
+        ActivationFunctionType_SIGN_BIT = 5,
+    };
+
+    inline const char *ModelIdentifier(void)
+    {
+        return "TFL3";
+    }
+
+    // The flatbuffer file identifier follows the 4 byte root table offset
+    inline bool ModelBufferHasIdentifier(const void *buffer)
+    {
+        return memcmp(static_cast<const char *>(buffer) + 4, ModelIdentifier(), 4) == 0;
+    }
+}
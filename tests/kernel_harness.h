@@ -0,0 +1,217 @@
+#pragma once
+
+// A single custom operator of the sketch on the host, with its tensors in plain vectors instead of an interpreter
+
+#include <TensorFlowLite.h>
+#include <tensorflow/lite/micro/micro_context.h>
+#include <tensorflow/lite/micro/micro_mutable_op_resolver.h>
+
+#include <algorithm>
+#include <chrono>
+#include <string.h>
+#include <initializer_list>
+#include <vector>
+
+#define KERNEL_HARNESS_TENSORS 8            // Tensors a node can refer to
+#define KERNEL_HARNESS_PERSISTENT_SIZE 4096 // Bytes for `AllocatePersistentBuffer()`
+#define KERNEL_HARNESS_ALIGNMENT 16
+#define KERNEL_HARNESS_ROUNDS 15            // Alternating timing rounds, the medians count
+
+class KernelHarness
+{
+public:
+    typedef decltype(tflite::Register_FULLY_CONNECTED()) registration_t;
+
+    typedef struct timing
+    {
+        double baseline;  // Median time in microseconds
+        double candidate; // Median time in microseconds
+        double speedup;   // Median of baseline / candidate over the rounds
+    } timing_t;
+
+    KernelHarness(const registration_t &registration) : registration(registration), micro_context(*this)
+    {
+        context.GetEvalTensor = getEvalTensor;
+        context.AllocatePersistentBuffer = allocatePersistentBuffer;
+        context.RequestScratchBufferInArena = requestScratchBuffer;
+        context.GetScratchBuffer = getScratchBuffer;
+        context.impl_ = &micro_context;
+        active() = this;
+    }
+
+    KernelHarness(const KernelHarness &) = delete; // The micro context refers back to the harness
+    KernelHarness &operator=(const KernelHarness &) = delete;
+
+    // Point tensor `index` at `data`, the caller keeps it alive
+    void setTensor(int index, void *data, TfLiteType type, std::initializer_list<int> shape)
+    {
+        std::vector<int> &dims = tensor_dims[index];
+        dims.assign(1, int(shape.size()));
+        dims.insert(dims.end(), shape);
+        tensors[index].data.data = data;
+        tensors[index].type = type;
+        tensors[index].dims = reinterpret_cast<TfLiteIntArray *>(dims.data());
+    }
+
+    // Affine quantization of tensor `index` with zero points 0, as the converter writes symmetric int8 tensors.
+    // No scales removes it.
+    void setQuantization(int index, const std::vector<float> &scales)
+    {
+        std::vector<int> &scale = tensor_scales[index];
+        if (scales.empty())
+        {
+            scale.clear();
+            tensor_zero_points[index].clear();
+            return;
+        }
+        scale.assign(1 + scales.size(), 0);
+        scale[0] = int(scales.size());
+        memcpy(&scale[1], scales.data(), scales.size() * sizeof(float));
+        tensor_zero_points[index].assign(1 + scales.size(), 0);
+        tensor_zero_points[index][0] = int(scales.size());
+    }
+
+    // Run `init()` with the custom options and `prepare()`. Inputs of index -1 are absent.
+    TfLiteStatus prepare(std::initializer_list<int> inputs, std::initializer_list<int> outputs, const std::vector<char> &options)
+    {
+        setArray(input_array, inputs);
+        setArray(output_array, outputs);
+        node.inputs = reinterpret_cast<TfLiteIntArray *>(input_array.data());
+        node.outputs = reinterpret_cast<TfLiteIntArray *>(output_array.data());
+        persistent_used = 0;
+        scratch.clear();
+        active() = this;
+        node.user_data = registration.init(&context, options.data(), options.size());
+        return node.user_data ? registration.prepare(&context, &node) : kTfLiteError;
+    }
+
+    TfLiteStatus invoke(void)
+    {
+        active() = this;
+        return registration.invoke(&context, &node);
+    }
+
+    // Scratch buffers the kernel requested in `prepare()`, with what it left in them
+    const std::vector<std::vector<uint8_t>> &scratchBuffers(void) const
+    {
+        return scratch;
+    }
+
+    // Time of `baseline` against `candidate`, averaged over `runs` calls per round. The rounds alternate, so a slow
+    // phase of the host hits both and the ratio of a round stays fair, the medians drop the disturbed rounds.
+    template <typename Baseline, typename Candidate>
+    static timing_t compare(Baseline baseline, Candidate candidate, int runs)
+    {
+        std::vector<double> baselines, candidates, speedups;
+        for (int round = 0; round < KERNEL_HARNESS_ROUNDS; round++)
+        {
+            baselines.push_back(time(baseline, runs));
+            candidates.push_back(time(candidate, runs));
+            speedups.push_back(baselines.back() / candidates.back());
+        }
+        return {median(baselines), median(candidates), median(speedups)};
+    }
+
+private:
+    // Temporary tensors with the quantization parameters of the harness tensors
+    class TemporaryTensors : public tflite::MicroContext
+    {
+    public:
+        TemporaryTensors(KernelHarness &harness) : harness(harness) {}
+
+        TfLiteTensor *AllocateTempInputTensor(const TfLiteNode *node, int index) override
+        {
+            if (index < 0 || index >= node->inputs->size || node->inputs->data[index] < 0)
+                return nullptr;
+            const int tensor = node->inputs->data[index];
+            const TfLiteEvalTensor &eval = harness.tensors[tensor];
+            temporary = {eval.type, eval.data, eval.dims, {kTfLiteNoQuantization, nullptr}};
+            if (!harness.tensor_scales[tensor].empty())
+            {
+                affine.scale = reinterpret_cast<TfLiteFloatArray *>(harness.tensor_scales[tensor].data());
+                affine.zero_point = reinterpret_cast<TfLiteIntArray *>(harness.tensor_zero_points[tensor].data());
+                affine.quantized_dimension = 0;
+                temporary.quantization = {kTfLiteAffineQuantization, &affine};
+            }
+            return &temporary;
+        }
+
+    private:
+        KernelHarness &harness;
+        TfLiteTensor temporary = {};
+        TfLiteAffineQuantization affine = {};
+    };
+
+    registration_t registration;
+    TemporaryTensors micro_context;
+    TfLiteContext context = {};
+    TfLiteNode node = {};
+    TfLiteEvalTensor tensors[KERNEL_HARNESS_TENSORS] = {};
+    std::vector<int> tensor_dims[KERNEL_HARNESS_TENSORS];
+    std::vector<int> tensor_scales[KERNEL_HARNESS_TENSORS]; // TfLiteFloatArray, the scales stored as their bits
+    std::vector<int> tensor_zero_points[KERNEL_HARNESS_TENSORS];
+    std::vector<int> input_array;
+    std::vector<int> output_array;
+    alignas(KERNEL_HARNESS_ALIGNMENT) uint8_t persistent[KERNEL_HARNESS_PERSISTENT_SIZE];
+    size_t persistent_used = 0;
+    std::vector<std::vector<uint8_t>> scratch;
+
+    // Harness of the running kernel, its callbacks only get the context
+    static KernelHarness *&active(void)
+    {
+        static KernelHarness *harness = nullptr;
+        return harness;
+    }
+
+    // Time of `function` in microseconds, averaged over `runs` calls
+    template <typename Function>
+    static double time(Function function, int runs)
+    {
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < runs; i++)
+        {
+            function();
+            asm volatile("" ::: "memory"); // Every run writes its output
+        }
+        return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / runs;
+    }
+
+    static double median(std::vector<double> values)
+    {
+        std::sort(values.begin(), values.end());
+        return values[values.size() / 2];
+    }
+
+    static void setArray(std::vector<int> &array, std::initializer_list<int> values)
+    {
+        array.assign(1, int(values.size()));
+        array.insert(array.end(), values);
+    }
+
+    static TfLiteEvalTensor *getEvalTensor(const TfLiteContext *, int index)
+    {
+        return &active()->tensors[index];
+    }
+
+    static void *allocatePersistentBuffer(TfLiteContext *, size_t bytes)
+    {
+        const size_t size = (bytes + KERNEL_HARNESS_ALIGNMENT - 1) / KERNEL_HARNESS_ALIGNMENT * KERNEL_HARNESS_ALIGNMENT;
+        if (active()->persistent_used + size > sizeof(active()->persistent))
+            return nullptr;
+        void *buffer = active()->persistent + active()->persistent_used;
+        active()->persistent_used += size;
+        return buffer;
+    }
+
+    static TfLiteStatus requestScratchBuffer(TfLiteContext *, size_t bytes, int *index)
+    {
+        active()->scratch.emplace_back(bytes);
+        *index = int(active()->scratch.size()) - 1;
+        return kTfLiteOk;
+    }
+
+    static void *getScratchBuffer(TfLiteContext *, int index)
+    {
+        return active()->scratch[index].data();
+    }
+};
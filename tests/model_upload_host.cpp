@@ -0,0 +1,135 @@
+// The upload path of the sketch on the host: `ModelUpload`, `ModelStore` and `BinaryTelemetry` on a file-backed flash region.
+// Speaks the serial protocol on stdin and stdout, `tools/model_upload.py --flash` runs it in place of the board.
+//   model_upload_host flash.bin
+// Like the command handler of the sketch, 'u' starts an upload. The flash file is written after every session.
+
+#include <Arduino.h>
+
+#include <poll.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "ModelUpload.h"
+
+#define HOST_FLASH_SECTOR_SIZE 4096 // Erase and program units of the RP2040 QSPI flash
+#define HOST_FLASH_PAGE_SIZE 256
+#define HOST_POLL_INTERVAL 10 // Time in ms between calls of `ModelUpload::update()` while the host is quiet
+
+/** A flash region in memory, loaded from and saved to a file.
+ * NOR semantics like `InternalFlash`: erase sets whole sectors to 0xFF, programming only clears bits.
+ * */
+class FileFlash : public FlashRegion
+{
+public:
+    FileFlash(const char *path) : path(path), contents(MODEL_STORE_SIZE, 0xFF)
+    {
+        FILE *file = fopen(path, "rb");
+        if (file == nullptr)
+            return;
+        [[maybe_unused]] const size_t read = fread(contents.data(), 1, contents.size(), file);
+        fclose(file);
+    }
+
+    size_t size(void) const override { return contents.size(); }
+    size_t sectorSize(void) const override { return HOST_FLASH_SECTOR_SIZE; }
+    size_t pageSize(void) const override { return HOST_FLASH_PAGE_SIZE; }
+    uint8_t eraseValue(void) const override { return 0xFF; }
+    const uint8_t *data(void) const override { return contents.data(); }
+
+    int erase(size_t offset, size_t length) override
+    {
+        if (offset % HOST_FLASH_SECTOR_SIZE || length % HOST_FLASH_SECTOR_SIZE || offset + length > contents.size())
+            return -1;
+        memset(&contents[offset], 0xFF, length);
+        return 0;
+    }
+
+    int program(size_t offset, const void *data, size_t length) override
+    {
+        if (offset % HOST_FLASH_PAGE_SIZE || length % HOST_FLASH_PAGE_SIZE || offset + length > contents.size())
+            return -1;
+        const uint8_t *bytes = static_cast<const uint8_t *>(data);
+        for (size_t i = 0; i < length; i++)
+            contents[offset + i] &= bytes[i];
+        return 0;
+    }
+
+    bool save(void) const
+    {
+        FILE *file = fopen(path, "wb");
+        if (file == nullptr)
+            return false;
+        const bool written = fwrite(contents.data(), 1, contents.size(), file) == contents.size();
+        return (fclose(file) == 0) && written;
+    }
+
+private:
+    const char *path;
+    std::vector<uint8_t> contents;
+};
+
+// Next byte of stdin, -1 if none arrived within `timeout` ms, -2 once stdin is closed
+static int readByte(int timeout)
+{
+    pollfd input = {STDIN_FILENO, POLLIN, 0};
+    if (poll(&input, 1, timeout) <= 0)
+        return -1;
+    uint8_t byte;
+    return (read(STDIN_FILENO, &byte, 1) == 1) ? byte : -2;
+}
+
+static size_t writeOutput(const uint8_t *buffer, size_t length)
+{
+    const size_t written = fwrite(buffer, 1, length, stdout);
+    fflush(stdout);
+    return written;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+        fprintf(stderr, "Usage: %s FLASH_FILE\n", argv[0]);
+        return 2;
+    }
+
+    FileFlash flash(argv[1]);
+    ModelStore store(flash);
+    ModelUpload uploader(store);
+    BinaryTelemetry telemetry;
+    telemetry.registerWriteCallback(writeOutput);
+    uploader.registerReplyCallback([&telemetry](ModelUpload::request_type_t request, uint16_t sequence, ModelUpload::upload_status_t status, uint32_t value)
+                                   { telemetry.sendUploadReply(request, sequence, status, value); });
+
+    int byte;
+    while ((byte = readByte(-1)) != -2)
+    {
+        if (byte != 'u') // Everything else goes to the command handler of the sketch
+            continue;
+
+        // Same output as `runUpload()` of the sketch: a log line, then the delimiter
+        printf("[Upl] Waiting for a model of up to %u bytes\n", unsigned(store.getCapacity()));
+        const uint8_t delimiter = 0x00;
+        writeOutput(&delimiter, sizeof(delimiter));
+
+        uploader.start(millis());
+        while (uploader.isActive() && byte != -2)
+        {
+            byte = readByte(HOST_POLL_INTERVAL);
+            if (byte >= 0)
+                uploader.receive(uint8_t(byte), millis());
+            uploader.update(millis());
+        }
+
+        const ModelUpload::statistics_t stats = uploader.getStatistics();
+        fprintf(stderr, "[Upl] Status %d after %lu bytes: %lu chunks, %lu repeated, %lu errors\n", int(stats.result), (unsigned long)stats.bytes,
+                (unsigned long)stats.chunks, (unsigned long)stats.repeated, (unsigned long)stats.errors);
+        if (!flash.save())
+        {
+            fprintf(stderr, "Failed to write %s\n", argv[1]);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,82 @@
+// Exhaustive checks of `BuiltinColourLED` against the floating-point formulas it replaces
+
+#include "BuiltinColourLED.h"
+#include "colour_reference.h"
+
+#include <stdlib.h>
+
+#define GAMMA_STEP 0.01f // Gamma values checked, 0 to `GAMMA_MAX` in these steps
+#define GAMMA_MAX 4.0f
+
+// The gamma correction `makeGammaTable()` replaced
+static uint8_t powfGamma(int component, float gamma)
+{
+    return static_cast<uint8_t>(powf(component / LED_PWM_RESOLUTION, gamma) * LED_PWM_RESOLUTION + 0.5f);
+}
+
+// Every component for `LED_GAMMA_VALUE` and a sweep of gamma values has to match exactly
+static bool checkGammaTable(void)
+{
+    static constexpr BuiltinColourLED::gamma_table_t compiled = BuiltinColourLED::makeGammaTable(LED_GAMMA_VALUE);
+    size_t mismatches = 0;
+    size_t checked = 0;
+    for (int component = 0; component < 256; component++, checked++)
+        if (compiled.value[component] != powfGamma(component, LED_GAMMA_VALUE))
+            mismatches++;
+
+    for (int step = 0; step <= int(GAMMA_MAX / GAMMA_STEP + 0.5f); step++)
+    {
+        const float gamma = step * GAMMA_STEP;
+        const BuiltinColourLED::gamma_table_t table = BuiltinColourLED::makeGammaTable(gamma);
+        for (int component = 0; component < 256; component++, checked++)
+        {
+            if (table.value[component] == powfGamma(component, gamma))
+                continue;
+            if (mismatches++ < 10)
+                printf("gamma %.2f component %d: table %d, powf %d\n", gamma, component, table.value[component], powfGamma(component, gamma));
+        }
+    }
+    printf("Gamma table: %zu of %zu entries differ from powf\n", mismatches, checked);
+    return mismatches == 0;
+}
+
+// Every `hsv_t` input within the specified ranges, each channel within 1 LSB of the float formula
+static bool checkHsv2rgb(void)
+{
+    BuiltinColourLED led;
+    int worst = 0;
+    size_t off = 0;
+    size_t checked = 0;
+    for (int h = 0; h <= 360; h++)
+        for (int s = 0; s <= 100; s++)
+            for (int v = 0; v <= 100; v++)
+            {
+                const BuiltinColourLED::hsv_t hsv(h, s, v);
+                BuiltinColourLED::rgb_t fixed(0, 0, 0);
+                BuiltinColourLED::rgb_t reference(0, 0, 0);
+                led.hsv2rgb(hsv, fixed);
+                floatHsv2rgb(hsv, reference);
+
+                const int differences[3] = {abs(fixed.r - reference.r), abs(fixed.g - reference.g), abs(fixed.b - reference.b)};
+                for (int difference : differences)
+                {
+                    checked++;
+                    off += (difference != 0);
+                    if (difference > worst)
+                    {
+                        worst = difference;
+                        printf("hsv(%d, %d, %d): fixed (%d, %d, %d), float (%d, %d, %d)\n", h, s, v, fixed.r, fixed.g, fixed.b,
+                               reference.r, reference.g, reference.b);
+                    }
+                }
+            }
+    printf("HSV to RGB: %zu of %zu channels differ from the float formula, by at most %d\n", off, checked, worst);
+    return worst <= 1;
+}
+
+int main(void)
+{
+    bool ok = checkGammaTable();
+    ok = checkHsv2rgb() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,150 @@
+// Checks of the FC_SPARSE and FC_INTERLEAVED kernels against the dense loop, bit for bit
+
+#include "fully_connected_layers.h"
+
+#include <string.h>
+
+// Outputs that differ in any bit from the dense loop, any NaN matches any other
+static size_t countMismatches(const std::vector<float> &output, const std::vector<float> &expected)
+{
+    size_t mismatches = 0;
+    for (size_t i = 0; i < output.size(); i++)
+        if (memcmp(&output[i], &expected[i], sizeof(float)) != 0 && !(isnan(output[i]) && isnan(expected[i])))
+            mismatches++;
+    return mismatches;
+}
+
+// Every block shape on odd and even layer sizes, from dense to empty. A column index past the input has to fail `prepare()`.
+static bool checkSparse(void)
+{
+    size_t layers = 0;
+    size_t failures = 0;
+    for (int block_rows : {1, 2, 4, 8})
+        for (int block_cols : {1, 2, 3, 4, 8})
+            for (int units : {3, 8, 33})
+                for (int depth : {7, 37, 720})
+                    for (float sparsity : {0.0f, 0.5f, 0.9f, 1.0f})
+                    {
+                        layers++;
+                        SparseLayer layer(block_rows, block_cols, units, depth, 2, sparsity, (units + depth) % 2, units != 8);
+                        KernelHarness harness(SparseFullyConnected::registration());
+                        const bool matches = (layer.prepare(harness) == kTfLiteOk) && (harness.invoke() == kTfLiteOk) &&
+                                             (countMismatches(layer.output, layer.expected) == 0);
+                        bool rejects = true;
+                        if (!layer.column_indices.empty())
+                        {
+                            layer.column_indices.back() = int16_t((depth + block_cols - 1) / block_cols);
+                            rejects = layer.prepare(harness) != kTfLiteOk;
+                        }
+                        if (matches && rejects)
+                            continue;
+                        if (failures++ < 10)
+                            printf("FC_SPARSE %dx%d, %dx%d, sparsity %.2f: %s\n", block_rows, block_cols, units, depth, sparsity,
+                                   matches ? "accepted a column index past the input" : "differs from the dense loop");
+                    }
+    printf("FC_SPARSE: %zu of %zu layers failed\n", failures, layers);
+    return failures == 0;
+}
+
+// Both palette formats for every block size. 4 bit indices pack two rows per byte, so a block of 1 has to fail `prepare()`.
+static bool checkPalette(void)
+{
+    size_t layers = 0;
+    size_t failures = 0;
+    for (int format : {INTERLEAVED_FC_PALETTE8, INTERLEAVED_FC_PALETTE4})
+        for (int block : {1, 2, 4, 8})
+            for (int units : {3, 8, 33})
+                for (int depth : {7, 720})
+                {
+                    layers++;
+                    PaletteLayer layer(format, block, units, depth, 2);
+                    KernelHarness harness(InterleavedFullyConnected::registration());
+                    const TfLiteStatus prepared = layer.prepare(harness);
+                    bool passed;
+                    if (layer.packed() > block)
+                        passed = prepared != kTfLiteOk;
+                    else
+                        passed = (prepared == kTfLiteOk) && (harness.invoke() == kTfLiteOk) && (countMismatches(layer.output, layer.expected) == 0);
+                    if (!passed && failures++ < 10)
+                        printf("FC_INTERLEAVED format %d, block %d, %dx%d failed\n", format, block, units, depth);
+                }
+    printf("FC_INTERLEAVED palettes: %zu of %zu layers failed\n", failures, layers);
+    return failures == 0;
+}
+
+// Both 16 bit formats for every block size, with subnormal, infinite and NaN weights
+static bool checkHalf(void)
+{
+    size_t layers = 0;
+    size_t failures = 0;
+    size_t special = 0; // Infinite or NaN outputs, the special weights have to reach them
+    for (int format : {INTERLEAVED_FC_FLOAT16, INTERLEAVED_FC_BFLOAT16})
+        for (int block : {1, 2, 4, 8})
+            for (int units : {3, 8, 33})
+                for (int depth : {7, 720})
+                {
+                    layers++;
+                    HalfLayer layer(format, block, units, depth, 2);
+                    KernelHarness harness(InterleavedFullyConnected::registration());
+                    for (float value : layer.expected)
+                        special += !isfinite(value);
+                    if ((layer.prepare(harness) == kTfLiteOk) && (harness.invoke() == kTfLiteOk) && (countMismatches(layer.output, layer.expected) == 0))
+                        continue;
+                    if (failures++ < 10)
+                        printf("FC_INTERLEAVED format %d, block %d, %dx%d differs from the dense loop\n", format, block, units, depth);
+                }
+    printf("FC_INTERLEAVED float16 and bfloat16: %zu of %zu layers failed, %zu outputs infinite or NaN\n", failures, layers, special);
+    return failures == 0 && special > 0;
+}
+
+// Both int8 formats for every block size, with a scale for the tensor, per row and per padded row. Any other number
+// of scales has to fail `prepare()`. Only INTERLEAVED_FC_INT8_INPUT requests a scratch buffer, left holding the
+// quantized input of the last batch.
+static bool checkInt8(void)
+{
+    size_t layers = 0;
+    size_t failures = 0;
+    for (int format : {INTERLEAVED_FC_INT8, INTERLEAVED_FC_INT8_INPUT})
+        for (int block : {1, 2, 4, 8})
+            for (int units : {3, 8, 33})
+                for (int depth : {7, 720})
+                {
+                    const int padded = (units + block - 1) / block * block;
+                    for (int num_scales : {1, units, padded, units - 1})
+                    {
+                        if (num_scales == padded && padded == units)
+                            continue; // Same as a scale per row
+                        layers++;
+                        Int8Layer layer(format, block, units, depth, 2, num_scales);
+                        KernelHarness harness(InterleavedFullyConnected::registration());
+                        const TfLiteStatus prepared = layer.prepare(harness);
+                        bool passed;
+                        if (num_scales == units - 1)
+                            passed = prepared != kTfLiteOk;
+                        else
+                        {
+                            const std::vector<std::vector<uint8_t>> &scratch = harness.scratchBuffers();
+                            passed = (prepared == kTfLiteOk) && (harness.invoke() == kTfLiteOk) && (countMismatches(layer.output, layer.expected) == 0);
+                            if (format == INTERLEAVED_FC_INT8_INPUT)
+                                passed = passed && scratch.size() == 1 && scratch[0].size() == size_t(depth) &&
+                                         memcmp(scratch[0].data(), layer.quantized.data(), depth) == 0;
+                            else
+                                passed = passed && scratch.empty();
+                        }
+                        if (!passed && failures++ < 10)
+                            printf("FC_INTERLEAVED format %d, block %d, %dx%d, %d scales failed\n", format, block, units, depth, num_scales);
+                    }
+                }
+    printf("FC_INTERLEAVED int8: %zu of %zu layers failed\n", failures, layers);
+    return failures == 0;
+}
+
+int main(void)
+{
+    srand(1);
+    bool ok = checkSparse();
+    ok = checkPalette() && ok;
+    ok = checkHalf() && ok;
+    ok = checkInt8() && ok;
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,107 @@
+// Register-level checks of `LSM6DSOXActivity` against a stand-in for the sensor registers
+
+#include "LSM6DSOXActivity.h"
+
+#include <stdlib.h>
+
+// Register file of the sensor, reads fail on request
+class FakeRegisters : public LSM6DSOXRegisters
+{
+public:
+    uint8_t value[128] = {};
+    size_t reads = 0;
+    bool failing = false;
+
+    int readRegister(uint8_t reg, uint8_t *data) override
+    {
+        reads++;
+        if (failing)
+            return -1;
+        *data = value[reg];
+        return 0;
+    }
+
+    int writeRegister(uint8_t reg, uint8_t data) override
+    {
+        value[reg] = data;
+        return 0;
+    }
+};
+
+static size_t failures = 0;
+
+static void check(bool condition, const char *what)
+{
+    if (condition)
+        return;
+    printf("failed: %s\n", what);
+    failures++;
+}
+
+// `enable()` has to keep the unrelated bits of the registers it shares with the sensor library
+static void checkConfiguration(void)
+{
+    FakeRegisters registers;
+    registers.value[IMU_REG_TAP_CFG0] = 0x0F;
+    registers.value[IMU_REG_WAKE_UP_THS] = 0x80;
+    registers.value[IMU_REG_MD1_CFG] = 0x01;
+    LSM6DSOXActivity activity(registers);
+
+    check(activity.update(1) == LSM6DSOXActivity::ACTIVITY_UNKNOWN && registers.reads == 0, "no register reads while disabled");
+    check(activity.enable(LSM6DSOXActivity::defaultConfig()), "enable");
+    printf("TAP_CFG0 %02x, TAP_CFG2 %02x, WAKE_UP_THS %02x, WAKE_UP_DUR %02x, MD1_CFG %02x\n", registers.value[IMU_REG_TAP_CFG0],
+           registers.value[IMU_REG_TAP_CFG2], registers.value[IMU_REG_WAKE_UP_THS], registers.value[IMU_REG_WAKE_UP_DUR], registers.value[IMU_REG_MD1_CFG]);
+    check(registers.value[IMU_REG_TAP_CFG0] == 0x0E, "TAP_CFG0: slope filter, sleep changes, no latching, other bits kept");
+    check(registers.value[IMU_REG_TAP_CFG2] == 0xA0, "TAP_CFG2: interrupts on, only the accelerometer slows down while inactive");
+    check(registers.value[IMU_REG_WAKE_UP_THS] == 0x84, "WAKE_UP_THS: threshold, bit 7 kept");
+    check(registers.value[IMU_REG_WAKE_UP_DUR] == 0x11, "WAKE_UP_DUR: fine threshold LSB, sleep duration");
+    check(registers.value[IMU_REG_MD1_CFG] == 0x01, "MD1_CFG: nothing routed to INT1");
+
+    check(activity.disable(), "disable");
+    check((registers.value[IMU_REG_TAP_CFG2] & (IMU_TAP_CFG2_INTERRUPTS_ENABLE | IMU_TAP_CFG2_INACT_EN_MASK)) == 0, "TAP_CFG2 after disable");
+    check(activity.getState() == LSM6DSOXActivity::ACTIVITY_UNKNOWN, "state after disable");
+}
+
+// States, callbacks and statistics over a sleep and a wake-up, with a failed read in between
+static void checkStates(void)
+{
+    FakeRegisters registers;
+    LSM6DSOXActivity activity(registers);
+    check(activity.enable(LSM6DSOXActivity::defaultConfig()), "enable");
+    size_t changes = 0;
+    activity.registerStateCallback([&changes](LSM6DSOXActivity::activity_state_t)
+                                   { changes++; });
+
+    check(activity.update(10) == LSM6DSOXActivity::ACTIVITY_ACTIVE, "active without a sleep state");
+    registers.value[IMU_REG_WAKE_UP_SRC] = IMU_WAKE_UP_SRC_SLEEP_STATE | IMU_WAKE_UP_SRC_SLEEP_CHANGE_IA;
+    check(activity.update(100) == LSM6DSOXActivity::ACTIVITY_INACTIVE && activity.isInactive(), "inactive in the sleep state");
+    registers.failing = true;
+    check(activity.update(200) == LSM6DSOXActivity::ACTIVITY_INACTIVE, "state kept when the read fails");
+    registers.failing = false;
+    registers.value[IMU_REG_WAKE_UP_SRC] = IMU_WAKE_UP_SRC_WU_IA;
+    check(activity.update(1600) == LSM6DSOXActivity::ACTIVITY_ACTIVE, "active after a wake-up");
+
+    const LSM6DSOXActivity::statistics_t stats = activity.getStatistics();
+    printf("%lu sleeps, %lu wake-ups, %lu ms inactive, %zu state changes\n", (unsigned long)stats.sleeps, (unsigned long)stats.wake_ups,
+           (unsigned long)stats.inactive_ms, changes);
+    check(stats.sleeps == 1 && stats.wake_ups == 1 && stats.inactive_ms == 1500, "statistics");
+    check(changes == 3, "one callback per state change");
+}
+
+// Conversions of the configuration to register steps
+static void checkConversions(void)
+{
+    bool fine = true;
+    check(LSM6DSOXActivity::wakeUpThreshold(1000, 4, &fine) == 16 && !fine, "1000 mG at 4 g in FS / 64 steps");
+    check(LSM6DSOXActivity::sleepDuration(0, 104) == 0, "shortest sleep duration");
+    check(LSM6DSOXActivity::sleepDuration(100000, 104) == 15, "sleep duration clamped to the register");
+}
+
+int main(void)
+{
+    checkConfiguration();
+    checkStates();
+    checkConversions();
+    printf("LSM6DSOXActivity: %zu failed checks\n", failures);
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
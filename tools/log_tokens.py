@@ -0,0 +1,176 @@
+#!/usr/bin/env python3
+"""Token table for tokenized log messages, see `TokenizedLog.h`.
+
+Scans the sketch sources for logging macros (`LOG(...)`, `IMU_LOG(...)`, `TOKENIZED_LOG(...)`, ...)
+whose format argument is a string literal, and maps the FNV-1a token of every format string to it.
+
+Usage:
+    python tools/log_tokens.py                      # Print the table of the sketch next to this tool
+    python tools/log_tokens.py -o tokens.csv        # Save it for `telemetry_decode.py --tokens`
+"""
+
+import argparse
+import csv
+import glob
+import os
+import re
+import struct
+import sys
+
+SKETCH_DIRECTORY = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+SOURCE_PATTERNS = ("*.ino", "*.cpp", "*.h")
+
+FNV_OFFSET = 2166136261
+FNV_PRIME = 16777619
+
+# Any upper case macro with LOG in its name, e.g. LOG, LOG_INFO, IMU_LOG, TOKENIZED_LOG
+MACRO_CALL = re.compile(r"\b([A-Z0-9_]*LOG[A-Z0-9_]*)\s*\(")
+STRING_LITERALS = re.compile(r'\s*((?:"(?:[^"\\\n]|\\.)*"\s*)+)')
+STRING_LITERAL = re.compile(r'"((?:[^"\\\n]|\\.)*)"')
+CONVERSION = re.compile(r"%([-+ #0]*)(\*|\d+)?(?:\.(\*|\d+))?(hh|h|ll|l|j|z|t|L)?([diouxXeEfFgGaAcspn%])")
+SIMPLE_ESCAPES = {"n": "\n", "t": "\t", "r": "\r", "0": "\0", "\\": "\\", '"': '"', "'": "'", "a": "\a", "b": "\b", "f": "\f", "v": "\v", "?": "?"}
+
+
+def token(string):
+    """FNV-1a hash of the UTF-8 bytes, matches `TokenizedLog::token`."""
+    value = FNV_OFFSET
+    for byte in string.encode("utf-8"):
+        value = ((value ^ byte) * FNV_PRIME) & 0xFFFFFFFF
+    return value
+
+
+def unescape(literal):
+    """Resolve C escape sequences of a string literal body."""
+    result = []
+    index = 0
+    while index < len(literal):
+        char = literal[index]
+        if char != "\\":
+            result.append(char)
+            index += 1
+            continue
+        escape = literal[index + 1]
+        if escape == "x":
+            digits = re.match(r"[0-9a-fA-F]+", literal[index + 2:]).group(0)
+            result.append(chr(int(digits, 16)))
+            index += 2 + len(digits)
+        elif escape in "01234567" and re.match(r"[0-7]{1,3}", literal[index + 1:]).group(0) != "0":
+            digits = re.match(r"[0-7]{1,3}", literal[index + 1:]).group(0)
+            result.append(chr(int(digits, 8)))
+            index += 1 + len(digits)
+        else:
+            result.append(SIMPLE_ESCAPES.get(escape, escape))
+            index += 2
+    return "".join(result)
+
+
+def scan_source(text):
+    """Yield every format string literal passed to a logging macro."""
+    for call in MACRO_CALL.finditer(text):
+        if call.group(1) == "LOG_TOKEN" or text[:call.start()].rstrip().endswith("#define"):
+            continue
+        # The format is the first string literal among the first two arguments (`TOKENIZED_LOG(sink, format, ...)`)
+        position = call.end()
+        for _ in range(2):
+            literals = STRING_LITERALS.match(text, position)
+            if literals:
+                yield "".join(unescape(body) for body in STRING_LITERAL.findall(literals.group(1)))
+                break
+            comma = text.find(",", position)
+            if comma < 0 or text.find(")", position) < comma:
+                break
+            position = comma + 1
+
+
+def build_table(directory=SKETCH_DIRECTORY):
+    """Map token to format string for all sources of a sketch."""
+    table = {}
+    for pattern in SOURCE_PATTERNS:
+        for path in sorted(glob.glob(os.path.join(directory, pattern))):
+            with open(path, "r", encoding="utf-8", errors="replace") as source:
+                for string in scan_source(source.read()):
+                    value = token(string)
+                    if value in table and table[value] != string:
+                        sys.stderr.write("Token collision 0x%08x: %r and %r\n" % (value, table[value], string))
+                    table[value] = string
+    return table
+
+
+def load_table(path):
+    with open(path, "r", newline="", encoding="utf-8") as table_file:
+        return {int(row[0], 16): unescape(row[1]) for row in csv.reader(table_file) if row}
+
+
+def save_table(table, output):
+    writer = csv.writer(output)
+    for value, string in sorted(table.items()):
+        writer.writerow(["%08x" % value, string.encode("unicode_escape").decode("ascii")])
+
+
+def read_varint(data, offset):
+    result = 0
+    shift = 0
+    while True:
+        byte = data[offset]
+        offset += 1
+        result |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            break
+    return (result >> 1) ^ -(result & 1), offset
+
+
+def format_message(string, data):
+    """Decode the arguments according to the conversions in `string` and format it like printf."""
+    output = []
+    offset = 0
+    position = 0
+    for conversion in CONVERSION.finditer(string):
+        output.append(string[position:conversion.start()])
+        position = conversion.end()
+        flags, width, precision, _, kind = conversion.groups()
+        if kind == "%":
+            output.append("%")
+            continue
+        try:
+            if kind in "eEfFgGaA":
+                value = struct.unpack_from("<f", data, offset)[0]
+                offset += 4
+                kind = "e" if kind in "aA" else kind
+            elif kind == "s":
+                length = data[offset]
+                value = data[offset + 1:offset + 1 + length].decode("utf-8", "replace")
+                offset += 1 + length
+            else:
+                value, offset = read_varint(data, offset)
+                if kind in "ouxX" and value < 0:
+                    value &= 0xFFFFFFFF
+                if kind == "p":
+                    kind, flags = "x", "#" + flags
+                elif kind == "c":
+                    value = chr(value & 0xFF)
+        except (IndexError, struct.error):
+            output.append("<truncated>")
+            return "".join(output)
+        output.append(("%" + flags + (width or "") + ("." + precision if precision else "") + kind) % value)
+    output.append(string[position:])
+    return "".join(output)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("directory", nargs="?", default=SKETCH_DIRECTORY, help="sketch directory to scan")
+    parser.add_argument("-o", "--output", help="write the table to this CSV file instead of stdout")
+    args = parser.parse_args()
+
+    table = build_table(args.directory)
+    if args.output:
+        with open(args.output, "w", newline="", encoding="utf-8") as output:
+            save_table(table, output)
+        sys.stderr.write("%d tokens written to %s\n" % (len(table), args.output))
+    else:
+        save_table(table, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
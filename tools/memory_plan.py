@@ -0,0 +1,191 @@
+#!/usr/bin/env python3
+"""Plan the tensor arena of a model on the host and embed the plan as TFLM offline memory plan metadata.
+
+`AllocateTensors()` otherwise runs the greedy memory planner of TFLM on every boot and model switch. This tool
+computes the same kind of layout ahead of time: the lifetime of every activation tensor in operator order, then the
+largest tensors first, each at the lowest offset that does not overlap a tensor alive at the same time, aligned like
+TFLM aligns its buffers. The offsets are stored in the "OfflineMemoryAllocation" metadata of the model:
+
+    int32 [version 0] [subgraph 0] [number of tensors n] [offset of tensor 0] ... [offset of tensor n - 1]
+
+Offsets count from the start of the non-persistent part of the arena. Constant tensors get -1 and stay in the model.
+TFLM then places the planned tensors where they are told and only plans what the model leaves out, the scratch
+buffers of the kernels, so the arena layout no longer depends on the planner of the TFLM version in the build.
+
+Run it last, the other tools rebuild the model without the plan. The metadata already in the model is kept.
+The sketch reports the allocation time of every model and whether it carried a plan when switching with 'm'.
+
+Usage:
+    python tools/memory_plan.py model.h model.h                  # Plan the built-in model in place
+    python tools/memory_plan.py int8_model.h int8_model.h --prefix int8_model
+    python tools/memory_plan.py model.h --show                   # Print the plan of a model
+"""
+
+import argparse
+import struct
+import sys
+
+import telemetry_decode
+import tflite_builder
+import tflite_model
+
+METADATA_NAME = "OfflineMemoryAllocation"  # `kOfflineMemAllocMetadata` of TFLM
+METADATA_VERSION = 0
+ONLINE = -1  # Planned by TFLM at runtime
+ALIGNMENT = 16  # `MicroArenaBufferAlignment()` of TFLM
+
+TYPE_SIZES = {tflite_model.TENSOR_FLOAT32: 4, tflite_model.TENSOR_FLOAT16: 2, tflite_model.TENSOR_INT32: 4,
+              tflite_model.TENSOR_UINT8: 1, 4: 8, tflite_model.TENSOR_INT16: 2, tflite_model.TENSOR_INT8: 1}
+
+
+def align(value):
+    return -(-value // ALIGNMENT) * ALIGNMENT
+
+
+def lifetimes(model):
+    """First and last operator of every activation tensor, like the allocation info of TFLM with model inputs from
+    the first and model outputs up to the last operator. Later activations may reuse the input, the sketch copies its
+    window in before every `Invoke()`."""
+    last_op = len(model.operators) - 1
+    spans = {}
+
+    def use(tensor, op):
+        if tensor < 0 or model.tensors[tensor].data:
+            return
+        first, last = spans.get(tensor, (op, op))
+        spans[tensor] = (min(first, op), max(last, op))
+
+    for tensor in model.inputs:
+        use(tensor, 0)
+    for op in model.operators:
+        for tensor in op.inputs:
+            use(tensor, op.index)
+        for tensor in op.outputs:
+            use(tensor, op.index)
+    for tensor in model.outputs:
+        use(tensor, last_op)
+    return spans
+
+
+def tensor_bytes(tensor):
+    return tensor.elements() * TYPE_SIZES[tensor.type]
+
+
+def plan(model):
+    """Arena offset of every tensor (ONLINE for constants) and the bytes the plan spans."""
+    spans = lifetimes(model)
+    offsets = [ONLINE] * len(model.tensors)
+    placed = []  # (offset, size, first, last)
+    # Largest first, earlier tensors first among equals, as the greedy planner of TFLM orders them
+    for tensor in sorted(spans, key=lambda index: (-tensor_bytes(model.tensors[index]), spans[index][0], index)):
+        size = align(tensor_bytes(model.tensors[tensor]))
+        first, last = spans[tensor]
+        offset = 0
+        for other_offset, other_size, other_first, other_last in sorted(placed):
+            if other_last < first or other_first > last:
+                continue  # Never alive together
+            if offset + size <= other_offset:
+                break
+            offset = max(offset, other_offset + other_size)
+        offsets[tensor] = offset
+        placed.append((offset, size, first, last))
+    return offsets, max([offset + size for offset, size, _, _ in placed] or [0])
+
+
+def verify(model, offsets):
+    """Problems of a plan: planned constants, unplanned activations and overlaps of tensors alive together."""
+    spans = lifetimes(model)
+    problems = []
+    if len(offsets) != len(model.tensors):
+        return ["%d offsets for %d tensors" % (len(offsets), len(model.tensors))]
+    for tensor, offset in enumerate(offsets):
+        if offset != ONLINE and tensor not in spans:
+            problems.append("tensor %d is constant or unused but planned at %d" % (tensor, offset))
+        elif offset != ONLINE and offset % ALIGNMENT:
+            problems.append("tensor %d at %d is not aligned to %d" % (tensor, offset, ALIGNMENT))
+    planned = [tensor for tensor in spans if offsets[tensor] != ONLINE]
+    for index, tensor in enumerate(planned):
+        for other in planned[index + 1:]:
+            (first, last), (other_first, other_last) = spans[tensor], spans[other]
+            if last < other_first or other_last < first:
+                continue
+            start, end = offsets[tensor], offsets[tensor] + tensor_bytes(model.tensors[tensor])
+            other_start, other_end = offsets[other], offsets[other] + tensor_bytes(model.tensors[other])
+            if start < other_end and other_start < end:
+                problems.append("tensors %d and %d overlap while both are alive" % (tensor, other))
+    return problems
+
+
+def encode(offsets, subgraph=0):
+    return struct.pack("<%di" % (3 + len(offsets)), METADATA_VERSION, subgraph, len(offsets), *offsets)
+
+
+def decode(data):
+    """Offsets of a plan, None if `data` is not one."""
+    if len(data) < 12:
+        return None
+    version, _, count = struct.unpack_from("<3i", data)
+    if version != METADATA_VERSION or len(data) < 12 + 4 * count:
+        return None
+    return list(struct.unpack_from("<%di" % count, data, 12))
+
+
+def show(model, offsets):
+    spans = lifetimes(model)
+    print("%3s %-10s %8s %8s %9s  %s" % ("#", "Type", "Bytes", "Offset", "Ops", "Name"))
+    for tensor in sorted(spans, key=lambda index: (offsets[index], index)):
+        first, last = spans[tensor]
+        print("%3d %-10s %8d %8s %4d-%-4d  %s" % (tensor, tflite_model.TENSOR_TYPE_NAMES.get(model.tensors[tensor].type, "?"),
+                                                tensor_bytes(model.tensors[tensor]),
+                                                offsets[tensor] if offsets[tensor] != ONLINE else "online", first, last,
+                                                model.tensors[tensor].name.split(";")[0][:48]))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", help=".tflite file or model header")
+    parser.add_argument("output", nargs="?", help=".tflite file or header to write, may be the model itself")
+    parser.add_argument("--show", action="store_true", help="print the plan of the model instead of writing one")
+    parser.add_argument("--prefix", default="model", help="name prefix of the header definitions")
+    parser.add_argument("--labels", help="comma separated class names, taken from the model header by default")
+    args = parser.parse_args()
+    if args.output is None and not args.show:
+        parser.error("an output is required without --show")
+
+    model = tflite_model.Model.load(args.model)
+    if args.show:
+        offsets = decode(model.metadata_data.get(METADATA_NAME, b""))
+        if offsets is None:
+            print("No offline memory plan in %s" % args.model)
+            return 1
+        show(model, offsets)
+        problems = verify(model, offsets)
+        for problem in problems:
+            print(problem)
+        return 1 if problems else 0
+
+    offsets, size = plan(model)
+    problems = verify(model, offsets)
+    if problems:
+        for problem in problems:
+            print(problem)
+        return 1
+    show(model, offsets)
+    activations = sum(align(tensor_bytes(model.tensors[tensor])) for tensor in lifetimes(model))
+    print("Planned %d activation tensors in %d bytes (%d without reuse)" % (len(lifetimes(model)), size, activations))
+
+    metadata = dict(model.metadata_data)
+    metadata[METADATA_NAME] = encode(offsets)
+    data = tflite_builder.rebuild(model, metadata=metadata)
+    if args.output.endswith(".h"):
+        labels = args.labels.split(",") if args.labels else telemetry_decode.load_labels(args.model) or None
+        tflite_builder.write_header(args.output, data, args.prefix, labels, model.parameters())
+    else:
+        with open(args.output, "wb") as output:
+            output.write(data)
+    print("%s: %d bytes (was %d), %d parameters" % (args.output, len(data), len(model.data), model.parameters()))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
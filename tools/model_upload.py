@@ -0,0 +1,271 @@
+#!/usr/bin/env python3
+"""Upload a model into the flash region of Lab4_Model over serial, without rebuilding the sketch.
+
+Sends 'u', then the image in chunks of `MODEL_UPLOAD_CHUNK_SIZE` bytes, each CRC-checked and acknowledged,
+see `ModelUpload.h` for the protocol and `ModelStore.h` for the flash layout. The sketch keeps the image
+across resets and prefers it over the built-in `model.h`. Throughput and retries are reported at the end.
+
+`--flash` replaces the board with the host build of its upload path, `ModelUpload` and `ModelStore` on a
+file-backed flash (`make -C tests` builds it). `--error-rate` corrupts some of the requests and replies on the way.
+
+Usage:
+    python tools/model_upload.py model.tflite --port COM3
+    python tools/model_upload.py model.h --port /dev/ttyACM0          # The `model_data[]` of a header
+    python tools/model_upload.py model.tflite --flash flash.bin --error-rate 0.02  # POSIX only
+    python tools/model_upload.py --check flash.bin                    # Validate the image in a flash file
+"""
+
+import argparse
+import os
+import random
+import struct
+import subprocess
+import sys
+import time
+import zlib
+
+import telemetry_decode
+import tflite_model
+
+UPLOAD_BEGIN = 0x01
+UPLOAD_DATA = 0x02
+UPLOAD_END = 0x03
+UPLOAD_ABORT = 0x04
+
+UPLOAD_OK = 0x00
+UPLOAD_ERROR_FRAME = 0x01
+UPLOAD_ERROR_SEQUENCE = 0x02
+UPLOAD_ERROR_SIZE = 0x03
+UPLOAD_ERROR_FLASH = 0x04
+UPLOAD_ERROR_IMAGE = 0x05
+UPLOAD_ERROR_STATE = 0x06
+UPLOAD_ERROR_TIMEOUT = 0x07
+STATUS_NAMES = {0: "ok", 1: "corrupted request", 2: "unexpected offset", 3: "size", 4: "flash", 5: "image check", 6: "state",
+                7: "timeout"}
+
+MODEL_STORE_MAGIC = 0x4C444F4D
+SECTOR_SIZE = 4096  # Header sector of `ModelStore.h`, the image follows it
+
+REPLY_TIMEOUT = 1.0  # Seconds to wait for a reply
+BEGIN_TIMEOUT = 20.0  # Erasing the whole region takes a few seconds
+RETRIES = 8
+
+HOST_DEVICE = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "tests", "build", "model_upload_host")
+
+
+def encode_request(request, sequence, payload=b""):
+    frame = struct.pack("<BH", request, sequence) + payload
+    frame += struct.pack("<H", telemetry_decode.crc16(frame))
+    return telemetry_decode.cobs_encode(frame) + b"\x00"
+
+
+def check_image(flash):
+    """Image in the contents of a flash region, as `ModelStore::getImage()` sees it. Returns (image, problem)."""
+    magic, size, crc, header_crc = struct.unpack_from("<4I", flash)
+    if magic != MODEL_STORE_MAGIC or header_crc != zlib.crc32(flash[:12]):
+        return None, "no valid header"
+    if size == 0 or size > len(flash) - SECTOR_SIZE:
+        return None, "size %d does not fit" % size
+    image = bytes(flash[SECTOR_SIZE:SECTOR_SIZE + size])
+    if zlib.crc32(image) != crc:
+        return None, "CRC mismatch"
+    if image[4:8] != b"TFL3":
+        return None, "not a TFLite model"
+    return image, None
+
+
+class HostBoard:
+    """The upload path of the sketch built for the host, `tests/model_upload_host.cpp`, behind a lossy pipe."""
+
+    def __init__(self, device, flash, error_rate=0.0, seed=1):
+        if not os.path.exists(device):
+            sys.exit("%s not found, build it with `make -C tests`" % device)
+        self.process = subprocess.Popen([device, flash], stdin=subprocess.PIPE, stdout=subprocess.PIPE, bufsize=0)
+        os.set_blocking(self.process.stdout.fileno(), False)
+        self.error_rate = error_rate
+        self.random = random.Random(seed)
+        self.pending = bytearray()
+
+    def write(self, data):
+        # Requests are written whole, a single one after the 'u' command
+        if data.endswith(b"\x00"):
+            data = self.corrupt(data[:-1]) + b"\x00"
+        self.process.stdin.write(data)
+
+    def read(self):
+        """Output up to the last delimiter, one corrupted byte in some of the frames."""
+        try:
+            self.pending += self.process.stdout.read() or b""
+        except BlockingIOError:
+            pass
+        end = self.pending.rfind(b"\x00") + 1
+        frames, self.pending = bytes(self.pending[:end]).split(b"\x00")[:-1], self.pending[end:]
+        return b"".join(self.corrupt(frame) + b"\x00" for frame in frames)
+
+    def corrupt(self, data):
+        data = bytearray(data)
+        if data and self.random.random() < self.error_rate:
+            index = self.random.randrange(len(data))
+            data[index] = (data[index] ^ 0x20) or 0x01  # Never a delimiter, the frame stays in one piece
+        return bytes(data)
+
+    def close(self):
+        """Ends the program once it wrote the flash file. Returns its exit code."""
+        self.process.stdin.close()
+        return self.process.wait()
+
+
+class SerialBoard:
+    """The board behind a serial port."""
+
+    def __init__(self, port, baud):
+        try:
+            import serial
+        except ImportError:
+            sys.exit("pyserial is required for --port, install it with `pip install pyserial`")
+        self.port = serial.Serial(port, baud, timeout=0.01)
+        self.port.reset_input_buffer()
+
+    def write(self, data):
+        self.port.write(data)
+
+    def read(self):
+        return self.port.read(4096)
+
+
+class Uploader:
+    def __init__(self, board, timeout=REPLY_TIMEOUT):
+        self.board = board
+        self.timeout = timeout
+        self.pending = bytearray()
+        self.sequence = 0
+        self.retries = 0
+        self.round_trips = []
+
+    def replies(self):
+        """Upload replies received so far, everything else on the line is skipped."""
+        self.pending += self.board.read()
+        while True:
+            delimiter = self.pending.find(b"\x00")
+            if delimiter < 0:
+                return
+            frame = telemetry_decode.cobs_decode(bytes(self.pending[:delimiter]))
+            del self.pending[:delimiter + 1]
+            if frame is None or len(frame) != 13 or frame[0] != telemetry_decode.FRAME_UPLOAD:
+                continue
+            if telemetry_decode.crc16(frame[:-2]) != struct.unpack_from("<H", frame, 11)[0]:
+                continue
+            yield struct.unpack_from("<BHBI", frame, 3)
+
+    def request(self, request, payload=b"", timeout=None, retries=RETRIES):
+        """Send a request until it is answered. Returns (status, value) of the reply."""
+        self.sequence = (self.sequence + 1) & 0xFFFF
+        frame = encode_request(request, self.sequence, payload)
+        for attempt in range(retries):
+            if attempt:
+                self.retries += 1
+            start = time.perf_counter()
+            self.board.write(frame)
+            reply = self.wait(request, start + (timeout or self.timeout))
+            if reply is not None:
+                self.round_trips.append(time.perf_counter() - start)
+                return reply
+        return UPLOAD_ERROR_TIMEOUT, 0
+
+    def wait(self, request, deadline):
+        """Reply to the current request, None if it is lost or the board could not read the request."""
+        while time.perf_counter() < deadline:
+            for reply_request, sequence, status, value in self.replies():
+                if status == UPLOAD_ERROR_TIMEOUT:
+                    sys.exit("The board abandoned the upload")
+                if status == UPLOAD_ERROR_FRAME and reply_request == 0:
+                    return None  # Corrupted on the way, send it again right away
+                if reply_request == request and sequence == self.sequence:
+                    return status, value
+            time.sleep(0.0005)
+        return None
+
+    def upload(self, image):
+        self.board.write(b"u")
+        time.sleep(0.05)
+        self.replies()
+
+        start = time.perf_counter()
+        status, value = self.request(UPLOAD_BEGIN, struct.pack("<II", len(image), zlib.crc32(image)), max(BEGIN_TIMEOUT * self.timeout / REPLY_TIMEOUT, self.timeout))
+        if status != UPLOAD_OK:
+            self.fail("UPLOAD_BEGIN", status, value)
+        erase_time = time.perf_counter() - start
+        chunk_size = value
+
+        offset = 0
+        while offset < len(image):
+            chunk = image[offset:offset + chunk_size]
+            status, value = self.request(UPLOAD_DATA, struct.pack("<I", offset) + chunk)
+            if status == UPLOAD_ERROR_SEQUENCE and value <= len(image):
+                offset = value  # Resume where the board is
+                continue
+            if status != UPLOAD_OK:
+                self.fail("UPLOAD_DATA at %d" % offset, status, value)
+            if offset * 20 // len(image) != value * 20 // len(image):
+                sys.stderr.write("\r%3d%%" % (100 * value // len(image)))
+            offset = value
+        sys.stderr.write("\n")
+
+        status, value = self.request(UPLOAD_END)
+        if status != UPLOAD_OK:
+            self.fail("UPLOAD_END", status, value)
+        elapsed = time.perf_counter() - start
+        self.request(UPLOAD_ABORT, retries=1)  # Ends the session, repeating it would reach the command handler of the sketch
+
+        round_trips = sorted(self.round_trips)
+        print("Uploaded %d bytes in %.2f s: %.1f KiB/s, board %d ms" % (len(image), elapsed, len(image) / elapsed / 1024.0, value))
+        print("Erase %.2f s, %d chunks of %d bytes, round trip median %.2f ms, max %.2f ms, %d retries" % (
+            erase_time, (len(image) + chunk_size - 1) // chunk_size, chunk_size,
+            1000.0 * round_trips[len(round_trips) // 2], 1000.0 * round_trips[-1], self.retries))
+
+    def fail(self, stage, status, value):
+        self.request(UPLOAD_ABORT, retries=1)
+        sys.exit("%s failed: %s (value %d)" % (stage, STATUS_NAMES.get(status, status), value))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", nargs="?", help=".tflite file or model header")
+    parser.add_argument("--port", help="serial port of the board, e.g. COM3 or /dev/ttyACM0")
+    parser.add_argument("--baud", type=int, default=921600, help="baud rate (ignored by the USB serial port)")
+    parser.add_argument("--flash", help="run the host build of the board on this flash file instead of --port")
+    parser.add_argument("--device", default=HOST_DEVICE, help="host build of the board for --flash, default %(default)s")
+    parser.add_argument("--error-rate", type=float, default=0.0, help="fraction of frames corrupted on the way to and from --flash")
+    parser.add_argument("--timeout", type=float, help="seconds to wait for a reply, default %.1f (0.05 for --flash)" % REPLY_TIMEOUT)
+    parser.add_argument("--check", metavar="FLASH", help="only validate the image in a flash file")
+    args = parser.parse_args()
+
+    if args.check:
+        with open(args.check, "rb") as source:
+            image, problem = check_image(source.read())
+        if image is None:
+            sys.exit("%s: %s" % (args.check, problem))
+        model = tflite_model.Model(image)
+        print("%s: valid model of %d bytes, %d parameters, CRC-32 %08x" % (args.check, len(image), model.parameters(), zlib.crc32(image)))
+        return
+
+    if not args.model or not (args.port or args.flash):
+        parser.error("a model and --port or --flash are required")
+    image = tflite_model.read_model_bytes(args.model)
+    if image[4:8] != b"TFL3":
+        sys.exit("%s is not a TFLite model" % args.model)
+    tflite_model.Model(image)  # Fails loudly on a broken flatbuffer
+
+    board = HostBoard(args.device, args.flash, args.error_rate) if args.flash else SerialBoard(args.port, args.baud)
+    timeout = args.timeout or (0.05 if args.flash else REPLY_TIMEOUT)
+    Uploader(board, timeout).upload(image)
+    if args.flash:
+        if board.close():
+            sys.exit("%s failed" % args.device)
+        with open(args.flash, "rb") as source:
+            image, problem = check_image(source.read())
+        print("%s: %s" % (args.flash, problem or "image valid"))
+
+
+if __name__ == "__main__":
+    main()
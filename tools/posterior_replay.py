@@ -0,0 +1,325 @@
+#!/usr/bin/env python3
+"""Replay a telemetry capture through the model and the posterior filters, and report decision latency and accuracy.
+
+Mirrors the decision path of the sketch: sliding windows every `--stride` samples, `MotionGate`,
+`LogitDecision` margins (or probabilities with `--probabilities`), `PosteriorFilter` and `GestureDetector`.
+The model runs on the host with `tflite_model.py`, so the capture only needs the raw IMU samples:
+set the log level to 4 and the IMU log interval to 1 (send '4' and cycle 'i'), then record with
+`telemetry_decode.py --port COM3 --save capture.bin`.
+
+The ground truth is a CSV file with one gesture per line: `start_ms,end_ms,gesture`,
+where the times use the sample timestamps of the capture and gesture is a name or index of `gestures[]`.
+
+Usage:
+    python tools/posterior_replay.py capture.bin truth.csv
+    python tools/posterior_replay.py capture.bin truth.csv --stride 4,8,16 --events
+    python tools/posterior_replay.py capture.bin truth.csv --gates off,2500:400,10000:1600 --invoke-ms 40
+"""
+
+import argparse
+import csv
+import math
+import os
+import statistics
+import struct
+import sys
+
+import telemetry_decode
+import tflite_model
+
+NUM_SAMPLES = 120  # `num_samples` of the sketch
+NUM_FEATURES = 6   # `num_features` of the sketch
+
+# Defaults of `GestureDetector.h` and `PosteriorFilter.h`
+GESTURE_ENTER_THRESHOLD = 0.80
+GESTURE_EXIT_THRESHOLD = 0.60
+GESTURE_DEBOUNCE_COUNT = 2
+GESTURE_REFRACTORY_PERIOD = 300
+GESTURE_IDLE_INDEX = 0
+POSTERIOR_EARLY_COMMIT = 0.95
+
+# Defaults of `MotionGate.h`
+MOTION_GATE_ACC_VARIANCE = 2500
+MOTION_GATE_GYRO_ENERGY = 400
+
+FILTERS = ("none", "ema:0.3", "ema:0.5", "ema:0.7", "majority:3", "majority:5", "majority:7")
+
+
+class SampleCollector(telemetry_decode.Decoder):
+    """Keeps the IMU samples of a capture instead of printing them."""
+
+    def __init__(self):
+        super().__init__([], {}, output=open(os.devnull, "w"))
+        self.samples = []
+
+    def handle(self, frame_type, payload):
+        if frame_type == telemetry_decode.FRAME_IMU_SAMPLE:
+            values = struct.unpack_from("<I6i", payload)
+            self.samples.append((values[0], [value / 1000.0 for value in values[1:]], values[1:]))
+
+
+def read_samples(path):
+    collector = SampleCollector()
+    with open(path, "rb") as capture:
+        data = capture.read()
+    for encoded in data.split(b"\x00"):
+        if encoded:
+            collector.feed(encoded)
+    if collector.dropped:
+        sys.stderr.write("Warning: %d frames were dropped, windows across the gaps are distorted\n" % collector.dropped)
+    return collector.samples
+
+
+def read_truth(path, labels):
+    truth = []
+    with open(path, "r", newline="") as truth_file:
+        for row in csv.reader(truth_file):
+            if not row or row[0].strip().startswith("#"):
+                continue
+            gesture = row[2].strip()
+            index = labels.index(gesture) if gesture in labels else int(gesture)
+            truth.append((int(row[0]), int(row[1]), index))
+    return truth
+
+
+def margin_threshold(probability, num_classes):
+    """Matches `LogitDecision::marginThreshold`."""
+    if num_classes < 2 or probability <= 0.0:
+        return -math.inf
+    if probability >= 1.0:
+        return math.inf
+    return math.log((num_classes - 1) * probability / (1.0 - probability))
+
+
+def margins(logits):
+    """Matches `LogitDecision::margins`."""
+    ordered = sorted(logits, reverse=True)
+    best = logits.index(ordered[0])
+    second = ordered[1] if len(ordered) > 1 else -math.inf
+    return [value - (second if index == best else ordered[0]) for index, value in enumerate(logits)]
+
+
+class PosteriorFilter:
+    """Port of `PosteriorFilter`."""
+
+    def __init__(self, num_classes, mode="none", parameter=None, early_commit=POSTERIOR_EARLY_COMMIT):
+        self.num_classes = num_classes
+        self.mode = mode
+        self.alpha = parameter if mode == "ema" else 0.5
+        self.vote_length = int(parameter) if mode == "majority" else 5
+        self.early_commit = early_commit
+        self.output = None
+        self.votes = []
+        self.early_commits = 0
+
+    def update(self, scores):
+        best = max(range(self.num_classes), key=lambda i: (scores[i], -i))
+        early = self.mode != "none" and scores[best] >= self.early_commit
+        if self.mode == "none" or early or self.output is None:
+            self.output = list(scores)
+            self.early_commits += early
+            if self.mode == "majority":
+                self.vote(best)
+            return self.output
+        if self.mode == "ema":
+            self.output = [old + self.alpha * (new - old) for old, new in zip(self.output, scores)]
+        elif self.mode == "majority":
+            self.vote(best)
+            tally = [self.votes.count(i) for i in range(self.num_classes)]
+            winner = max(range(self.num_classes), key=lambda i: (tally[i], -i))
+            if 2 * tally[winner] > len(self.votes):
+                lowest = min(scores)
+                self.output = [score if i == winner else lowest for i, score in enumerate(scores)]
+        return self.output
+
+    def vote(self, best):
+        self.votes.append(best)
+        del self.votes[:-self.vote_length]
+
+
+class GestureDetector:
+    """Port of `GestureDetector`, returns (type, gesture, timestamp) events."""
+
+    def __init__(self, num_classes, enter, exit, debounce=GESTURE_DEBOUNCE_COUNT,
+                 refractory=GESTURE_REFRACTORY_PERIOD, idle=GESTURE_IDLE_INDEX):
+        self.num_classes = num_classes
+        self.enter = enter
+        self.exit = min(exit, enter)
+        self.debounce = max(debounce, 1)
+        self.refractory = refractory
+        self.idle = idle
+        self.active = None
+        self.candidate = None
+        self.candidate_count = 0
+        self.last_end = None
+
+    def update(self, scores, timestamp):
+        if self.active is not None:
+            if scores[self.active] >= self.exit:
+                return None
+            event = ("end", self.active, timestamp)
+            self.active = None
+            self.last_end = timestamp
+            return event
+
+        candidates = [i for i in range(self.num_classes) if i != self.idle]
+        best = max(candidates, key=lambda i: (scores[i], -i)) if candidates else None
+        refractory = self.last_end is not None and timestamp - self.last_end < self.refractory
+        if best is None or scores[best] < self.enter or refractory:
+            self.candidate = None
+            self.candidate_count = 0
+            return None
+        if best != self.candidate:
+            self.candidate = best
+            self.candidate_count = 0
+        self.candidate_count += 1
+        if self.candidate_count < self.debounce:
+            return None
+        self.active = best
+        self.candidate = None
+        self.candidate_count = 0
+        return ("begin", best, timestamp)
+
+
+def gate_statistics(window):
+    """(acceleration variance in mG^2, gyroscope energy in DPS^2) of a window, matches `MotionGate`."""
+    count = len(window)
+    squares = 0
+    sums = [0, 0, 0]
+    energy = 0
+    for _, _, raw in window:
+        for axis in range(3):
+            acceleration = min(max(raw[axis], -32768), 32767)
+            sums[axis] += acceleration
+            squares += acceleration * acceleration
+            dps = min(max(int(raw[3 + axis] / 1000), -4000), 4000)
+            energy += dps * dps
+    scaled = count * squares - sum(value * value for value in sums)
+    return scaled // (count * count), energy // count
+
+
+def run_inferences(model, samples, stride):
+    """(timestamp, logits, probabilities, gate statistics) of every window, the newest sample is at the end like on the device."""
+    logits_index = model.logits_tensor()
+    results = []
+    for end in range(NUM_SAMPLES, len(samples) + 1, stride):
+        window = [value for _, features, _ in samples[end - NUM_SAMPLES:end] for value in features]
+        values = model.invoke([window])
+        probabilities = list(values[model.outputs[0]])
+        logits = list(values[logits_index]) if logits_index is not None else probabilities
+        results.append((samples[end - 1][0], logits, probabilities, gate_statistics(samples[end - NUM_SAMPLES:end])))
+    return results
+
+
+def evaluate(inferences, truth, num_classes, filter_spec, use_probabilities, tolerance, gate=None):
+    """Run the decision path over `inferences`. `gate` is (acceleration variance, gyroscope energy) or None."""
+    mode, _, parameter = filter_spec.partition(":")
+    if use_probabilities:
+        enter, exit, early = GESTURE_ENTER_THRESHOLD, GESTURE_EXIT_THRESHOLD, POSTERIOR_EARLY_COMMIT
+    else:
+        enter = margin_threshold(GESTURE_ENTER_THRESHOLD, num_classes)
+        exit = margin_threshold(GESTURE_EXIT_THRESHOLD, num_classes)
+        early = margin_threshold(POSTERIOR_EARLY_COMMIT, num_classes)
+    posterior = PosteriorFilter(num_classes, mode, float(parameter) if parameter else None, early)
+    detector = GestureDetector(num_classes, enter, exit)
+
+    # Scores the sketch reports for gated windows
+    if use_probabilities:
+        idle_scores = [1.0 if i == GESTURE_IDLE_INDEX else 0.0 for i in range(num_classes)]
+    else:
+        idle_scores = [20.0 if i == GESTURE_IDLE_INDEX else -20.0 for i in range(num_classes)]
+
+    events = []
+    invoked = 0
+    for timestamp, logits, probabilities, (variance, energy) in inferences:
+        if gate is not None and variance < gate[0] and energy < gate[1]:
+            scores = idle_scores
+        else:
+            scores = probabilities if use_probabilities else margins(logits)
+            invoked += 1
+        event = detector.update(posterior.update(scores), timestamp)
+        if event:
+            events.append(event)
+
+    begins = [event for event in events if event[0] == "begin"]
+    latencies = []
+    correct = 0
+    matched = set()
+    for start, end, gesture in truth:
+        if gesture == GESTURE_IDLE_INDEX:
+            continue
+        for index, (_, detected, timestamp) in enumerate(begins):
+            if index not in matched and start <= timestamp <= end + tolerance and detected == gesture:
+                matched.add(index)
+                latencies.append(timestamp - start)
+                correct += 1
+                break
+    segments = sum(1 for _, _, gesture in truth if gesture != GESTURE_IDLE_INDEX)
+    return {
+        "filter": filter_spec,
+        "events": events,
+        "segments": segments,
+        "detected": correct,
+        "false": len(begins) - len(matched),
+        "latencies": latencies,
+        "early_commits": posterior.early_commits,
+        "invoked": invoked,
+        "windows": len(inferences),
+    }
+
+
+def describe(latencies):
+    if not latencies:
+        return "%8s %8s %8s" % ("-", "-", "-")
+    ordered = sorted(latencies)
+    return "%8.0f %8.0f %8.0f" % (statistics.mean(ordered), statistics.median(ordered),
+                                  ordered[min(len(ordered) - 1, int(0.9 * len(ordered)))])
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", help="raw telemetry capture holding IMU sample frames")
+    parser.add_argument("truth", nargs="?", help="ground truth CSV: start_ms,end_ms,gesture")
+    parser.add_argument("--model", default=tflite_model.DEFAULT_MODEL_HEADER, help=".tflite file or model header")
+    parser.add_argument("--stride", default="8", help="comma separated inference strides in samples, `INFERENCE_STRIDE`")
+    parser.add_argument("--filters", default=",".join(FILTERS), help="comma separated none, ema:<alpha>, majority:<length>")
+    parser.add_argument("--gates", default="off,%d:%d" % (MOTION_GATE_ACC_VARIANCE, MOTION_GATE_GYRO_ENERGY),
+                        help="comma separated off or <acc variance mG^2>:<gyro energy DPS^2>")
+    parser.add_argument("--invoke-ms", type=float, default=0.0, help="measured `Invoke()` time (profiler 'p'), to report the CPU load")
+    parser.add_argument("--probabilities", action="store_true", help="decide on probabilities instead of logit margins")
+    parser.add_argument("--tolerance", type=int, default=200, help="ms after the end of a gesture a detection still counts")
+    parser.add_argument("--events", action="store_true", help="print every gesture event")
+    args = parser.parse_args()
+
+    labels = telemetry_decode.load_labels(args.model if args.model.endswith(".h") else telemetry_decode.DEFAULT_MODEL_HEADER)
+    model = tflite_model.Model.load(args.model)
+    samples = read_samples(args.capture)
+    if len(samples) < NUM_SAMPLES:
+        sys.exit("The capture holds %d IMU samples, at least %d are needed" % (len(samples), NUM_SAMPLES))
+    truth = read_truth(args.truth, labels) if args.truth else []
+    num_classes = model.tensors[model.outputs[0]].shape[-1]
+    label = lambda index: labels[index] if index < len(labels) else "g%d" % index
+
+    print("%d samples, %.1f s, %d labelled gestures" % (len(samples), (samples[-1][0] - samples[0][0]) / 1000.0,
+                                                       sum(1 for _, _, gesture in truth if gesture != GESTURE_IDLE_INDEX)))
+    gates = [None if spec == "off" else tuple(int(value) for value in spec.split(":")) for spec in args.gates.split(",")]
+    duration = max((samples[-1][0] - samples[0][0]) / 1000.0, 1e-3)
+    print("%6s %-12s %-15s %9s %6s %6s %8s %8s %8s %9s %7s" % ("stride", "filter", "gate", "detected", "false", "early",
+                                                                    "mean ms", "p50 ms", "p90 ms", "invoked", "cpu"))
+    for stride in (int(value) for value in args.stride.split(",")):
+        inferences = run_inferences(model, samples, stride)
+        for gate in gates:
+            for filter_spec in args.filters.split(","):
+                result = evaluate(inferences, truth, num_classes, filter_spec, args.probabilities, args.tolerance, gate)
+                cpu = "%6.1f%%" % (100.0 * result["invoked"] * args.invoke_ms / 1000.0 / duration) if args.invoke_ms else "      -"
+                print("%6d %-12s %-15s %4d/%-4d %6d %6d %s %4d/%-4d %s" % (
+                    stride, filter_spec, "%d:%d" % gate if gate else "off", result["detected"], result["segments"],
+                    result["false"], result["early_commits"], describe(result["latencies"]),
+                    result["invoked"], result["windows"], cpu))
+                if args.events:
+                    for kind, gesture, timestamp in result["events"]:
+                        print("       [%11d ms] %s %s" % (timestamp, label(gesture), kind))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,259 @@
+#!/usr/bin/env python3
+"""Prune the FULLY_CONNECTED layers of a model and store the sparse ones in block compressed sparse row form.
+
+The weight matrix [units, depth] of every layer is cut into blocks of `--block` RxC (R output rows by C input
+columns). Layers whose share of all-zero blocks reaches `--threshold` become the FC_SPARSE custom operator of
+`SparseFullyConnected.h`, which stores and multiplies only the remaining blocks. Denser layers keep the
+FULLY_CONNECTED kernel, the stored indices and the per block bookkeeping would cost more than they save.
+
+`--prune` zeroes the blocks of smallest magnitude (L1 norm) first, to that fraction of every selected layer.
+The model is not retrained here, so check what pruning costs with `--capture` or `posterior_replay.py`, or prune
+during training and convert the result with `--prune 0`.
+
+The sparse model has to match the pruned dense one with the reference interpreter of `tflite_model.py`, it is only
+written if it does. `--sweep` prunes to several sparsities instead and prints, for every one, the bytes the dense
+layers fetch per inference (weights and indices), their multiply-accumulates and the agreement with the original.
+The kernel time follows those two, the reference interpreter is far too slow to time the kernels themselves.
+On the device, compare the per layer timings of the models with 'p' after switching with 'm'.
+
+Usage:
+    python tools/sparsify.py model.h sparse_model.h --prefix sparse_model --prune 0.75 --capture capture.bin
+    python tools/sparsify.py pruned.tflite sparse.tflite --block 4x4 --threshold 0.3
+    python tools/sparsify.py model.h --sweep 0.5,0.75,0.9 --capture capture.bin
+    python tools/posterior_replay.py capture.bin truth.csv --model sparse_model.h      # Accuracy against the labels
+"""
+
+import argparse
+import struct
+import sys
+from array import array
+
+import telemetry_decode
+import tflite_builder
+import tflite_model
+import weight_relayout
+
+BLOCK_ROWS = (1, 2, 4, 8)  # Unrolled in `SparseFullyConnected.cpp`
+MAX_BLOCK_COLS = 8
+
+
+def parse_block(text):
+    """"4x2" as (4, 2)."""
+    rows, _, cols = text.lower().partition("x")
+    block = (int(rows), int(cols or 1))
+    if block[0] not in BLOCK_ROWS or not 1 <= block[1] <= MAX_BLOCK_COLS:
+        raise argparse.ArgumentTypeError("block rows must be one of %s and columns 1 to %d" % (BLOCK_ROWS, MAX_BLOCK_COLS))
+    return block
+
+
+def block_norms(values, units, depth, block):
+    """L1 norm of every block, row-major over [units / R][depth / C]."""
+    rows, cols = block
+    block_rows, block_cols = -(-units // rows), -(-depth // cols)
+    norms = [0.0] * (block_rows * block_cols)
+    for unit in range(units):
+        base = (unit // rows) * block_cols
+        for d in range(depth):
+            norms[base + d // cols] += abs(values[unit * depth + d])
+    return norms
+
+
+def prune(values, units, depth, block, sparsity):
+    """Copy of `values` with the smallest blocks zeroed until `sparsity` of all blocks are zero."""
+    rows, cols = block
+    block_cols = -(-depth // cols)
+    norms = block_norms(values, units, depth, block)
+    pruned = array("f", values)
+    for index in sorted(range(len(norms)), key=norms.__getitem__)[:int(round(sparsity * len(norms)))]:
+        block_row, block_col = divmod(index, block_cols)
+        for unit in range(block_row * rows, min(units, (block_row + 1) * rows)):
+            start = unit * depth + block_col * cols
+            pruned[start:min(start + cols, (unit + 1) * depth)] = array("f", bytes(4 * (min(cols, depth - block_col * cols))))
+    return pruned
+
+
+def to_bcsr(values, units, depth, block):
+    """Stored blocks as [blocks][C][R], row pointers and column indices of the non-zero blocks."""
+    rows, cols = block
+    block_rows, block_cols = -(-units // rows), -(-depth // cols)
+    norms = block_norms(values, units, depth, block)
+    blocks = array("f")
+    row_pointers = array("i", [0])
+    column_indices = array("h")
+    for block_row in range(block_rows):
+        for block_col in range(block_cols):
+            if norms[block_row * block_cols + block_col] == 0.0:
+                continue
+            stored = array("f", bytes(4 * rows * cols))  # Padding rows and columns stay zero
+            for row in range(min(rows, units - block_row * rows)):
+                for col in range(min(cols, depth - block_col * cols)):
+                    stored[col * rows + row] = values[(block_row * rows + row) * depth + block_col * cols + col]
+            blocks.extend(stored)
+            column_indices.append(block_col)
+        row_pointers.append(len(column_indices))
+    return blocks, row_pointers, column_indices
+
+
+def sparsify(model, block, sparsity=0.0, threshold=0.5, layers=None):
+    """Tensors and operators of `model` with the selected float FULLY_CONNECTED layers pruned to `sparsity`,
+    and the ones at `threshold` or sparser converted to FC_SPARSE. Returns them with a list of
+    (op, weights tensor, units, depth, block sparsity, stored bytes or 0 if the layer stays dense)."""
+    tensors = list(model.tensors)
+    operators = list(model.operators)
+    layers_info = []
+    for op in model.operators:
+        if op.code != tflite_model.BUILTIN_FULLY_CONNECTED or (layers is not None and op.index not in layers):
+            continue
+        weights = model.tensors[op.inputs[1]]
+        if not weights.data or weights.type != tflite_model.TENSOR_FLOAT32 or len(weights.shape) != 2:
+            continue  # Weights computed at runtime or quantized
+
+        units, depth = weights.shape
+        values = prune(weights.values(), units, depth, block, sparsity) if sparsity > 0 else weights.values()
+        norms = block_norms(values, units, depth, block)
+        zero = sum(1 for norm in norms if norm == 0.0) / len(norms)
+        if zero < threshold:
+            if sparsity > 0:
+                tensors[weights.index] = tflite_model.Tensor(weights.index, weights.name, weights.shape, weights.type,
+                                                             weights.buffer, values.tobytes(), weights.quantization)
+            layers_info.append((op, weights, units, depth, zero, 0))
+            continue
+
+        blocks, row_pointers, column_indices = to_bcsr(values, units, depth, block)
+        name = weight_relayout.layer_name(model, op)
+        tensors[weights.index] = tflite_model.Tensor(weights.index, weights.name, [len(column_indices), block[1], block[0]],
+                                                     tflite_model.TENSOR_FLOAT32, weights.buffer, blocks.tobytes())
+        pointers_tensor = tflite_model.Tensor(len(tensors), name + "/row_pointers", [len(row_pointers)],
+                                              tflite_model.TENSOR_INT32, 0, row_pointers.tobytes())
+        tensors.append(pointers_tensor)
+        indices_tensor = tflite_model.Tensor(len(tensors), name + "/column_indices", [len(column_indices)],
+                                             tflite_model.TENSOR_INT16, 0, column_indices.tobytes())
+        tensors.append(indices_tensor)
+        bias = op.inputs[2] if len(op.inputs) > 2 else -1
+        options = struct.pack("<BBB", block[0], block[1], op.options.get("activation", tflite_model.ACTIVATION_NONE))
+        operators[op.index] = tflite_model.Operator(op.index, tflite_model.BUILTIN_CUSTOM, tflite_model.CUSTOM_SPARSE_FC,
+                                                    [op.inputs[0], op.inputs[1], bias, pointers_tensor.index, indices_tensor.index],
+                                                    op.outputs, {}, options)
+        layers_info.append((op, weights, units, depth, zero, len(blocks.tobytes()) + len(row_pointers.tobytes()) + len(column_indices.tobytes())))
+    return tensors, operators, layers_info
+
+
+def pruned_dense(model, tensors, operators):
+    """The sparse model with the original FULLY_CONNECTED operators, on the pruned weights, as reference."""
+    dense_tensors = list(tensors[:len(model.tensors)])
+    for op in model.operators:
+        if operators[op.index].custom != tflite_model.CUSTOM_SPARSE_FC:
+            continue
+        weights = model.tensors[op.inputs[1]]
+        units, depth = weights.shape
+        rows, cols = operators[op.index].custom_options[0], operators[op.index].custom_options[1]
+        blocks = tensors[weights.index].values()
+        row_pointers = tensors[operators[op.index].inputs[3]].values()
+        column_indices = tensors[operators[op.index].inputs[4]].values()
+        values = array("f", bytes(4 * units * depth))
+        for block_row in range(len(row_pointers) - 1):
+            for block in range(row_pointers[block_row], row_pointers[block_row + 1]):
+                for row in range(min(rows, units - block_row * rows)):
+                    for col in range(min(cols, depth - column_indices[block] * cols)):
+                        values[(block_row * rows + row) * depth + column_indices[block] * cols + col] = blocks[(block * cols + col) * rows + row]
+        dense_tensors[weights.index] = tflite_model.Tensor(weights.index, weights.name, weights.shape, weights.type,
+                                                           weights.buffer, values.tobytes(), weights.quantization)
+    return tflite_model.Model(tflite_builder.rebuild(model, dense_tensors, model.operators))
+
+
+def multiply_accumulates(model):
+    """Multiply-accumulates of the dense layers per inference, padding of the sparse blocks included."""
+    total = 0
+    for op in model.operators:
+        if op.code == tflite_model.BUILTIN_FULLY_CONNECTED or op.custom == tflite_model.CUSTOM_SPARSE_FC:
+            total += model.tensors[op.inputs[1]].elements()
+    return total
+
+
+def dense_bytes(model):
+    """Constant bytes of the dense layers read per inference: weights, bias and block indices."""
+    total = 0
+    for op in model.operators:
+        if op.code == tflite_model.BUILTIN_FULLY_CONNECTED or op.custom == tflite_model.CUSTOM_SPARSE_FC:
+            total += sum(len(model.tensors[index].data) for index in op.inputs[1:] if index >= 0)
+    return total
+
+
+def sweep(model, block, sparsities, threshold, layers, windows):
+    """Bytes, multiply-accumulates and agreement with the original for every pruning fraction."""
+    dense_macs = multiply_accumulates(model)
+    print("%8s %7s %9s %9s %8s %9s %8s" % ("Sparsity", "Sparse", "Bytes", "MACs", "Fewer", "Diff", "Flipped"))
+    print("%8s %7s %9d %9d %8s %9s %8s" % ("0", "-", dense_bytes(model), dense_macs, "-", "-", "-"))
+    for sparsity in sparsities:
+        tensors, operators, layers_info = sparsify(model, block, sparsity, threshold, layers)
+        sparse = tflite_model.Model(tflite_builder.rebuild(model, tensors, operators))
+        macs = multiply_accumulates(sparse)
+        difference, flipped, _ = weight_relayout.check(model, sparse, windows)
+        print("%8.2f %4d/%-2d %9d %9d %7.2fx %9.3g %5d/%-3d" % (sparsity, sum(1 for info in layers_info if info[5]), len(layers_info),
+                                                             dense_bytes(sparse), macs, dense_macs / max(macs, 1), difference,
+                                                             flipped, len(windows)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", help=".tflite file or model header")
+    parser.add_argument("output", nargs="?", help=".tflite file or header to write, not needed with --sweep")
+    parser.add_argument("--block", type=parse_block, default=(8, 1), help="block of R output rows by C input columns, e.g. 8x1 or 4x4")
+    parser.add_argument("--prune", type=float, default=0.0, help="fraction of the blocks of every layer to zero, smallest first")
+    parser.add_argument("--threshold", type=float, default=0.5, help="share of zero blocks from which a layer is stored sparse")
+    parser.add_argument("--sweep", help="comma separated pruning fractions to benchmark instead of writing a model")
+    parser.add_argument("--layers", help="comma separated operator indices to prune and convert, all FULLY_CONNECTED layers by default")
+    parser.add_argument("--prefix", default="model", help="name prefix of the header definitions")
+    parser.add_argument("--labels", help="comma separated class names, taken from the model header by default")
+    parser.add_argument("--runs", type=int, default=4, help="random inputs for the parity check")
+    parser.add_argument("--capture", help="raw telemetry capture whose windows are checked as well")
+    parser.add_argument("--stride", type=int, default=8, help="samples between the windows of the capture")
+    args = parser.parse_args()
+    if args.output is None and args.sweep is None:
+        parser.error("an output is required without --sweep")
+
+    model = tflite_model.Model.load(args.model)
+    layers = set(int(index) for index in args.layers.split(",")) if args.layers else None
+    windows = weight_relayout.random_windows(model, args.runs)
+    if args.capture:
+        windows += weight_relayout.capture_windows(args.capture, args.stride)
+    if args.sweep:
+        sweep(model, args.block, [float(value) for value in args.sweep.split(",")], args.threshold, layers, windows)
+        return 0
+
+    tensors, operators, layers_info = sparsify(model, args.block, args.prune, args.threshold, layers)
+    if not any(info[5] for info in layers_info):
+        print("No FULLY_CONNECTED layer reaches %.0f%% zero %dx%d blocks, use --prune or a lower --threshold" % (
+            args.threshold * 100, args.block[0], args.block[1]))
+        return 1
+
+    print("%2s %-24s %12s %9s %9s %9s" % ("#", "Layer", "Shape", "Sparsity", "Bytes", "Stored"))
+    for op, weights, units, depth, zero, stored in layers_info:
+        print("%2d %-24s %12s %8.1f%% %9d %9s" % (op.index, weight_relayout.layer_name(model, op)[:24], "%dx%d" % (units, depth),
+                                                  zero * 100, len(weights.data), stored if stored else "dense"))
+
+    data = tflite_builder.rebuild(model, tensors, operators)
+    sparse = tflite_model.Model(data)
+    difference, flipped, _ = weight_relayout.check(pruned_dense(model, tensors, operators), sparse, windows)
+    print("Parity with the pruned dense model over %d windows: largest output difference %.3g, top class changed in %d" % (
+        len(windows), difference, flipped))
+    if difference > 1e-5 or flipped:
+        print("Sparse model does not match the pruned weights")
+        return 1
+    if args.prune > 0:
+        difference, flipped, _ = weight_relayout.check(model, sparse, windows)
+        print("Pruning against the original: largest output difference %.3g, top class changed in %d of %d windows" % (
+            difference, flipped, len(windows)))
+
+    if args.output.endswith(".h"):
+        labels = args.labels.split(",") if args.labels else telemetry_decode.load_labels(args.model) or None
+        tflite_builder.write_header(args.output, data, args.prefix, labels, model.parameters())
+    else:
+        with open(args.output, "wb") as output:
+            output.write(data)
+    print("%s: %d bytes (was %d), %d parameters" % (args.output, len(data), len(model.data), model.parameters()))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
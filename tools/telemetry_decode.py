@@ -0,0 +1,227 @@
+#!/usr/bin/env python3
+"""Decode the binary telemetry stream of Lab4_Model into the familiar text log.
+
+Frames are COBS encoded and delimited by 0x00, see `BinaryTelemetry.h` for the layout.
+
+Usage:
+    python tools/telemetry_decode.py --port COM3           # Live from the board (requires pyserial)
+    python tools/telemetry_decode.py capture.bin           # From a raw capture
+    python tools/telemetry_decode.py --port COM3 --save capture.bin
+    python tools/telemetry_decode.py --port COM3 --tokens tokens.csv   # Token table of the flashed build
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+import log_tokens
+
+FRAME_TEXT = 0x01
+FRAME_IMU_SAMPLE = 0x02
+FRAME_INFERENCE = 0x03
+FRAME_EVENT = 0x04
+FRAME_TOKENIZED = 0x05
+FRAME_UPLOAD = 0x06
+
+EVENT_STARTED = 0x01
+EVENT_INVOKE_FAILED = 0x02
+EVENT_GESTURE_UNHANDLED = 0x03
+EVENT_GESTURE_BEGIN = 0x04
+EVENT_GESTURE_END = 0x05
+EVENT_ACTIVITY = 0x06
+
+DEFAULT_MODEL_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "model.h")
+
+
+def crc16(data, crc=0xFFFF):
+    """CRC-16/CCITT-FALSE, matches `BinaryTelemetry::crc16`."""
+    for byte in data:
+        crc ^= byte << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def cobs_decode(data):
+    """Decode a single COBS block sequence (without the delimiter). Returns None if malformed."""
+    output = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        if code == 0 or index + code > len(data):
+            return None
+        output += data[index + 1:index + code]
+        index += code
+        if code < 0xFF and index < len(data):
+            output.append(0)
+    return bytes(output)
+
+
+def cobs_encode(data):
+    """COBS encode `data` (without the delimiter), matches `BinaryTelemetry::cobsEncode`."""
+    output = bytearray([0])
+    code_index = 0
+    code = 1
+    for byte in data:
+        if byte == 0:
+            output[code_index] = code
+            code_index = len(output)
+            output.append(0)
+            code = 1
+            continue
+        output.append(byte)
+        code += 1
+        if code == 0xFF:
+            output[code_index] = code
+            code_index = len(output)
+            output.append(0)
+            code = 1
+    output[code_index] = code
+    return bytes(output)
+
+
+def load_labels(path):
+    """Read the `gestures[]` table from a model header."""
+    try:
+        with open(path, "r") as header:
+            match = re.search(r"gestures\s*\[[^\]]*\]\s*=\s*\{([^}]*)\}", header.read())
+    except OSError:
+        return []
+    return re.findall(r'"([^"]*)"', match.group(1)) if match else []
+
+
+class Decoder:
+    def __init__(self, labels, tokens, output=sys.stdout):
+        self.labels = labels
+        self.tokens = tokens
+        self.output = output
+        self.expected_sequence = None
+        self.frames = 0
+        self.dropped = 0
+        self.corrupted = 0
+
+    def label(self, index):
+        return self.labels[index] if index < len(self.labels) else "g%d" % index
+
+    def feed(self, encoded):
+        frame = cobs_decode(encoded)
+        if frame is None or len(frame) < 5 or crc16(frame[:-2]) != struct.unpack_from("<H", frame, len(frame) - 2)[0]:
+            self.corrupted += 1
+            return
+        frame_type, sequence = struct.unpack_from("<BH", frame)
+        if self.expected_sequence is not None and sequence != self.expected_sequence:
+            self.dropped += (sequence - self.expected_sequence) & 0xFFFF
+        self.expected_sequence = (sequence + 1) & 0xFFFF
+        self.frames += 1
+        self.handle(frame_type, frame[3:-2])
+
+    def handle(self, frame_type, payload):
+        write = self.output.write
+        if frame_type == FRAME_TEXT:
+            write(payload.decode("utf-8", "replace"))
+        elif frame_type == FRAME_IMU_SAMPLE:
+            values = struct.unpack_from("<I6i", payload)
+            acc = [v / 1000.0 for v in values[1:4]]
+            gyro = [v / 1000.0 for v in values[4:7]]
+            write("[IMU] [%11d ms], " % values[0])
+            write("Acc: [%6.3f, %6.3f, %6.3f] G, " % tuple(acc))
+            write("Gyro: [%8.2f, %8.2f, %8.2f] DPS" % tuple(gyro))
+            write("\n")
+        elif frame_type == FRAME_INFERENCE:
+            timestamp, best, count = struct.unpack_from("<IBB", payload)
+            scores = struct.unpack_from("<%df" % count, payload, 6)
+            write("[Res] [%11d ms] |" % timestamp)
+            for index, score in enumerate(scores):
+                write(" [%6s: %4.2f]" % (self.label(index), score))
+            write(" | [%6s: %4.2f]\n" % (self.label(best), scores[best] if best < count else float("nan")))
+        elif frame_type == FRAME_EVENT:
+            timestamp, event_id, value = struct.unpack_from("<IBi", payload)
+            if event_id == EVENT_STARTED:
+                write("Starting...\n")
+            elif event_id == EVENT_INVOKE_FAILED:
+                write("Invoke failed!")
+            elif event_id == EVENT_GESTURE_UNHANDLED:
+                write("Gesture id %d unhandled" % value)
+            elif event_id == EVENT_GESTURE_BEGIN:
+                write("[Gst] [%11d ms] %s begin\n" % (timestamp, self.label(value)))
+            elif event_id == EVENT_GESTURE_END:
+                write("[Gst] [%11d ms] %s end\n" % (timestamp, self.label(value)))
+            elif event_id == EVENT_ACTIVITY:
+                write("[Act] [%11d ms] sensor %s\n" % (timestamp, "active" if value else "inactive"))
+            else:
+                write("[Evt] [%11d ms] id %d value %d\n" % (timestamp, event_id, value))
+        elif frame_type == FRAME_UPLOAD:
+            request, sequence, status, value = struct.unpack_from("<BHBI", payload)
+            write("[Upl] request %d #%d status %d value %d\n" % (request, sequence, status, value))
+        elif frame_type == FRAME_TOKENIZED:
+            value = struct.unpack_from("<I", payload)[0]
+            if value in self.tokens:
+                write(log_tokens.format_message(self.tokens[value], payload[4:]))
+            else:
+                write("[Unknown token 0x%08x: %s]\n" % (value, payload[4:].hex()))
+        else:
+            write("[Unknown frame type 0x%02x, %d bytes]\n" % (frame_type, len(payload)))
+        self.output.flush()
+
+    def summary(self):
+        return "%d frames, %d dropped, %d corrupted" % (self.frames, self.dropped, self.corrupted)
+
+
+def open_source(args):
+    if args.port:
+        try:
+            import serial
+        except ImportError:
+            sys.exit("pyserial is required for --port, install it with `pip install pyserial`")
+        port = serial.Serial(args.port, args.baud, timeout=0.1)
+        return lambda: port.read(4096)
+    stream = open(args.capture, "rb") if args.capture else sys.stdin.buffer
+    return lambda: stream.read(4096) or None
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", nargs="?", help="raw capture file, stdin if omitted and no --port is given")
+    parser.add_argument("--port", help="serial port of the board, e.g. COM3 or /dev/ttyACM0")
+    parser.add_argument("--baud", type=int, default=921600, help="baud rate (ignored by the USB serial port)")
+    parser.add_argument("--model-header", default=DEFAULT_MODEL_HEADER, help="model header holding the `gestures[]` labels")
+    parser.add_argument("--labels", help="comma separated gesture labels, overrides --model-header")
+    parser.add_argument("--tokens", help="token table from `log_tokens.py -o`, the sketch sources are scanned if omitted")
+    parser.add_argument("--save", help="also write the raw stream to this file")
+    args = parser.parse_args()
+
+    labels = args.labels.split(",") if args.labels else load_labels(args.model_header)
+    tokens = log_tokens.load_table(args.tokens) if args.tokens else log_tokens.build_table()
+    decoder = Decoder(labels, tokens)
+    read = open_source(args)
+    save = open(args.save, "wb") if args.save else None
+
+    pending = bytearray()
+    try:
+        while True:
+            chunk = read()
+            if chunk is None:
+                break
+            if save:
+                save.write(chunk)
+            pending += chunk
+            while True:
+                delimiter = pending.find(b"\x00")
+                if delimiter < 0:
+                    break
+                if delimiter:
+                    decoder.feed(bytes(pending[:delimiter]))
+                del pending[:delimiter + 1]
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if save:
+            save.close()
+        sys.stderr.write(decoder.summary() + "\n")
+
+
+if __name__ == "__main__":
+    main()
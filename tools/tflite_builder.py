@@ -0,0 +1,298 @@
+#!/usr/bin/env python3
+"""Minimal TFLite flatbuffer writer and model header generator, the counterpart of `tflite_model.py`.
+
+Serializes tensors and operators (`tflite_model.Tensor` / `tflite_model.Operator`, read from an existing
+model or made up) into a `.tflite` flatbuffer, and writes it as a C header in the layout of `model.h`.
+
+Usage:
+    python tools/tflite_builder.py model.h model.tflite       # Rewrite a model, drops signatures
+    python tools/tflite_builder.py model.tflite out.h --prefix gate_model
+    python tools/tflite_builder.py wave.tflite wave_model.h --prefix wave_model --labels idle,wave,circle
+"""
+
+import argparse
+import struct
+import sys
+
+import tflite_model
+
+FILE_IDENTIFIER = b"TFL3"
+BUFFER_ALIGNMENT = 16  # `force_align` of Buffer.data in the schema
+
+# BuiltinOptions union types of the schema
+OPTIONS_NONE = 0
+OPTIONS_FULLY_CONNECTED = 8
+OPTIONS_SOFTMAX = 9
+OPTIONS_RESHAPE = 17
+
+
+class Table:
+    """Flatbuffer table, `fields` maps the field index to a scalar (format, value) or a child object."""
+
+    def __init__(self, fields):
+        self.fields = {index: value for index, value in fields.items() if value is not None}
+
+
+class Vector:
+    """Vector of scalars (`element` is a struct format) or of tables (`element` is None)."""
+
+    def __init__(self, values, element=None, alignment=4):
+        self.values = values
+        self.element = element
+        self.alignment = alignment
+
+
+class String:
+    def __init__(self, text):
+        self.data = text.encode("utf-8") if isinstance(text, str) else bytes(text)
+
+
+def scalar(fmt, value):
+    return (fmt, value)
+
+
+class FlatBufferWriter:
+    """Writes objects front to back: every child follows the table or vector that refers to it,
+    so all offsets point forward as the format requires. Vtables are written right before their table."""
+
+    def __init__(self):
+        self.data = bytearray()
+
+    def align(self, alignment, extra=0):
+        """Pad so that `len(data) + extra` is a multiple of `alignment`."""
+        while (len(self.data) + extra) % alignment:
+            self.data.append(0)
+
+    def finish(self, root, identifier=FILE_IDENTIFIER):
+        self.data += b"\x00" * 4 + identifier
+        struct.pack_into("<I", self.data, 0, self.write(root))
+        self.align(4)
+        return bytes(self.data)
+
+    def write(self, item):
+        if isinstance(item, Table):
+            return self.write_table(item)
+        if isinstance(item, Vector):
+            return self.write_vector(item)
+        if isinstance(item, String):
+            self.align(4)
+            start = len(self.data)
+            self.data += struct.pack("<I", len(item.data)) + item.data + b"\x00"
+            return start
+        raise TypeError("Cannot serialize %r" % (item,))
+
+    def write_table(self, table):
+        # Inline layout: soffset to the vtable, then the fields by descending size so none needs padding
+        layout = []
+        for index, value in table.fields.items():
+            size = struct.calcsize("<" + value[0]) if isinstance(value, tuple) else 4
+            layout.append((size, index, value))
+        layout.sort(key=lambda entry: (-entry[0], entry[1]))
+        positions = {}
+        size = 4
+        for field_size, index, _ in layout:
+            positions[index] = size
+            size += field_size
+
+        count = max(table.fields) + 1 if table.fields else 0
+        vtable = struct.pack("<HH", 4 + 2 * count, size) + b"".join(
+            struct.pack("<H", positions.get(index, 0)) for index in range(count))
+        # Tables only hold 32 bit offsets and smaller scalars here, so 4 byte alignment is enough
+        self.align(4, len(vtable))
+        vtable_start = len(self.data)
+        self.data += vtable
+        start = len(self.data)
+        self.data += struct.pack("<i", start - vtable_start) + bytes(size - 4)
+
+        children = []
+        for field_size, index, value in layout:
+            if isinstance(value, tuple):
+                struct.pack_into("<" + value[0], self.data, start + positions[index], value[1])
+            else:
+                children.append((start + positions[index], value))
+        for position, child in children:
+            struct.pack_into("<I", self.data, position, self.write(child) - position)
+        return start
+
+    def write_vector(self, vector):
+        if vector.element is None:
+            self.align(4)
+            start = len(self.data)
+            self.data += struct.pack("<I", len(vector.values)) + bytes(4 * len(vector.values))
+            for index, child in enumerate(vector.values):
+                position = start + 4 + 4 * index
+                struct.pack_into("<I", self.data, position, self.write(child) - position)
+            return start
+
+        # Elements start right after the length and must meet `alignment`
+        self.align(max(vector.alignment, 4), 4)
+        start = len(self.data)
+        if isinstance(vector.values, (bytes, bytearray)):
+            self.data += struct.pack("<I", len(vector.values)) + vector.values
+        else:
+            self.data += struct.pack("<I%d%s" % (len(vector.values), vector.element), len(vector.values), *vector.values)
+        return start
+
+
+def operator_options(op):
+    """(union type, options table) of an operator."""
+    if op.code == tflite_model.BUILTIN_FULLY_CONNECTED:
+        return OPTIONS_FULLY_CONNECTED, Table({0: scalar("b", op.options.get("activation", tflite_model.ACTIVATION_NONE))})
+    if op.code == tflite_model.BUILTIN_SOFTMAX:
+        return OPTIONS_SOFTMAX, Table({0: scalar("f", op.options.get("beta", 1.0))})
+    if op.code == tflite_model.BUILTIN_RESHAPE and "new_shape" in op.options:
+        return OPTIONS_RESHAPE, Table({0: Vector(op.options["new_shape"], "i")})
+    return OPTIONS_NONE, None
+
+
+def quantization_table(parameters):
+    """QuantizationParameters from a dict with `scale`, `zero_point` and `quantized_dimension`."""
+    if not parameters:
+        return None
+    return Table({
+        2: Vector(parameters["scale"], "f"),
+        3: Vector(parameters.get("zero_point", [0] * len(parameters["scale"])), "q", 8),
+        6: scalar("i", parameters.get("quantized_dimension", 0)),
+    })
+
+
+def build_model(tensors, operators, inputs, outputs, metadata=None, description="Lab4_Model tools", name="main"):
+    """Serialize a single subgraph model. Tensors keep their order, their `buffer` is reassigned.
+
+    `metadata` maps names to raw bytes, each stored in its own buffer."""
+    buffers = [b""]  # Buffer 0 is the empty sentinel
+    tensor_tables = []
+    for tensor in tensors:
+        buffer = 0
+        if tensor.data:
+            buffer = len(buffers)
+            buffers.append(tensor.data)
+        tensor_tables.append(Table({
+            0: Vector(list(tensor.shape), "i"),
+            1: scalar("B", tensor.type),
+            2: scalar("I", buffer),
+            3: String(tensor.name),
+            4: quantization_table(getattr(tensor, "quantization", None)),
+        }))
+
+    codes = []
+    operator_tables = []
+    for op in operators:
+        key = (op.code, op.custom)
+        if key not in codes:
+            codes.append(key)
+        options_type, options = operator_options(op)
+        custom_options = getattr(op, "custom_options", None)
+        operator_tables.append(Table({
+            0: scalar("I", codes.index(key)),
+            1: Vector(list(op.inputs), "i"),
+            2: Vector(list(op.outputs), "i"),
+            3: scalar("B", options_type) if options_type else None,
+            4: options,
+            5: Vector(bytes(custom_options), "B") if custom_options else None,
+        }))
+
+    metadata_tables = []
+    for key, value in (metadata or {}).items():
+        metadata_tables.append(Table({0: String(key), 1: scalar("I", len(buffers))}))
+        buffers.append(value)
+
+    code_tables = [Table({
+        0: scalar("b", min(code, 127)),
+        1: String(custom) if custom else None,
+        2: scalar("i", 1),
+        3: scalar("i", code),
+    }) for code, custom in codes]
+
+    subgraph = Table({
+        0: Vector(tensor_tables),
+        1: Vector(list(inputs), "i"),
+        2: Vector(list(outputs), "i"),
+        3: Vector(operator_tables),
+        4: String(name),
+    })
+    root = Table({
+        0: scalar("I", tflite_model.TFLITE_SCHEMA_VERSION),
+        1: Vector(code_tables),
+        2: Vector([subgraph]),
+        3: String(description),
+        4: Vector([Table({0: Vector(bytes(data), "B", BUFFER_ALIGNMENT) if data else None}) for data in buffers]),
+        6: Vector(metadata_tables) if metadata_tables else None,
+    })
+    return FlatBufferWriter().finish(root)
+
+
+def rebuild(model, tensors=None, operators=None, metadata=None):
+    """Serialize `model` again, optionally with replaced tensors, operators or extra metadata."""
+    return build_model(tensors if tensors is not None else model.tensors,
+                       operators if operators is not None else model.operators,
+                       model.inputs, model.outputs, metadata)
+
+
+def descriptor(data, prefix, labels):
+    """`constexpr` shapes of the classifier in `data` for the sketch to `static_assert` its buffers against: the input
+    and output dimensions, `<prefix>_num_samples` and `<prefix>_num_features` from the last two input dimensions and
+    `<prefix>_num_classes` from the last output dimension, which has to be one score per label."""
+    model = tflite_model.Model(data)
+    if len(model.inputs) != 1 or len(model.outputs) != 1:
+        raise ValueError("%s has %d inputs and %d outputs, a classifier has one each" % (prefix, len(model.inputs), len(model.outputs)))
+    input_tensor, output_tensor = model.tensors[model.inputs[0]], model.tensors[model.outputs[0]]
+    if len(input_tensor.shape) < 2 or not output_tensor.shape:
+        raise ValueError("%s input %s is not a window of samples" % (prefix, input_tensor.shape))
+    if output_tensor.shape[-1] != len(labels):
+        raise ValueError("%s scores %d classes but has %d labels" % (prefix, output_tensor.shape[-1], len(labels)))
+
+    dims = ["constexpr unsigned int %s_%s_dims[%d] = {%s};" % (prefix, name, len(tensor.shape), ", ".join(str(dim) for dim in tensor.shape))
+            for name, tensor in (("input", input_tensor), ("output", output_tensor))]
+    width = max(len(definition) for definition in dims)
+    return ["%-*s // %s" % (width, definition, tensor.name.split(";")[0]) for definition, tensor in zip(dims, (input_tensor, output_tensor))] + [
+            "constexpr unsigned int %s_num_samples = %d;" % (prefix, input_tensor.shape[-2]),
+            "constexpr unsigned int %s_num_features = %d;" % (prefix, input_tensor.shape[-1]),
+            "constexpr unsigned int %s_num_classes = %d;" % (prefix, output_tensor.shape[-1])]
+
+
+def write_header(path, data, prefix="model", labels=None, parameters=None, extra=None):
+    """Write `data` as a C header in the layout of `model.h`: `<prefix>_data[]`, `<prefix>_data_len`,
+    `<prefix>_parameters` and, with `labels`, `gesture_len`, `gestures[]` and the `descriptor()` of the model.
+    Other prefixes than `model` prefix the label definitions as well, so several headers can be included for
+    `ModelRegistry`. `extra` is a list of additional `const` definitions inserted before the array."""
+    label_prefix = "" if prefix == "model" else prefix + "_"
+    lines = ["#pragma once", ""]
+    if labels is not None:
+        lines += ["constexpr unsigned int %sgesture_len = %d;" % (label_prefix, len(labels)), "",
+                  "const char *%sgestures[%d] = {%s};" % (label_prefix, len(labels), ", ".join('"%s"' % label for label in labels)), ""]
+        lines += descriptor(data, prefix, labels) + [""]
+    if parameters is not None:
+        lines += ["const unsigned int %s_parameters = %d;" % (prefix, parameters), ""]
+    for definition in extra or []:
+        lines += [definition, ""]
+    lines += ["const unsigned int %s_data_len = %d;" % (prefix, len(data)), ""]
+    lines.append("alignas(16) const unsigned char %s_data[%d] PROGMEM = {" % (prefix, len(data)))
+    for start in range(0, len(data), 16):
+        lines.append("    " + " ".join("0x%02x," % value for value in data[start:start + 16]))
+    lines += ["};", ""]
+    with open(path, "w", newline="\n") as header:
+        header.write("\n".join(lines))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", help=".tflite file or model header")
+    parser.add_argument("output", help=".tflite file or header to write")
+    parser.add_argument("--prefix", default="model", help="name prefix of the header definitions")
+    parser.add_argument("--labels", help="comma separated class names, writes the label table and the model shapes")
+    args = parser.parse_args()
+
+    model = tflite_model.Model.load(args.model)
+    data = rebuild(model)
+    if args.output.endswith(".h"):
+        labels = args.labels.split(",") if args.labels else None
+        write_header(args.output, data, args.prefix, labels, model.parameters())
+    else:
+        with open(args.output, "wb") as output:
+            output.write(data)
+    print("%s: %d bytes (was %d), %d parameters" % (args.output, len(data), len(model.data), model.parameters()))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
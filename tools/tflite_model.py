@@ -0,0 +1,401 @@
+#!/usr/bin/env python3
+"""Minimal TFLite flatbuffer reader and float reference interpreter, no TensorFlow or numpy required.
+
+Reads the model either from a `.tflite` file or from the `model_data[]` array of a model header,
+and runs the ops used by Lab4_Model (RESHAPE, FULLY_CONNECTED, SOFTMAX) in float32 semantics,
+as well as the FC_INTERLEAVED custom operator of `weight_relayout.py`.
+
+Usage:
+    python tools/tflite_model.py                   # Print the graph of model.h
+    python tools/tflite_model.py model.tflite
+"""
+
+import argparse
+import math
+import operator
+import os
+import re
+import struct
+import sys
+from array import array
+
+DEFAULT_MODEL_HEADER = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "model.h")
+
+TFLITE_SCHEMA_VERSION = 3
+
+# BuiltinOperator codes of the schema
+BUILTIN_FULLY_CONNECTED = 9
+BUILTIN_RESHAPE = 22
+BUILTIN_SOFTMAX = 25
+BUILTIN_CUSTOM = 32
+BUILTIN_NAMES = {BUILTIN_FULLY_CONNECTED: "FULLY_CONNECTED", BUILTIN_RESHAPE: "RESHAPE", BUILTIN_SOFTMAX: "SOFTMAX", BUILTIN_CUSTOM: "CUSTOM"}
+
+# Custom operators with a kernel in the sketch
+CUSTOM_INTERLEAVED_FC = "FC_INTERLEAVED"  # Options [block: u8] [activation: u8] [format: u8], see `InterleavedFullyConnected.h`
+CUSTOM_SPARSE_FC = "FC_SPARSE"  # Options [block rows: u8] [block columns: u8] [activation: u8], see `SparseFullyConnected.h`
+
+# Weight formats of FC_INTERLEAVED
+INTERLEAVED_FLOAT32 = 0
+INTERLEAVED_FLOAT16 = 1
+INTERLEAVED_BFLOAT16 = 2  # Raw bits in an INT16 tensor
+INTERLEAVED_INT8 = 3  # Symmetric int8 with a scale per row
+INTERLEAVED_INT8_INPUT = 4  # The same, the input is quantized on every invoke as well
+INTERLEAVED_PALETTE8 = 5  # 8 bit indices into a palette of 256 floats, input 3
+INTERLEAVED_PALETTE4 = 6  # 4 bit indices into a palette of 16 floats, two rows per byte, even row in the low nibble
+
+# TensorType codes of the schema
+TENSOR_FLOAT32 = 0
+TENSOR_FLOAT16 = 1
+TENSOR_INT32 = 2
+TENSOR_UINT8 = 3
+TENSOR_INT16 = 7
+TENSOR_INT8 = 9
+TENSOR_TYPE_NAMES = {0: "float32", 1: "float16", 2: "int32", 3: "uint8", 4: "int64", 7: "int16", 9: "int8", 16: "bfloat16"}
+TENSOR_FORMATS = {TENSOR_FLOAT32: "f", TENSOR_INT32: "i", TENSOR_UINT8: "B", TENSOR_INT16: "h", TENSOR_INT8: "b"}
+
+# ActivationFunctionType codes of the schema
+ACTIVATION_NONE = 0
+ACTIVATION_RELU = 1
+ACTIVATION_RELU_N1_TO_1 = 2
+ACTIVATION_RELU6 = 3
+ACTIVATION_NAMES = {0: "NONE", 1: "RELU", 2: "RELU_N1_TO_1", 3: "RELU6", 4: "TANH"}
+
+
+def read_model_bytes(path):
+    """Model flatbuffer from a `.tflite` file or the `model_data[]` array of a header."""
+    with open(path, "rb") as source:
+        data = source.read()
+    if not path.endswith((".h", ".hpp", ".cc", ".cpp")):
+        return data
+    text = data.decode("utf-8", "replace")
+    start = text.index("model_data[")
+    body = text[text.index("{", start):text.index("}", start)]
+    return bytes(int(value, 16) for value in re.findall(r"0x([0-9a-fA-F]{2})", body))
+
+
+class FlatBuffer:
+    """Read-only access to flatbuffer tables by field index."""
+
+    def __init__(self, data):
+        self.data = data
+
+    def u8(self, offset):
+        return self.data[offset]
+
+    def i8(self, offset):
+        return struct.unpack_from("<b", self.data, offset)[0]
+
+    def u16(self, offset):
+        return struct.unpack_from("<H", self.data, offset)[0]
+
+    def i32(self, offset):
+        return struct.unpack_from("<i", self.data, offset)[0]
+
+    def u32(self, offset):
+        return struct.unpack_from("<I", self.data, offset)[0]
+
+    def f32(self, offset):
+        return struct.unpack_from("<f", self.data, offset)[0]
+
+    def root(self):
+        return self.u32(0)
+
+    def field(self, table, index):
+        """Absolute offset of field `index` of `table`, None if it is absent."""
+        vtable = table - self.i32(table)
+        if 4 + 2 * index >= self.u16(vtable):
+            return None
+        offset = self.u16(vtable + 4 + 2 * index)
+        return table + offset if offset else None
+
+    def indirect(self, offset):
+        return offset + self.u32(offset)
+
+    def table(self, table, index):
+        field = self.field(table, index)
+        return self.indirect(field) if field is not None else None
+
+    def vector(self, table, index):
+        """(start, length) of a vector field, (None, 0) if it is absent."""
+        field = self.field(table, index)
+        if field is None:
+            return None, 0
+        vector = self.indirect(field)
+        return vector + 4, self.u32(vector)
+
+    def tables(self, table, index):
+        start, length = self.vector(table, index)
+        return [self.indirect(start + 4 * i) for i in range(length)]
+
+    def ints(self, table, index):
+        start, length = self.vector(table, index)
+        return [self.i32(start + 4 * i) for i in range(length)]
+
+    def bytes(self, table, index):
+        start, length = self.vector(table, index)
+        return self.data[start:start + length] if start is not None else b""
+
+    def string(self, table, index):
+        return self.bytes(table, index).decode("utf-8", "replace")
+
+    def scalars(self, table, index, fmt):
+        """Vector of `struct` scalars, e.g. "f" or "q"."""
+        start, length = self.vector(table, index)
+        return list(struct.unpack_from("<%d%s" % (length, fmt), self.data, start)) if start is not None else []
+
+    def scalar(self, table, index, reader, default=0):
+        field = self.field(table, index)
+        return reader(field) if field is not None else default
+
+
+class Tensor:
+    def __init__(self, index, name, shape, tensor_type, buffer, data, quantization=None):
+        self.index = index
+        self.name = name
+        self.shape = shape
+        self.type = tensor_type
+        self.buffer = buffer
+        self.data = data  # Raw constant data, empty for activations
+        self.quantization = quantization  # Dict with `scale`, `zero_point` and `quantized_dimension`, None without
+
+    def elements(self):
+        return int(math.prod(self.shape)) if self.shape else 1
+
+    def values(self):
+        """Constant data decoded as a flat array."""
+        if self.type == TENSOR_FLOAT16:
+            return array("f", struct.unpack("<%de" % (len(self.data) // 2), self.data))
+        return array(TENSOR_FORMATS[self.type], self.data)
+
+
+class Operator:
+    def __init__(self, index, code, custom, inputs, outputs, options, custom_options=b""):
+        self.index = index
+        self.code = code
+        self.custom = custom
+        self.inputs = inputs
+        self.outputs = outputs
+        self.options = options  # Decoded builtin options that matter to the interpreter
+        self.custom_options = custom_options  # Raw options of custom operators
+
+    def name(self):
+        return self.custom if self.custom else BUILTIN_NAMES.get(self.code, "BUILTIN_%d" % self.code)
+
+
+class Model:
+    def __init__(self, data):
+        self.data = data
+        buffer = FlatBuffer(data)
+        root = buffer.root()
+        self.version = buffer.scalar(root, 0, buffer.u32)
+
+        codes = []
+        for code in buffer.tables(root, 1):
+            deprecated = buffer.scalar(code, 0, buffer.i8)
+            builtin = buffer.scalar(code, 3, buffer.i32)
+            custom = buffer.string(code, 1) if buffer.field(code, 1) is not None else None
+            codes.append((max(deprecated, builtin), custom))
+
+        buffers = [buffer.bytes(entry, 0) for entry in buffer.tables(root, 4)]
+
+        subgraph = buffer.tables(root, 2)[0]
+        self.tensors = []
+        for index, tensor in enumerate(buffer.tables(subgraph, 0)):
+            buffer_index = buffer.scalar(tensor, 2, buffer.u32)
+            quantization = buffer.table(tensor, 4)
+            scale = buffer.scalars(quantization, 2, "f") if quantization is not None else []
+            self.tensors.append(Tensor(index, buffer.string(tensor, 3), buffer.ints(tensor, 0),
+                                       buffer.scalar(tensor, 1, buffer.u8), buffer_index,
+                                       bytes(buffers[buffer_index]) if buffer_index < len(buffers) else b"",
+                                       {"scale": scale, "zero_point": buffer.scalars(quantization, 3, "q"),
+                                        "quantized_dimension": buffer.scalar(quantization, 6, buffer.i32)} if scale else None))
+        self.inputs = buffer.ints(subgraph, 1)
+        self.outputs = buffer.ints(subgraph, 2)
+
+        self.operators = []
+        for index, op in enumerate(buffer.tables(subgraph, 3)):
+            code, custom = codes[buffer.scalar(op, 0, buffer.u32)]
+            options = {}
+            builtin_options = buffer.table(op, 4)
+            if builtin_options is not None and code == BUILTIN_FULLY_CONNECTED:
+                options["activation"] = buffer.scalar(builtin_options, 0, buffer.i8)
+            elif builtin_options is not None and code == BUILTIN_SOFTMAX:
+                options["beta"] = buffer.scalar(builtin_options, 0, buffer.f32, 1.0)
+            self.operators.append(Operator(index, code, custom, buffer.ints(op, 1), buffer.ints(op, 2), options,
+                                           bytes(buffer.bytes(op, 5))))
+
+        self.metadata = {}  # Name to buffer index
+        self.metadata_data = {}  # Name to raw bytes
+        for entry in buffer.tables(root, 6):
+            self.metadata[buffer.string(entry, 0)] = buffer.scalar(entry, 1, buffer.u32)
+            index = self.metadata[buffer.string(entry, 0)]
+            self.metadata_data[buffer.string(entry, 0)] = bytes(buffers[index]) if index < len(buffers) else b""
+
+    @classmethod
+    def load(cls, path=DEFAULT_MODEL_HEADER):
+        return cls(read_model_bytes(path))
+
+    def parameters(self):
+        """Number of float32 constant elements, matches `model_parameters` of the header."""
+        return sum(tensor.elements() for tensor in self.tensors if tensor.data and tensor.type == TENSOR_FLOAT32)
+
+    def invoke(self, inputs):
+        """Run the graph on a list of flat float inputs. Returns the values of every tensor by index."""
+        values = {}
+        for tensor in self.tensors:
+            if tensor.data and tensor.type == TENSOR_FLOAT32:
+                values[tensor.index] = tensor.values()
+        for index, data in zip(self.inputs, inputs):
+            values[index] = list(data)
+
+        for op in self.operators:
+            if op.code == BUILTIN_RESHAPE:
+                values[op.outputs[0]] = values[op.inputs[0]]
+            elif op.code == BUILTIN_FULLY_CONNECTED:
+                values[op.outputs[0]] = self.fully_connected(op, values)
+            elif op.code == BUILTIN_SOFTMAX:
+                values[op.outputs[0]] = softmax(values[op.inputs[0]], op.options.get("beta", 1.0))
+            elif op.custom == CUSTOM_INTERLEAVED_FC:
+                values[op.outputs[0]] = self.interleaved_fully_connected(op, values)
+            elif op.custom == CUSTOM_SPARSE_FC:
+                values[op.outputs[0]] = self.sparse_fully_connected(op, values)
+            else:
+                raise NotImplementedError("Operator %s is not supported" % op.name())
+        return values
+
+    def fully_connected(self, op, values):
+        data = values[op.inputs[0]]
+        weights_tensor = self.tensors[op.inputs[1]]
+        weights = values[op.inputs[1]]
+        bias = values[op.inputs[2]] if len(op.inputs) > 2 and op.inputs[2] >= 0 else None
+        units, depth = weights_tensor.shape
+        output = []
+        for unit in range(units):
+            total = sum(map(operator.mul, weights[unit * depth:(unit + 1) * depth], data))
+            if bias is not None:
+                total += bias[unit]
+            output.append(total)
+        return activate(output, op.options.get("activation", ACTIVATION_NONE))
+
+    def interleaved_fully_connected(self, op, values):
+        """FULLY_CONNECTED on weights stored as [units / block][depth][block], rows padded to whole blocks."""
+        block, activation = op.custom_options[0], op.custom_options[1]
+        weight_format = op.custom_options[2] if len(op.custom_options) > 2 else INTERLEAVED_FLOAT32
+        data = values[op.inputs[0]]
+        weights_tensor = self.tensors[op.inputs[1]]
+        if weight_format == INTERLEAVED_BFLOAT16:
+            weights = bfloat16_values(weights_tensor.data)
+        elif weight_format in (INTERLEAVED_PALETTE8, INTERLEAVED_PALETTE4):
+            weights = palette_values(weights_tensor.data, values[op.inputs[3]], weight_format == INTERLEAVED_PALETTE4)
+        else:
+            weights = weights_tensor.values()
+        scales = weights_tensor.quantization["scale"] if weight_format in (INTERLEAVED_INT8, INTERLEAVED_INT8_INPUT) else None
+        input_scale = 1.0
+        if weight_format == INTERLEAVED_INT8_INPUT:
+            data, input_scale = quantize_input(data)
+        bias = values[op.inputs[2]] if len(op.inputs) > 2 and op.inputs[2] >= 0 else None
+        depth = weights_tensor.shape[1]
+        units = self.tensors[op.outputs[0]].shape[-1]
+        output = []
+        for unit in range(units):
+            start = (unit // block) * block * depth + unit % block
+            total = sum(map(operator.mul, weights[start:start + block * depth:block], data))
+            if scales is not None:
+                total *= input_scale * scales[unit if len(scales) > 1 else 0]
+            if bias is not None:
+                total += bias[unit]
+            output.append(total)
+        return activate(output, activation)
+
+    def sparse_fully_connected(self, op, values):
+        """FULLY_CONNECTED on the stored blocks of a block compressed sparse row matrix, blocks as [columns][rows]."""
+        block_rows, block_cols, activation = op.custom_options[0], op.custom_options[1], op.custom_options[2]
+        data = values[op.inputs[0]]
+        blocks = values.get(op.inputs[1], [])  # Empty if every block was pruned
+        bias = values[op.inputs[2]] if op.inputs[2] >= 0 else None
+        row_pointers = self.tensors[op.inputs[3]].values()
+        column_indices = self.tensors[op.inputs[4]].values()
+        depth = self.tensors[op.inputs[0]].shape[-1]
+        units = self.tensors[op.outputs[0]].shape[-1]
+        size = block_rows * block_cols
+        output = []
+        for unit in range(units):
+            block_row, row = divmod(unit, block_rows)
+            products = []  # Summed in one go, in input order like the dense kernel
+            for block in range(row_pointers[block_row], row_pointers[block_row + 1]):
+                column = column_indices[block] * block_cols
+                columns = min(block_cols, depth - column)
+                start = block * size + row
+                products.extend(map(operator.mul, blocks[start:start + columns * block_rows:block_rows], data[column:column + columns]))
+            total = sum(products)
+            if bias is not None:
+                total += bias[unit]
+            output.append(total)
+        return activate(output, activation)
+
+    def logits_tensor(self):
+        """Index of the tensor feeding the final SOFTMAX, None if the model does not end in one."""
+        last = self.operators[-1]
+        return last.inputs[0] if last.code == BUILTIN_SOFTMAX else None
+
+
+def quantize_input(values):
+    """Symmetric int8 quantization of an activation like `InterleavedFullyConnected`, (values, scale)."""
+    largest = max(abs(value) for value in values)
+    inverse = 127.0 / largest if largest > 0 else 0.0
+    return [max(-127, min(127, int(value * inverse + (0.5 if value >= 0 else -0.5)))) for value in values], largest / 127.0
+
+
+def bfloat16_values(data):
+    """Floats from bfloat16 bit patterns, the upper halves of float32."""
+    halves = struct.unpack("<%dH" % (len(data) // 2), data)
+    return array("f", struct.pack("<%dI" % len(halves), *(half << 16 for half in halves)))
+
+
+def activate(values, activation):
+    if activation == ACTIVATION_RELU:
+        return [max(value, 0.0) for value in values]
+    if activation == ACTIVATION_RELU6:
+        return [min(max(value, 0.0), 6.0) for value in values]
+    if activation == ACTIVATION_RELU_N1_TO_1:
+        return [min(max(value, -1.0), 1.0) for value in values]
+    if activation == 4:
+        return [math.tanh(value) for value in values]
+    return values
+
+
+def palette_values(data, palette, packed):
+    """Weights of palette indices, two per byte low nibble first if `packed`."""
+    if packed:
+        return array("f", (palette[index] for byte in data for index in (byte & 0x0F, byte >> 4)))
+    return array("f", (palette[index] for index in data))
+
+
+def softmax(logits, beta=1.0):
+    largest = max(logits)
+    exponentials = [math.exp(beta * (value - largest)) for value in logits]
+    total = sum(exponentials)
+    return [value / total for value in exponentials]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", nargs="?", default=DEFAULT_MODEL_HEADER, help=".tflite file or model header")
+    args = parser.parse_args()
+
+    model = Model.load(args.model)
+    print("schema version %d, %d bytes, %d parameters" % (model.version, len(model.data), model.parameters()))
+    for tensor in model.tensors:
+        print("tensor %2d %-8s %-16s %s" % (tensor.index, TENSOR_TYPE_NAMES.get(tensor.type, tensor.type),
+                                          tensor.shape, tensor.name))
+    for op in model.operators:
+        details = ", ".join("%s=%s" % (key, ACTIVATION_NAMES.get(value, value) if key == "activation" else value)
+                            for key, value in sorted(op.options.items()))
+        print("op %2d %-16s %s -> %s %s" % (op.index, op.name(), op.inputs, op.outputs, details))
+    print("inputs %s, outputs %s" % (model.inputs, model.outputs))
+    for name, buffer in sorted(model.metadata.items()):
+        print("metadata %s: buffer %d" % (name, buffer))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,258 @@
+#!/usr/bin/env python3
+"""Train the gate model of the model cascade (`ModelCascade.h`) and write it as `gate_model.h`.
+
+The gate sees the classifier window averaged over `--downsample` consecutive samples and tells idle from
+motion with one hidden layer: RESHAPE, FULLY_CONNECTED (RELU), FULLY_CONNECTED and SOFTMAX, the ops the
+sketch already registers. Windows are labelled from the ground truth CSV of `posterior_replay.py`
+(motion if the window overlaps a non-idle gesture), or without one by the classifier itself (motion if
+it does not pick idle). Motion windows are weighted up with `--motion-weight`: a skipped gesture costs
+more than an extra classifier run.
+
+Usage:
+    python tools/train_gate_model.py capture.bin truth.csv
+    python tools/train_gate_model.py capture.bin --hidden 8 --downsample 4 --tflite gate.tflite
+"""
+
+import argparse
+import math
+import operator
+import os
+import random
+import struct
+import sys
+
+import posterior_replay
+import telemetry_decode
+import tflite_builder
+import tflite_model
+
+DEFAULT_OUTPUT = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "gate_model.h")
+IDLE_INDEX = 0  # `CASCADE_IDLE_INDEX`
+
+
+def make_windows(samples, stride):
+    """(first timestamp, last timestamp, flat window) every `stride` samples, like the sketch."""
+    windows = []
+    for end in range(posterior_replay.NUM_SAMPLES, len(samples) + 1, stride):
+        window = samples[end - posterior_replay.NUM_SAMPLES:end]
+        windows.append((window[0][0], window[-1][0], [value for _, features, _ in window for value in features]))
+    return windows
+
+
+def downsample(window, factor):
+    """Matches `ModelCascade::downsample()`."""
+    features = posterior_replay.NUM_FEATURES
+    output = []
+    for start in range(0, len(window), factor * features):
+        block = window[start:start + factor * features]
+        output.extend(sum(block[i * features + feature] for i in range(factor)) / factor for feature in range(features))
+    return output
+
+
+def truth_labels(windows, truth):
+    return [int(any(gesture != IDLE_INDEX and start <= last and end >= first for start, end, gesture in truth))
+            for first, last, _ in windows]
+
+
+def teacher_labels(windows, model):
+    labels = []
+    for _, _, window in windows:
+        scores = model.invoke([window])[model.outputs[0]]
+        labels.append(int(max(range(len(scores)), key=lambda i: scores[i]) != IDLE_INDEX))
+    return labels
+
+
+class Network:
+    """Inputs -> hidden (RELU) -> [idle, motion] logits, trained with Adam on weighted cross-entropy."""
+
+    def __init__(self, inputs, hidden, seed):
+        generator = random.Random(seed)
+        bound = math.sqrt(6.0 / inputs)
+        self.w1 = [[generator.uniform(-bound, bound) for _ in range(inputs)] for _ in range(hidden)]
+        self.b1 = [0.0] * hidden
+        bound = math.sqrt(6.0 / hidden)
+        self.w2 = [[generator.uniform(-bound, bound) for _ in range(hidden)] for _ in range(2)]
+        self.b2 = [0.0, 0.0]
+
+    def parameters(self):
+        return len(self.w1) * (len(self.w1[0]) + 1) + 2 * (len(self.w2[0]) + 1)
+
+    def forward(self, x):
+        hidden = [max(0.0, sum(map(operator.mul, row, x)) + bias) for row, bias in zip(self.w1, self.b1)]
+        logits = [sum(map(operator.mul, row, hidden)) + bias for row, bias in zip(self.w2, self.b2)]
+        return hidden, logits
+
+    def train(self, inputs, labels, weights, epochs, rate, batch, seed):
+        generator = random.Random(seed)
+        rows = [self.w1, self.w2]
+        vectors = [self.b1, self.b2]
+        moments = {id(v): ([[0.0] * len(r) for r in v], [[0.0] * len(r) for r in v]) for v in rows}
+        moments.update({id(v): ([0.0] * len(v), [0.0] * len(v)) for v in vectors})
+        step = 0
+        order = list(range(len(inputs)))
+        for epoch in range(epochs):
+            generator.shuffle(order)
+            loss = 0.0
+            for start in range(0, len(order), batch):
+                grad_w1 = [[0.0] * len(self.w1[0]) for _ in self.w1]
+                grad_b1 = [0.0] * len(self.b1)
+                grad_w2 = [[0.0] * len(self.w2[0]) for _ in self.w2]
+                grad_b2 = [0.0, 0.0]
+                chunk = order[start:start + batch]
+                total_weight = sum(weights[labels[i]] for i in chunk)
+                for i in chunk:
+                    x = inputs[i]
+                    hidden, logits = self.forward(x)
+                    largest = max(logits)
+                    exps = [math.exp(value - largest) for value in logits]
+                    probabilities = [value / sum(exps) for value in exps]
+                    weight = weights[labels[i]] / total_weight
+                    loss -= weight * math.log(max(probabilities[labels[i]], 1e-12)) * len(chunk)
+                    delta = [weight * (p - (k == labels[i])) for k, p in enumerate(probabilities)]
+                    for k in range(2):
+                        grad_b2[k] += delta[k]
+                        grad_w2[k] = [g + delta[k] * h for g, h in zip(grad_w2[k], hidden)]
+                    for j, h in enumerate(hidden):
+                        if h <= 0.0:
+                            continue
+                        back = delta[0] * self.w2[0][j] + delta[1] * self.w2[1][j]
+                        grad_b1[j] += back
+                        grad_w1[j] = [g + back * value for g, value in zip(grad_w1[j], x)]
+                step += 1
+                for parameter, gradient in ((self.w1, grad_w1), (self.w2, grad_w2)):
+                    first, second = moments[id(parameter)]
+                    for row, grad_row, m_row, v_row in zip(parameter, gradient, first, second):
+                        adam(row, grad_row, m_row, v_row, rate, step)
+                for parameter, gradient in ((self.b1, grad_b1), (self.b2, grad_b2)):
+                    first, second = moments[id(parameter)]
+                    adam(parameter, gradient, first, second, rate, step)
+            if epoch % 10 == 0 or epoch == epochs - 1:
+                sys.stderr.write("epoch %4d loss %.4f\n" % (epoch, loss / len(order)))
+
+    def fold_normalization(self, mean, scale):
+        """Absorb `(x - mean) / scale` into the first layer, so the model takes raw inputs."""
+        for j, row in enumerate(self.w1):
+            self.b1[j] -= sum(w * m / s for w, m, s in zip(row, mean, scale))
+            self.w1[j] = [w / s for w, s in zip(row, scale)]
+
+
+def adam(values, gradients, first, second, rate, step, beta1=0.9, beta2=0.999, epsilon=1e-8):
+    correction = rate * math.sqrt(1.0 - beta2 ** step) / (1.0 - beta1 ** step)
+    for i, gradient in enumerate(gradients):
+        first[i] = beta1 * first[i] + (1.0 - beta1) * gradient
+        second[i] = beta2 * second[i] + (1.0 - beta2) * gradient * gradient
+        values[i] -= correction * first[i] / (math.sqrt(second[i]) + epsilon)
+
+
+def build(network, gate_samples):
+    """Serialize the network as a TFLite model with the ops of the sketch's resolver."""
+    features = posterior_replay.NUM_FEATURES
+    inputs = gate_samples * features
+    hidden = len(network.w1)
+
+    def constant(index, name, shape, values, tensor_type=tflite_model.TENSOR_FLOAT32):
+        fmt = "<%d%s" % (len(values), "i" if tensor_type == tflite_model.TENSOR_INT32 else "f")
+        return tflite_model.Tensor(index, name, shape, tensor_type, 0, struct.pack(fmt, *values))
+
+    def activation(index, name, shape):
+        return tflite_model.Tensor(index, name, shape, tflite_model.TENSOR_FLOAT32, 0, b"")
+
+    tensors = [
+        activation(0, "gate_input", [1, gate_samples, features]),
+        constant(1, "gate/flatten/shape", [2], [1, inputs], tflite_model.TENSOR_INT32),
+        constant(2, "gate/hidden/weights", [hidden, inputs], [w for row in network.w1 for w in row]),
+        constant(3, "gate/hidden/bias", [hidden], network.b1),
+        constant(4, "gate/logits/weights", [2, hidden], [w for row in network.w2 for w in row]),
+        constant(5, "gate/logits/bias", [2], network.b2),
+        activation(6, "gate/flatten", [1, inputs]),
+        activation(7, "gate/hidden", [1, hidden]),
+        activation(8, "gate/logits", [1, 2]),
+        activation(9, "gate_output", [1, 2]),
+    ]
+    operators = [
+        tflite_model.Operator(0, tflite_model.BUILTIN_RESHAPE, None, [0, 1], [6], {"new_shape": [1, inputs]}),
+        tflite_model.Operator(1, tflite_model.BUILTIN_FULLY_CONNECTED, None, [6, 2, 3], [7], {"activation": tflite_model.ACTIVATION_RELU}),
+        tflite_model.Operator(2, tflite_model.BUILTIN_FULLY_CONNECTED, None, [7, 4, 5], [8], {"activation": tflite_model.ACTIVATION_NONE}),
+        tflite_model.Operator(3, tflite_model.BUILTIN_SOFTMAX, None, [8], [9], {"beta": 1.0}),
+    ]
+    return tflite_builder.build_model(tensors, operators, [0], [9], description="Lab4_Model gate model")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("capture", help="raw telemetry capture holding IMU sample frames")
+    parser.add_argument("truth", nargs="?", help="ground truth CSV: start_ms,end_ms,gesture, labels come from the classifier without it")
+    parser.add_argument("--model", default=tflite_model.DEFAULT_MODEL_HEADER, help="classifier, .tflite file or model header")
+    parser.add_argument("--stride", type=int, default=8, help="samples between training windows")
+    parser.add_argument("--downsample", type=int, default=6, help="classifier samples averaged into one gate sample")
+    parser.add_argument("--hidden", type=int, default=4, help="hidden units")
+    parser.add_argument("--epochs", type=int, default=60)
+    parser.add_argument("--rate", type=float, default=0.01, help="Adam learning rate")
+    parser.add_argument("--batch", type=int, default=32)
+    parser.add_argument("--motion-weight", type=float, default=4.0, help="loss weight of motion windows against idle ones")
+    parser.add_argument("--seed", type=int, default=1)
+    parser.add_argument("--output", default=DEFAULT_OUTPUT, help="header to write")
+    parser.add_argument("--tflite", help="also write the flatbuffer to this file")
+    args = parser.parse_args()
+
+    if posterior_replay.NUM_SAMPLES % args.downsample:
+        parser.error("--downsample must divide the window of %d samples" % posterior_replay.NUM_SAMPLES)
+    gate_samples = posterior_replay.NUM_SAMPLES // args.downsample
+
+    classifier = tflite_model.Model.load(args.model)
+    samples = posterior_replay.read_samples(args.capture)
+    windows = make_windows(samples, args.stride)
+    if not windows:
+        sys.stderr.write("The capture holds fewer than %d samples\n" % posterior_replay.NUM_SAMPLES)
+        return 1
+    if args.truth:
+        names = telemetry_decode.load_labels(args.model if args.model.endswith(".h") else telemetry_decode.DEFAULT_MODEL_HEADER)
+        labels = truth_labels(windows, posterior_replay.read_truth(args.truth, names))
+    else:
+        labels = teacher_labels(windows, classifier)
+    inputs = [downsample(window, args.downsample) for _, _, window in windows]
+    motion = sum(labels)
+    print("%d windows, %d motion, %d idle" % (len(windows), motion, len(windows) - motion))
+    if motion in (0, len(windows)):
+        sys.stderr.write("Both idle and motion windows are needed for training\n")
+        return 1
+
+    # Train on standardized inputs, folded into the first layer afterwards
+    count = len(inputs)
+    mean = [sum(column) / count for column in zip(*inputs)]
+    scale = [math.sqrt(sum((value - m) ** 2 for value in column) / count) or 1.0 for column, m in zip(zip(*inputs), mean)]
+    standardized = [[(value - m) / s for value, m, s in zip(x, mean, scale)] for x in inputs]
+    network = Network(len(mean), args.hidden, args.seed)
+    network.train(standardized, labels, [1.0, args.motion_weight], args.epochs, args.rate, args.batch, args.seed)
+    network.fold_normalization(mean, scale)
+
+    # Decide like `ModelCascade::isMotion()` with the default margin
+    predicted = []
+    for x in inputs:
+        logits = network.forward(x)[1]
+        predicted.append(int(logits[1] >= logits[0]))
+    recall = sum(p for p, label in zip(predicted, labels) if label) / motion
+    skipped = predicted.count(0) / count
+    missed = sum(1 for p, label in zip(predicted, labels) if label and not p)
+    print("gate: %d parameters (classifier %d), motion recall %.1f%% (%d windows missed), classifier skipped on %.1f%% of windows"
+          % (network.parameters(), classifier.parameters(), 100.0 * recall, missed, 100.0 * skipped))
+
+    # Check the serialized model against the trained network
+    data = build(network, gate_samples)
+    gate = tflite_model.Model(data)
+    error = 0.0
+    for x in inputs[:: max(1, count // 50)]:
+        logits = gate.invoke([x])[8]
+        error = max(error, max(abs(a - b) for a, b in zip(logits, network.forward(x)[1])))
+    print("serialized model: %d bytes, max logit deviation %.2e" % (len(data), error))
+
+    tflite_builder.write_header(args.output, data, "gate_model", parameters=gate.parameters())
+    print("wrote %s" % args.output)
+    if args.tflite:
+        with open(args.tflite, "wb") as output:
+            output.write(data)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,289 @@
+#!/usr/bin/env python3
+"""Relay out the FULLY_CONNECTED weights of a model for sequential streaming from XIP flash.
+
+TFLite stores dense weights row-major as [units, depth]. This pass interleaves blocks of `--block` output rows
+into [units / block][depth][block], padding the rows with zeros to whole blocks, and turns the layers into the
+FC_INTERLEAVED custom operator of `InterleavedFullyConnected.h`. The kernel then feeds `block` accumulators per
+pass over the input and reads every weight once per inference, front to back.
+
+`--format float16` or `bfloat16` also stores the weights in 16 bits, expanded to float inside the kernel. That halves
+the flash footprint and the XIP traffic of the dense stack, activations and biases stay float32.
+`--format int8` quantizes every weight row symmetrically with its own scale, a quarter of the float32 size.
+With `--quantize-input` the kernel quantizes the input of a layer on every invoke as well and runs the dot products
+on integers (dynamic range quantization). By default only hidden layers do, the raw sensor window mixes features of
+different ranges that a single input scale would crush.
+`--format palette8` or `palette4` clusters the weights of every layer into a palette of 256 or 16 values with k-means
+and stores an 8 or 4 bit index per weight, expanded through the palette inside the kernel. 4 bit indices only keep
+the accuracy of models clustered during training, whose layers hold at most 16 distinct weights: their palette is
+exact.
+
+The relaid out model is checked against the original with the reference interpreter of `tflite_model.py` before
+it is written, on random inputs and on the windows of a capture with `--capture`. Only a recording of the board
+says how a format treats real sensor windows, and neither check times the kernels: that takes 'p' on the device.
+Outputs have to agree within `--tolerance` and every window has to keep its top class. A window whose two best
+scores were already within the tolerance may swap them, the output differences the tolerance accepts are enough for
+that. Such swaps are reported separately, so a format that swaps many close windows still shows.
+
+Usage:
+    python tools/weight_relayout.py model.h interleaved_model.h --prefix interleaved_model
+    python tools/weight_relayout.py model.h model_interleaved.tflite --block 8 --layers 1,2,3
+    python tools/weight_relayout.py model.h half_model.h --prefix half_model --format bfloat16 --capture capture.bin
+    python tools/weight_relayout.py model.h int8_model.h --prefix int8_model --format int8 --capture capture.bin
+    python tools/weight_relayout.py clustered.tflite palette_model.h --prefix palette_model --format palette4
+    python tools/posterior_replay.py capture.bin truth.csv --model int8_model.h      # Accuracy against the labels
+    python tools/model_upload.py model_interleaved.tflite --port COM3   # Try it without rebuilding
+"""
+
+import argparse
+import bisect
+import random
+import struct
+import sys
+from array import array
+
+import posterior_replay
+import telemetry_decode
+import tflite_builder
+import tflite_model
+
+BLOCK_SIZES = (1, 2, 4, 8)  # Unrolled in `InterleavedFullyConnected.cpp`
+
+# Weight storage: (format option, tensor type, element size, default tolerance of the outputs)
+FORMATS = {
+    "float32": (tflite_model.INTERLEAVED_FLOAT32, tflite_model.TENSOR_FLOAT32, 4, 1e-5),
+    "float16": (tflite_model.INTERLEAVED_FLOAT16, tflite_model.TENSOR_FLOAT16, 2, 1e-2),
+    "bfloat16": (tflite_model.INTERLEAVED_BFLOAT16, tflite_model.TENSOR_INT16, 2, 5e-2),
+    "int8": (tflite_model.INTERLEAVED_INT8, tflite_model.TENSOR_INT8, 1, 1e-1),
+    "palette8": (tflite_model.INTERLEAVED_PALETTE8, tflite_model.TENSOR_UINT8, 1, 1e-1),
+    "palette4": (tflite_model.INTERLEAVED_PALETTE4, tflite_model.TENSOR_UINT8, 0.5, 1e-1),
+}
+PALETTE_ENTRIES = {"palette8": 256, "palette4": 16}
+FORMAT_NAMES = {tflite_model.INTERLEAVED_FLOAT32: "float32", tflite_model.INTERLEAVED_FLOAT16: "float16",
+                tflite_model.INTERLEAVED_BFLOAT16: "bfloat16", tflite_model.INTERLEAVED_INT8: "int8",
+                tflite_model.INTERLEAVED_INT8_INPUT: "int8 x int8", tflite_model.INTERLEAVED_PALETTE8: "palette8",
+                tflite_model.INTERLEAVED_PALETTE4: "palette4"}
+
+
+def interleave(values, units, depth, block):
+    """Row-major [units, depth] array as [units / block][depth][block], padded rows are zero."""
+    padded = -(-units // block) * block
+    output = array(values.typecode, bytes(values.itemsize * padded * depth))
+    for unit in range(units):
+        base = (unit // block) * block * depth + unit % block
+        output[base:base + block * depth:block] = values[unit * depth:(unit + 1) * depth]
+    return output
+
+
+def quantize_rows(values, units, depth):
+    """Symmetric int8 per row, scale = largest magnitude / 127, rounded half away from zero like TFLite."""
+    quantized = array("b")
+    scales = []
+    for unit in range(units):
+        row = values[unit * depth:(unit + 1) * depth]
+        largest = max(abs(value) for value in row)
+        scale = largest / 127.0 if largest > 0 else 1.0
+        scales.append(scale)
+        quantized.extend(max(-127, min(127, int(value / scale + (0.5 if value >= 0 else -0.5)))) for value in row)
+    return quantized, scales
+
+
+def cluster(values, entries, iterations=50):
+    """Palette of `entries` values (k-means in one dimension, seeded at quantiles) and the index of every weight.
+    Layers with at most `entries` distinct weights get them as an exact palette. Unused entries are zero."""
+    distinct = sorted(set(values))
+    if len(distinct) <= entries:
+        palette = distinct
+    else:
+        ordered = sorted(values)
+        palette = [ordered[(2 * entry + 1) * len(ordered) // (2 * entries)] for entry in range(entries)]
+        for _ in range(iterations):
+            bounds = [(low + high) / 2 for low, high in zip(palette, palette[1:])]
+            sums = [0.0] * entries
+            counts = [0] * entries
+            for value in ordered:
+                entry = bisect.bisect(bounds, value)
+                sums[entry] += value
+                counts[entry] += 1
+            updated = sorted(sums[entry] / counts[entry] if counts[entry] else palette[entry] for entry in range(entries))
+            if updated == palette:
+                break
+            palette = updated
+    bounds = [(low + high) / 2 for low, high in zip(palette, palette[1:])]
+    indices = array("B", (bisect.bisect(bounds, value) for value in values))
+    return palette + [0.0] * (entries - len(palette)), indices
+
+
+def encode(values, weight_format):
+    """Weights as stored for `weight_format`, rounded to nearest even. Palette indices are packed two per byte for
+    palette4, low nibble first."""
+    if weight_format == "float16":
+        return struct.pack("<%de" % len(values), *values)
+    if weight_format == "bfloat16":
+        bits = struct.unpack("<%dI" % len(values), struct.pack("<%df" % len(values), *values))
+        return struct.pack("<%dH" % len(bits), *((value + 0x7FFF + ((value >> 16) & 1)) >> 16 for value in bits))
+    if weight_format == "palette4":
+        return bytes(values[index] | (values[index + 1] << 4) for index in range(0, len(values), 2))
+    return values.tobytes()
+
+
+def layer_name(model, op):
+    """Layer of an operator from its output tensor, "sequential_13/dense_104/MatMul;..." gives "dense_104"."""
+    path = model.tensors[op.outputs[0]].name.split(";")[0].split("/")
+    return path[-2] if len(path) > 1 else path[0]
+
+
+def fed_by_model_input(model, op):
+    """Whether the input of an operator is a model input, directly or through RESHAPE."""
+    tensor = op.inputs[0]
+    for producer in model.operators:
+        if tensor in producer.outputs and producer.code == tflite_model.BUILTIN_RESHAPE:
+            tensor = producer.inputs[0]
+    return tensor in model.inputs
+
+
+def relayout(model, block, layers=None, weight_format="float32", quantize_input="hidden"):
+    """Tensors and operators of `model` with the selected float FULLY_CONNECTED layers interleaved and stored as `weight_format`.
+    int8 layers quantize their input for `quantize_input` "all", or "hidden" unless they are fed by the model input.
+    Returns them with a list of (op, weights tensor, units, depth) of the layers changed."""
+    tensors = list(model.tensors)
+    operators = list(model.operators)
+    changed = []
+    for op in model.operators:
+        if op.code != tflite_model.BUILTIN_FULLY_CONNECTED or (layers is not None and op.index not in layers):
+            continue
+        weights = model.tensors[op.inputs[1]]
+        if not weights.data or weights.type != tflite_model.TENSOR_FLOAT32 or len(weights.shape) != 2:
+            continue  # Weights computed at runtime or quantized
+
+        units, depth = weights.shape
+        padded = -(-units // block) * block
+        option, tensor_type = FORMATS[weight_format][:2]
+        values = weights.values()
+        quantization = None
+        inputs = op.inputs
+        if weight_format in PALETTE_ENTRIES:
+            palette, values = cluster(values, PALETTE_ENTRIES[weight_format])
+            palette_tensor = tflite_model.Tensor(len(tensors), layer_name(model, op) + "/palette", [len(palette)],
+                                                 tflite_model.TENSOR_FLOAT32, 0, array("f", palette).tobytes())
+            tensors.append(palette_tensor)
+            inputs = [op.inputs[0], op.inputs[1], op.inputs[2] if len(op.inputs) > 2 else -1, palette_tensor.index]
+        elif weight_format == "int8":
+            if quantize_input == "all" or (quantize_input == "hidden" and not fed_by_model_input(model, op)):
+                option = tflite_model.INTERLEAVED_INT8_INPUT
+            values, scales = quantize_rows(values, units, depth)
+            quantization = {"scale": scales + [1.0] * (padded - units), "zero_point": [0] * padded, "quantized_dimension": 0}
+        rows = padded // 2 if weight_format == "palette4" else padded  # Two rows per byte
+        interleaved = tflite_model.Tensor(weights.index, weights.name, [rows, depth], tensor_type, weights.buffer,
+                                          encode(interleave(values, units, depth, block), weight_format), quantization)
+        tensors[weights.index] = interleaved
+        options = struct.pack("<BBB", block, op.options.get("activation", tflite_model.ACTIVATION_NONE), option)
+        operators[op.index] = tflite_model.Operator(op.index, tflite_model.BUILTIN_CUSTOM, tflite_model.CUSTOM_INTERLEAVED_FC,
+                                                    inputs, op.outputs, {}, options)
+        changed.append((op, weights, units, depth))
+    return tensors, operators, changed
+
+
+def stored_bytes(tensors, op):
+    """Bytes of the weights of a relaid out operator, with its palette."""
+    return len(tensors[op.inputs[1]].data) + (len(tensors[op.inputs[3]].data) if len(op.inputs) > 3 else 0)
+
+
+def random_windows(model, runs, seed=0):
+    rng = random.Random(seed)
+    return [[rng.uniform(-2.0, 2.0) for _ in range(model.tensors[model.inputs[0]].elements())] for _ in range(runs)]
+
+
+def check(original, relaid, windows, margin=0.0):
+    """Largest output difference of the two models, the number of windows whose top class changed and how many of
+    those had their two best original scores within `margin`.
+    With `margin` the accepted output difference, moving each of two such scores by less than it swaps them: the
+    difference check already allows that flip, so it is counted apart and does not fail the check on its own."""
+    largest = 0.0
+    flipped = 0
+    close = 0
+    for window in windows:
+        expected = original.invoke([window])[original.outputs[0]]
+        actual = relaid.invoke([window])[relaid.outputs[0]]
+        largest = max([largest] + [abs(a - b) for a, b in zip(expected, actual)])
+        if max(range(len(expected)), key=expected.__getitem__) == max(range(len(actual)), key=actual.__getitem__):
+            continue
+        best = sorted(expected, reverse=True)
+        if margin > 0.0 and best[0] - best[1] <= margin:
+            close += 1
+        else:
+            flipped += 1
+    return largest, flipped, close
+
+
+def capture_windows(path, stride):
+    """Flat input windows of a capture every `stride` samples, like the sketch."""
+    samples = posterior_replay.read_samples(path)
+    size = posterior_replay.NUM_SAMPLES
+    return [[value for _, features, _ in samples[end - size:end] for value in features] for end in range(size, len(samples) + 1, stride)]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("model", help=".tflite file or model header")
+    parser.add_argument("output", help=".tflite file or header to write")
+    parser.add_argument("--block", type=int, default=4, choices=BLOCK_SIZES, help="output rows interleaved per block")
+    parser.add_argument("--format", default="float32", choices=sorted(FORMATS), help="storage of the weights")
+    parser.add_argument("--quantize-input", default="hidden", choices=("all", "hidden", "none"),
+                        help="int8 layers that quantize their input as well")
+    parser.add_argument("--layers", help="comma separated operator indices to relay out, all FULLY_CONNECTED layers by default")
+    parser.add_argument("--prefix", default="model", help="name prefix of the header definitions")
+    parser.add_argument("--labels", help="comma separated class names, taken from the model header by default")
+    parser.add_argument("--runs", type=int, default=4, help="random inputs for the parity check")
+    parser.add_argument("--capture", help="raw telemetry capture whose windows are checked as well")
+    parser.add_argument("--stride", type=int, default=8, help="samples between the windows of the capture")
+    parser.add_argument("--tolerance", type=float, help="largest accepted output difference, depends on --format by default")
+    args = parser.parse_args()
+
+    model = tflite_model.Model.load(args.model)
+    layers = set(int(index) for index in args.layers.split(",")) if args.layers else None
+    if args.format == "palette4" and args.block == 1:
+        parser.error("palette4 packs two rows per byte, --block has to be at least 2")
+    tensors, operators, changed = relayout(model, args.block, layers, args.format, args.quantize_input)
+    if not changed:
+        print("No float FULLY_CONNECTED layer to relay out")
+        return 1
+
+    element_size = FORMATS[args.format][2]
+    print("%2s %-24s %12s %-12s %9s %9s %8s %13s" % ("#", "Layer", "Shape", "Format", "Bytes", "Stored", "Padding", "Input passes"))
+    for op, weights, units, depth in changed:
+        stored = stored_bytes(tensors, operators[op.index])
+        padding = int((-(-units // args.block) * args.block - units) * depth * element_size)
+        passes = -(-units // args.block)
+        print("%2d %-24s %12s %-12s %9d %9d %8d %6d -> %-4d" % (op.index, layer_name(model, op)[:24], "%dx%d" % (units, depth),
+                                                               FORMAT_NAMES[operators[op.index].custom_options[2]],
+                                                               len(weights.data), stored, padding, units, passes))
+    print("Weights: %d bytes stored, %d before" % (sum(stored_bytes(tensors, operators[op.index]) for op, _, _, _ in changed),
+                                                sum(len(weights.data) for _, weights, _, _ in changed)))
+
+    data = tflite_builder.rebuild(model, tensors, operators)
+    relaid = tflite_model.Model(data)
+    tolerance = args.tolerance if args.tolerance is not None else FORMATS[args.format][3]
+    checks = [("random inputs", random_windows(model, args.runs))]
+    if args.capture:
+        checks.append(("capture windows", capture_windows(args.capture, args.stride)))
+    for name, windows in checks:
+        difference, flipped, close = check(model, relaid, windows, tolerance)
+        print("Parity over %d %s: largest output difference %.3g, top class changed in %d, and in %d with the two best scores within %.3g"
+              % (len(windows), name, difference, flipped, close, tolerance))
+        if difference > tolerance or flipped:
+            print("Relaid out model does not match the original within %.3g" % tolerance)
+            return 1
+
+    if args.output.endswith(".h"):
+        labels = args.labels.split(",") if args.labels else telemetry_decode.load_labels(args.model) or None
+        tflite_builder.write_header(args.output, data, args.prefix, labels, model.parameters())
+    else:
+        with open(args.output, "wb") as output:
+            output.write(data)
+    print("%s: %d bytes (was %d, %.2fx smaller), %d parameters" % (args.output, len(data), len(model.data), len(model.data) / len(data),
+                                                                   model.parameters()))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())